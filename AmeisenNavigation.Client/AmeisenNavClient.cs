@@ -1,7 +1,9 @@
 using AnTCP.Client;
 using System;
+using System.Collections.Generic;
 using System.IO;
 using System.Net.Sockets;
+using System.Runtime.InteropServices;
 using System.Text;
 using System.Threading;
 
@@ -37,8 +39,29 @@ namespace AmeisenNavigation.Client
             ConfigureFilter,
             GetHeight,
             GetConfig,
+            GetStats,
+            PathCosts,
+            PathToNearest,
+            ReachableWithin,
+            PathMulti,
+            PathSession,
+            ReloadMap,
+            UnloadMap,
+            PathCrossMap,
         }
 
+        /// <summary>Maximum number of targets of a <see cref="GetPathCosts"/> request.</summary>
+        public const int MaxPathCostTargets = 64;
+
+        /// <summary>Maximum number of goals of a <see cref="GetPathToNearest"/> request.</summary>
+        public const int MaxPathToNearestGoals = 64;
+
+        /// <summary>Maximum number of waypoints of a <see cref="GetMultiPath"/> request.</summary>
+        public const int MaxMultiPathWaypoints = 64;
+
+        /// <summary>Maximum number of region vertices of a <see cref="GetPath(int, Vector3, Vector3, Vector3[], PathFlags)"/> request.</summary>
+        public const int MaxPathRegionVertices = 32;
+
         private readonly AnTcpClient _client;
         private readonly object _lock = new();
 
@@ -128,6 +151,16 @@ namespace AmeisenNavigation.Client
             return SendPathRequest(MessageType.Path, mapId, start, end, flags);
         }
 
+        /// <summary>
+        /// Find a straight path from start to end that never leaves a region, e.g. a quest area or a safe
+        /// zone. Two vertices are the corners of a box, three or more a polygon, only x and y are used.
+        /// Returns null on failure.
+        /// </summary>
+        public Vector3[]? GetPath(int mapId, Vector3 start, Vector3 end, Vector3[] region, PathFlags flags = PathFlags.None)
+        {
+            return SendPathRequest(MessageType.Path, mapId, start, end, flags, region);
+        }
+
         /// <summary>
         /// Find a path with randomized waypoints (human-like movement). Returns null on failure.
         /// </summary>
@@ -136,6 +169,211 @@ namespace AmeisenNavigation.Client
             return SendPathRequest(MessageType.RandomPath, mapId, start, end, flags);
         }
 
+        /// <summary>
+        /// Find a path with randomized waypoints that never leaves a region, see
+        /// <see cref="GetPath(int, Vector3, Vector3, Vector3[], PathFlags)"/>. Returns null on failure.
+        /// </summary>
+        public Vector3[]? GetRandomPath(int mapId, Vector3 start, Vector3 end, Vector3[] region, PathFlags flags = PathFlags.None)
+        {
+            return SendPathRequest(MessageType.RandomPath, mapId, start, end, flags, region);
+        }
+
+        /// <summary>
+        /// Find a path along an ordered list of waypoints (patrol and gather routes) in a single request.
+        /// Smoothing and validation are applied once over the whole route. The route ends early if a
+        /// waypoint is not reachable. Returns null on failure.
+        /// </summary>
+        public Vector3[]? GetMultiPath(int mapId, Vector3[] waypoints, PathFlags flags = PathFlags.None)
+        {
+            if (waypoints.Length < 2 || waypoints.Length > MaxMultiPathWaypoints)
+                throw new ArgumentOutOfRangeException(nameof(waypoints), $"2 to {MaxMultiPathWaypoints} waypoints are supported");
+
+            lock (_lock)
+            {
+                return SendWithReconnect<Vector3[]?>(() =>
+                {
+                    // Wire format: [mapId(4)][flags(4)][count(4)][waypoints: Vector3(12) × N]
+                    const int headerSize = 12;
+                    byte[] buffer = new byte[headerSize + waypoints.Length * 12];
+
+                    BitConverter.GetBytes(mapId).CopyTo(buffer, 0);
+                    BitConverter.GetBytes((int)flags).CopyTo(buffer, 4);
+                    BitConverter.GetBytes(waypoints.Length).CopyTo(buffer, 8);
+                    MemoryMarshal.AsBytes(waypoints.AsSpan()).CopyTo(buffer.AsSpan(headerSize));
+
+                    var points = _client.SendBytes((byte)MessageType.PathMulti, buffer).AsArray<Vector3>();
+                    if (points.Length == 0) return null;
+
+                    // Server returns a single zero vector on failure
+                    if (points.Length == 1 && points[0].IsZero) return null;
+
+                    return points;
+                }, null);
+            }
+        }
+
+        /// <summary>
+        /// Get the walking cost and length from start to each target with a single search on the server,
+        /// useful to rank candidate targets. Lengths follow the straight path if straightLengths is set,
+        /// otherwise the cheaper poly corridor estimate. Returns null on failure.
+        /// </summary>
+        public PathCost[]? GetPathCosts(int mapId, Vector3 start, Vector3[] targets, bool straightLengths = false)
+        {
+            if (targets.Length == 0 || targets.Length > MaxPathCostTargets)
+                throw new ArgumentOutOfRangeException(nameof(targets), $"1 to {MaxPathCostTargets} targets are supported");
+
+            lock (_lock)
+            {
+                return SendWithReconnect<PathCost[]?>(() =>
+                {
+                    // Wire format: [mapId(4)][flags(4)][start(12)][count(4)][targets: Vector3(12) × N]
+                    const int headerSize = 24;
+                    byte[] buffer = new byte[headerSize + targets.Length * 12];
+
+                    BitConverter.GetBytes(mapId).CopyTo(buffer, 0);
+                    BitConverter.GetBytes(straightLengths ? 1 : 0).CopyTo(buffer, 4);
+                    MemoryMarshal.Write(buffer.AsSpan(8), in start);
+                    BitConverter.GetBytes(targets.Length).CopyTo(buffer, 20);
+                    MemoryMarshal.AsBytes(targets.AsSpan()).CopyTo(buffer.AsSpan(headerSize));
+
+                    var costs = _client.SendBytes((byte)MessageType.PathCosts, buffer).AsArray<PathCost>();
+                    return costs.Length == targets.Length ? costs : null;
+                }, null);
+            }
+        }
+
+        /// <summary>
+        /// Find a path to whichever goal is closest by walking distance, e.g. the nearest of several flight
+        /// masters. goalIndex is the index of the chosen goal. Only smoothing and validation flags apply.
+        /// Returns null on failure.
+        /// </summary>
+        public Vector3[]? GetPathToNearest(int mapId, Vector3 start, Vector3[] goals, out int goalIndex,
+                                           PathFlags flags = PathFlags.None)
+        {
+            if (goals.Length == 0 || goals.Length > MaxPathToNearestGoals)
+                throw new ArgumentOutOfRangeException(nameof(goals), $"1 to {MaxPathToNearestGoals} goals are supported");
+
+            lock (_lock)
+            {
+                int index = -1;
+                var points = SendWithReconnect<Vector3[]?>(() =>
+                {
+                    // Wire format: [mapId(4)][flags(4)][start(12)][count(4)][goals: Vector3(12) × N]
+                    const int headerSize = 24;
+                    byte[] buffer = new byte[headerSize + goals.Length * 12];
+
+                    BitConverter.GetBytes(mapId).CopyTo(buffer, 0);
+                    BitConverter.GetBytes((int)flags).CopyTo(buffer, 4);
+                    MemoryMarshal.Write(buffer.AsSpan(8), in start);
+                    BitConverter.GetBytes(goals.Length).CopyTo(buffer, 20);
+                    MemoryMarshal.AsBytes(goals.AsSpan()).CopyTo(buffer.AsSpan(headerSize));
+
+                    var data = _client.SendBytes((byte)MessageType.PathToNearest, buffer).Data;
+
+                    // Response: goalIndex(4) + Vector3(12) × N, a single zero vector on failure
+                    if (data.Length < 4 + 12 || (data.Length - 4) % 12 != 0) return null;
+
+                    index = BitConverter.ToInt32(data.Slice(0, 4));
+                    return MemoryMarshal.Cast<byte, Vector3>(data.Slice(4)).ToArray();
+                }, null);
+
+                goalIndex = points != null ? index : -1;
+                return points;
+            }
+        }
+
+        /// <summary>
+        /// Check whether end can be reached from start with a path cost of at most maxCost (equal to the
+        /// walking distance on areas with cost 1). The server stops searching at the bound, so failing checks
+        /// are cheap. cost is the path cost if reachable, -1 otherwise.
+        /// </summary>
+        public bool IsReachableWithin(int mapId, Vector3 start, Vector3 end, float maxCost, out float cost)
+        {
+            lock (_lock)
+            {
+                var request = new ReachableWithinData { MapId = mapId, Start = start, End = end, MaxCost = maxCost };
+                cost = SendWithReconnect(
+                    () => _client.Send((byte)MessageType.ReachableWithin, request).As<float>(),
+                    -1.0f
+                );
+
+                return cost >= 0;
+            }
+        }
+
+        /// <summary>
+        /// Plan a route from start on startMapId to end on endMapId over the portals, boats and zeppelins the server
+        /// loaded from its transports file. Returns the walking and transport legs in order, null if there is no route.
+        /// Walking legs only carry their endpoints, request their path with <see cref="GetPath(int, Vector3, Vector3, PathFlags)"/>
+        /// when getting to them.
+        /// </summary>
+        public RouteLeg[]? GetCrossMapRoute(int startMapId, Vector3 start, int endMapId, Vector3 end, out float totalCost)
+        {
+            lock (_lock)
+            {
+                float cost = -1.0f;
+                var legs = SendWithReconnect<RouteLeg[]?>(() =>
+                {
+                    var request = new PathCrossMapRequestData
+                    {
+                        StartMapId = startMapId,
+                        Start = start,
+                        EndMapId = endMapId,
+                        End = end,
+                    };
+
+                    var data = _client.Send((byte)MessageType.PathCrossMap, request).Data;
+
+                    // Header: legCount(4) + totalCost(4), followed by the legs
+                    if (data.Length < 8) return null;
+
+                    int legCount = BitConverter.ToInt32(data.Slice(0, 4));
+                    int legSize = Marshal.SizeOf<RouteLeg>();
+
+                    if (legCount <= 0 || data.Length < 8 + legCount * legSize) return null;
+
+                    cost = BitConverter.ToSingle(data.Slice(4, 4));
+                    return MemoryMarshal.Cast<byte, RouteLeg>(data.Slice(8, legCount * legSize)).ToArray();
+                }, null);
+
+                totalCost = cost;
+                return legs;
+            }
+        }
+
+        /// <summary>
+        /// Get the next corners from position towards target on this client's persistent path. Call it every
+        /// tick while chasing a moving target: the server only adjusts the path it kept from the previous call
+        /// and searches a new one when it became invalid or either end moved too far. The first corner is the
+        /// next steering target. Returns null on failure.
+        /// </summary>
+        public Vector3[]? UpdatePathSession(int mapId, Vector3 position, Vector3 target, int maxCorners = 4,
+                                            PathFlags flags = PathFlags.None)
+        {
+            lock (_lock)
+            {
+                return SendWithReconnect(() =>
+                {
+                    var request = new PathSessionRequestData
+                    {
+                        MapId = mapId,
+                        Flags = (int)flags,
+                        Position = position,
+                        Target = target,
+                        MaxCorners = maxCorners,
+                    };
+
+                    var points = _client.Send((byte)MessageType.PathSession, request).AsArray<Vector3>();
+                    if (points.Length == 0) return null;
+
+                    // Server returns a single zero vector on failure
+                    if (points.Length == 1 && points[0].IsZero) return null;
+
+                    return points;
+                }, null);
+            }
+        }
+
         /// <summary>
         /// Move along the navmesh surface by a small delta. Useful for preventing
         /// falling off edges during incremental movement.
@@ -243,7 +481,127 @@ namespace AmeisenNavigation.Client
                     if (pathLen > 0 && data.Length >= 12 + pathLen)
                         meshesPath = System.Text.Encoding.UTF8.GetString(data.Slice(12, pathLen));
 
-                    return new ServerConfig(mmapFormat, useAnp, meshesPath);
+                    // After the path: mapCount(4) + mapCount * (mapId(4) + state(4)), missing on older servers
+                    var mapStates = new Dictionary<int, MapLoadState>();
+                    int offset = 12 + Math.Max(pathLen, 0);
+
+                    if (data.Length >= offset + 4)
+                    {
+                        int mapCount = BitConverter.ToInt32(data.Slice(offset, 4));
+                        offset += 4;
+
+                        for (int i = 0; i < mapCount && data.Length >= offset + 8; ++i, offset += 8)
+                        {
+                            mapStates[BitConverter.ToInt32(data.Slice(offset, 4))] =
+                                (MapLoadState)BitConverter.ToInt32(data.Slice(offset + 4, 4));
+                        }
+                    }
+
+                    return new ServerConfig(mmapFormat, useAnp, meshesPath, mapStates);
+                }, null);
+            }
+        }
+
+        /// <summary>
+        /// Make the server build a loaded map again from its files, after it got exported again, and swap it in.
+        /// The server builds it in the background, connected clients keep working on the previous navmesh until then.
+        /// Returns false if the map is not loaded, its reload is already queued or the server's iMapAdminAccess does
+        /// not allow this client to reload maps, failed builds are only logged by the server.
+        /// </summary>
+        public bool ReloadMap(int mapId)
+        {
+            lock (_lock)
+            {
+                return SendWithReconnect(
+                    () => _client.Send((byte)MessageType.ReloadMap, mapId).As<int>() != 0,
+                    false
+                );
+            }
+        }
+
+        /// <summary>
+        /// Make the server free a map, the next request for it loads it again. Clients that used the map let go of
+        /// it with their next request. Returns false if the map is not loaded or the server's iMapAdminAccess does not
+        /// allow this client to unload maps.
+        /// </summary>
+        public bool UnloadMap(int mapId)
+        {
+            lock (_lock)
+            {
+                return SendWithReconnect(
+                    () => _client.Send((byte)MessageType.UnloadMap, mapId).As<int>() != 0,
+                    false
+                );
+            }
+        }
+
+        /// <summary>
+        /// Wait until the server can answer requests for a map, polling <see cref="GetConfig"/>.
+        /// Returns false if the map failed to load or is still loading after the timeout.
+        /// Maps that are neither preloaded nor queried yet are loaded by their first request and do not need to be waited for.
+        /// </summary>
+        public bool WaitForMap(int mapId, TimeSpan timeout, int pollIntervalMs = 250)
+        {
+            var deadline = DateTime.UtcNow + timeout;
+
+            while (true)
+            {
+                var state = GetConfig()?.GetMapState(mapId);
+
+                if (state is MapLoadState.NotLoaded or MapLoadState.Indexing or MapLoadState.Ready)
+                    return true;
+
+                if (state == MapLoadState.Failed || DateTime.UtcNow >= deadline)
+                    return false;
+
+                Thread.Sleep(pollIntervalMs);
+            }
+        }
+
+        /// <summary>
+        /// Get runtime statistics of the server (path cache usage, memory of the loaded maps). Returns null on failure.
+        /// </summary>
+        public ServerStats? GetStats()
+        {
+            lock (_lock)
+            {
+                return SendWithReconnect<ServerStats?>(() =>
+                {
+                    var response = _client.SendBytes((byte)MessageType.GetStats, ReadOnlySpan<byte>.Empty);
+                    var data = response.Data;
+
+                    // pathCacheHits(8) + pathCacheMisses(8) + pathCacheCoalesced(8) + pathCacheEntries(8)
+                    // + flowFieldHits(8) + flowFieldCount(8)
+                    if (data.Length < 48) return null;
+
+                    // After the stats: mapCount(4) + mapCount * (mapId(4) + reserved(4) + navMeshBytes(8)
+                    // + indexBytes(8) + idleSeconds(8)), missing on older servers
+                    var maps = new List<MapMemoryUsage>();
+                    int offset = 48;
+
+                    if (data.Length >= offset + 4)
+                    {
+                        int mapCount = BitConverter.ToInt32(data.Slice(offset, 4));
+                        offset += 4;
+
+                        for (int i = 0; i < mapCount && data.Length >= offset + 32; ++i, offset += 32)
+                        {
+                            maps.Add(new MapMemoryUsage(
+                                BitConverter.ToInt32(data.Slice(offset, 4)),
+                                BitConverter.ToUInt64(data.Slice(offset + 8, 8)),
+                                BitConverter.ToUInt64(data.Slice(offset + 16, 8)),
+                                TimeSpan.FromSeconds(BitConverter.ToInt64(data.Slice(offset + 24, 8)))));
+                        }
+                    }
+
+                    return new ServerStats(
+                        BitConverter.ToUInt64(data.Slice(0, 8)),
+                        BitConverter.ToUInt64(data.Slice(8, 8)),
+                        BitConverter.ToUInt64(data.Slice(16, 8)),
+                        BitConverter.ToUInt64(data.Slice(24, 8)),
+                        BitConverter.ToUInt64(data.Slice(32, 8)),
+                        BitConverter.ToUInt64(data.Slice(40, 8)),
+                        maps);
                 }, null);
             }
         }
@@ -369,8 +727,12 @@ namespace AmeisenNavigation.Client
 
         // ── Internals ───────────────────────────────────────────────────
 
-        private Vector3[]? SendPathRequest(MessageType type, int mapId, Vector3 start, Vector3 end, PathFlags flags)
+        private Vector3[]? SendPathRequest(MessageType type, int mapId, Vector3 start, Vector3 end, PathFlags flags,
+                                           Vector3[]? region = null)
         {
+            if (region != null && (region.Length < 2 || region.Length > MaxPathRegionVertices))
+                throw new ArgumentOutOfRangeException(nameof(region), $"2 to {MaxPathRegionVertices} vertices are supported");
+
             lock (_lock)
             {
                 return SendWithReconnect(() =>
@@ -378,12 +740,30 @@ namespace AmeisenNavigation.Client
                     var request = new PathRequestData
                     {
                         MapId = mapId,
-                        Flags = (int)flags,
+                        Flags = (int)(region != null ? flags | PathFlags.SearchRegion : flags & ~PathFlags.SearchRegion),
                         Start = start,
                         End = end,
                     };
 
-                    var points = _client.Send((byte)type, request).AsArray<Vector3>();
+                    Vector3[] points;
+
+                    if (region != null)
+                    {
+                        // Wire format: [PathRequestData][count(4)][vertices: Vector3(12) × N]
+                        int requestSize = Marshal.SizeOf<PathRequestData>();
+                        byte[] buffer = new byte[requestSize + 4 + region.Length * 12];
+
+                        MemoryMarshal.Write(buffer, ref request);
+                        BitConverter.GetBytes(region.Length).CopyTo(buffer, requestSize);
+                        MemoryMarshal.AsBytes(region.AsSpan()).CopyTo(buffer.AsSpan(requestSize + 4));
+
+                        points = _client.SendBytes((byte)type, buffer).AsArray<Vector3>();
+                    }
+                    else
+                    {
+                        points = _client.Send((byte)type, request).AsArray<Vector3>();
+                    }
+
                     if (points.Length == 0) return null;
 
                     // Server returns a single zero vector on failure
@@ -0,0 +1,15 @@
+namespace AmeisenNavigation.Client
+{
+    /// <summary>
+    /// Load state of a map on the server, see <see cref="ServerConfig.MapStates"/>.
+    /// Maps answer requests from <see cref="Indexing"/> on.
+    /// </summary>
+    public enum MapLoadState
+    {
+        NotLoaded = 0,
+        Loading = 1,
+        Indexing = 2,
+        Ready = 3,
+        Failed = 4,
+    }
+}
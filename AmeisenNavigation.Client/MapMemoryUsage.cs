@@ -0,0 +1,14 @@
+using System;
+
+namespace AmeisenNavigation.Client
+{
+    /// <summary>
+    /// Memory held by a loaded map on the server, see <see cref="ServerStats.Maps"/>.
+    /// NavMeshBytes counts mapped tiles with their whole size, although most of their pages are shared with the page cache.
+    /// </summary>
+    public sealed record MapMemoryUsage(int MapId, ulong NavMeshBytes, ulong IndexBytes, TimeSpan Idle)
+    {
+        /// <summary>Navmesh and search indexes together.</summary>
+        public ulong TotalBytes => NavMeshBytes + IndexBytes;
+    }
+}
@@ -0,0 +1,19 @@
+using System.Runtime.InteropServices;
+
+namespace AmeisenNavigation.Client
+{
+    /// <summary>
+    /// Walking cost and length to one target of <see cref="AmeisenNavClient.GetPathCosts"/>.
+    /// Both are negative if the target is not reachable.
+    /// </summary>
+    [StructLayout(LayoutKind.Sequential)]
+    public readonly struct PathCost
+    {
+        public readonly float Cost;
+        public readonly float Length;
+
+        public bool IsReachable => Cost >= 0;
+
+        public override string ToString() => IsReachable ? $"cost {Cost:F2}, length {Length:F2}" : "unreachable";
+    }
+}
@@ -15,5 +15,8 @@ namespace AmeisenNavigation.Client
         SmoothBezier = 1 << 2,
         ValidateClosestPointOnPoly = 1 << 3,
         ValidateMoveAlongSurface = 1 << 4,
+        SearchLandmarks = 1 << 5,
+        SearchHierarchical = 1 << 6,
+        SearchRegion = 1 << 8,
     }
 }
@@ -0,0 +1,25 @@
+using System.Runtime.InteropServices;
+
+namespace AmeisenNavigation.Client
+{
+    /// <summary>
+    /// One leg of a route returned by <see cref="AmeisenNavClient.GetCrossMapRoute"/>.
+    /// Walking legs stay on MapId, transport legs go from the departure on MapId to the arrival on EndMapId.
+    /// </summary>
+    [StructLayout(LayoutKind.Sequential)]
+    public readonly struct RouteLeg
+    {
+        /// <summary>Id of the transport from the server's transports file, -1 for walking legs.</summary>
+        public readonly int TransportId;
+        public readonly int MapId;
+        public readonly Vector3 Start;
+        public readonly int EndMapId;
+        public readonly Vector3 End;
+        public readonly float Cost;
+
+        public bool IsWalking => TransportId < 0;
+
+        public override string ToString()
+            => IsWalking ? $"walk on {MapId}: {Start} -> {End}" : $"transport {TransportId}: {MapId} {Start} -> {EndMapId} {End}";
+    }
+}
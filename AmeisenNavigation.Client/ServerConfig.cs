@@ -1,7 +1,16 @@
+using System.Collections.Generic;
+
 namespace AmeisenNavigation.Client
 {
     /// <summary>
     /// Server configuration returned by <see cref="AmeisenNavClient.GetConfig"/>.
+    /// MapStates contains every map the server preloaded or was queried for.
     /// </summary>
-    public sealed record ServerConfig(int MmapFormat, bool UseAnpFileFormat, string MeshesPath);
+    public sealed record ServerConfig(int MmapFormat, bool UseAnpFileFormat, string MeshesPath,
+                                      IReadOnlyDictionary<int, MapLoadState> MapStates)
+    {
+        /// <summary>Load state of a map, <see cref="MapLoadState.NotLoaded"/> if the server does not know it yet.</summary>
+        public MapLoadState GetMapState(int mapId)
+            => MapStates.TryGetValue(mapId, out var state) ? state : MapLoadState.NotLoaded;
+    }
 }
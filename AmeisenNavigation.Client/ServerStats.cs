@@ -0,0 +1,23 @@
+using System.Collections.Generic;
+
+namespace AmeisenNavigation.Client
+{
+    /// <summary>
+    /// Runtime statistics returned by <see cref="AmeisenNavClient.GetStats"/>.
+    /// Maps contains every loaded map, ordered by map id.
+    /// </summary>
+    public sealed record ServerStats(ulong PathCacheHits, ulong PathCacheMisses, ulong PathCacheCoalesced,
+                                     ulong PathCacheEntries, ulong FlowFieldHits, ulong FlowFieldCount,
+                                     IReadOnlyList<MapMemoryUsage> Maps)
+    {
+        /// <summary>Share of path requests that did not need their own search (cache hits and coalesced requests).</summary>
+        public double PathCacheHitRatio
+        {
+            get
+            {
+                ulong total = PathCacheHits + PathCacheMisses + PathCacheCoalesced;
+                return total > 0 ? (double)(PathCacheHits + PathCacheCoalesced) / total : 0.0;
+            }
+        }
+    }
+}
@@ -35,6 +35,34 @@ namespace AmeisenNavigation.Client
         public float Radius;
     }
 
+    [StructLayout(LayoutKind.Sequential)]
+    internal struct PathSessionRequestData
+    {
+        public int MapId;
+        public int Flags;
+        public Vector3 Position;
+        public Vector3 Target;
+        public int MaxCorners;
+    }
+
+    [StructLayout(LayoutKind.Sequential)]
+    internal struct PathCrossMapRequestData
+    {
+        public int StartMapId;
+        public Vector3 Start;
+        public int EndMapId;
+        public Vector3 End;
+    }
+
+    [StructLayout(LayoutKind.Sequential)]
+    internal struct ReachableWithinData
+    {
+        public int MapId;
+        public Vector3 Start;
+        public Vector3 End;
+        public float MaxCost;
+    }
+
     [StructLayout(LayoutKind.Sequential)]
     internal struct GetHeightData
     {
@@ -18,6 +18,8 @@ int main(int argc, char** argv)
     int targetMapId = -1;
     int targetTileX = -1;
     int targetTileY = -1;
+    bool writeZip = true;
+    bool writeContainer = true;
 
     for (int i = 1; i < argc; ++i)
     {
@@ -35,6 +37,14 @@ int main(int argc, char** argv)
             try { targetMapId = std::stoi(std::string(argv[++i])); }
             catch (...) { LogE("Invalid --map value: ", argv[i]); return 1; }
         }
+        else if ((arg == "--format" || arg == "-f") && i + 1 < argc)
+        {
+            std::string format = argv[++i];
+            writeZip = format == "anp" || format == "both";
+            writeContainer = format == "anp2" || format == "both";
+
+            if (!writeZip && !writeContainer) { LogE("Invalid --format value: ", format); return 1; }
+        }
         else if ((arg == "--tile" || arg == "-t") && i + 1 < argc)
         {
             std::string tileStr = argv[++i];
@@ -55,7 +65,7 @@ int main(int argc, char** argv)
     {
         LogE("Missing required arguments.");
         LogI("Usage: AmeisenNavigation.Exporter.exe --wow <path> --output "
-             "<path> [--map <id>] [--tile x,y]");
+             "<path> [--map <id>] [--tile x,y] [--format anp|anp2|both]");
         LogI("Example: AmeisenNavigation.Exporter.exe -w \"C:\\WoW\" -o "
              "\"C:\\Out\" -m 0 -t 32,48");
         return 1;
@@ -394,9 +404,20 @@ int main(int argc, char** argv)
                 tileProcessor.Process(&mapGeometry, &waterMap, &roadMap, &factionMap, &cityMap);
                 STOP_TIMER(startTimeNavmesh, std::format("[{}] Building navmesh took", mapName));
 
-                LogI(std::format("[{}] Saving {}/{:03}.anp...", mapName, outputDir, mapId));
-                anp.Save(outputDir.c_str());
-                LogS(std::format("[{}] Saved navmesh to {}/{:03}.anp", mapName, outputDir, mapId));
+                if (writeZip)
+                {
+                    LogI(std::format("[{}] Saving {}/{:03}.anp...", mapName, outputDir, mapId));
+                    anp.Save(outputDir.c_str());
+                    LogS(std::format("[{}] Saved navmesh to {}/{:03}.anp", mapName, outputDir, mapId));
+                }
+
+                // uncompressed container with page aligned tiles, mapped by the server instead of extracted
+                if (writeContainer)
+                {
+                    LogI(std::format("[{}] Saving {}/{:03}.anp2...", mapName, outputDir, mapId));
+                    anp.SaveContainer(outputDir.c_str());
+                    LogS(std::format("[{}] Saved navmesh to {}/{:03}.anp2", mapName, outputDir, mapId));
+                }
             }
 
             STOP_TIMER(startTimeTile, std::format("Parsing Map context [{}] took", mapName));
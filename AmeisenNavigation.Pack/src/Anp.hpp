@@ -1,17 +1,24 @@
 #pragma once
 
+#include <algorithm>
 #include <cstdio>
 #include <filesystem>
 #include <format>
 #include <fstream>
+#include <memory>
 #include <mutex>
+#include <vector>
 
 #include "../../AmeisenNavigation/src/Utils/Logger.hpp"
+#include "../../AmeisenNavigation/src/Utils/MappedFile.hpp"
+#include "../../AmeisenNavigation/src/Utils/TileArena.hpp"
 
 #include "../../../recastnavigation/Detour/Include/DetourNavMesh.h"
 #include "../../../recastnavigation/Detour/Include/DetourCommon.h"
 #include "miniz/miniz.h"
 
+#include "AnpContainer.hpp"
+
 /// WoW's tile grid dimension (64x64 tiles per map).
 constexpr int WOW_TILE_GRID_SIZE = 64;
 
@@ -23,6 +30,13 @@ class Anp
     mz_zip_archive Zip;
     std::mutex Mutex;
 
+    // backs the tiles if the map was loaded from an .anp2 container, it is unmapped after the destructor
+    // freed the navmesh
+    std::unique_ptr<MappedFile> Container;
+
+    // holds the tiles extracted from an .anp file, freed after the navmesh like the container
+    std::unique_ptr<TileArena> Arena;
+
 public:
     /// Create a new pack for the given map with the specified navmesh params.
     Anp(int mapId, const dtNavMeshParams& params) noexcept
@@ -34,10 +48,18 @@ public:
         mz_zip_writer_add_mem(&Zip, "params", &params, sizeof(dtNavMeshParams), MZ_DEFAULT_COMPRESSION);
     }
 
-    /// Load an existing .anp file from disk.
+    /// Load an existing .anp file, or an .anp2 container, from disk.
     explicit Anp(const char* anpFilePath) noexcept
         : MapId(-1), Navmesh{dtAllocNavMesh()}, NavmeshParams{0}, Zip{0}, Mutex()
     {
+        if (auto container = std::make_unique<MappedFile>(anpFilePath);
+            container->IsOpen() && container->GetSize() >= sizeof(AnpContainerHeader)
+            && reinterpret_cast<const AnpContainerHeader*>(container->GetData())->Magic == ANP_CONTAINER_MAGIC)
+        {
+            LoadContainer(std::move(container), anpFilePath);
+            return;
+        }
+
         if (!mz_zip_reader_init_file(&Zip, anpFilePath, 0))
         {
             LogE("Failed to open .anp file: ", anpFilePath);
@@ -63,64 +85,127 @@ public:
             return;
         }
 
+        // one pass over the central directory instead of a name lookup for every slot of the grid
+        struct TileEntry
+        {
+            mz_uint FileIndex;
+            int X;
+            int Y;
+            size_t Size; // uncompressed
+        };
+
+        std::vector<TileEntry> tileEntries;
+
+        for (mz_uint i = 0; i < mz_zip_reader_get_num_files(&Zip); ++i)
+        {
+            char fileName[16];
+            int x = 0;
+            int y = 0;
+
+            mz_zip_archive_file_stat stat{};
+
+            if (mz_zip_reader_get_filename(&Zip, i, fileName, sizeof(fileName)) == sizeof("00_00")
+                && ParseTileName(fileName, x, y)
+                && x < WOW_TILE_GRID_SIZE && y < WOW_TILE_GRID_SIZE
+                && mz_zip_reader_file_stat(&Zip, i, &stat))
+            {
+                tileEntries.push_back(TileEntry{ i, x, y, static_cast<size_t>(stat.m_uncomp_size) });
+            }
+        }
+
+        // the tiles are extracted into one block, neighbouring tiles next to each other
+        std::sort(tileEntries.begin(), tileEntries.end(), [](const TileEntry& a, const TileEntry& b)
+        {
+            return GetTileOrder(a.X, a.Y) < GetTileOrder(b.X, b.Y);
+        });
+
+        std::vector<size_t> tileSizes;
+        tileSizes.reserve(tileEntries.size());
+
+        for (const TileEntry& entry : tileEntries)
+            tileSizes.push_back(entry.Size);
+
+        Arena = std::make_unique<TileArena>(tileSizes);
+
+        if (!Arena->IsAllocated())
+        {
+            LogW("Failed to allocate ", tileSizes.size(), " tiles in one block, allocating them one by one: ",
+                 anpFilePath);
+            Arena.reset();
+        }
+
         int tilesLoaded = 0;
-        for (int i = 0; i < WOW_TILE_GRID_SIZE * WOW_TILE_GRID_SIZE; i++)
+
+        // extracts into the arena slot of the tile, or onto the heap without an arena, nullptr on failure
+        const auto extractTile = [this](mz_zip_archive& zip, int i, const TileEntry& entry, size_t& size) -> void*
         {
-            auto x = i % WOW_TILE_GRID_SIZE;
-            auto y = i / WOW_TILE_GRID_SIZE;
+            if (!Arena)
+                return mz_zip_reader_extract_to_heap(&zip, entry.FileIndex, &size, 0);
+
+            void* slot = Arena->GetTile(i);
+            return mz_zip_reader_extract_to_mem(&zip, entry.FileIndex, slot, size, 0) ? slot : nullptr;
+        };
 
-            char tileName[8];
-            snprintf(tileName, sizeof(tileName), "%02d_%02d", x, y);
-            auto fileIndex = mz_zip_reader_locate_file(&Zip, tileName, 0, 0);
+        // a miniz reader must not be shared between threads, every thread opens its own one on the file and
+        // only adding the tiles to the navmesh is serialised
+#pragma omp parallel
+        {
+            mz_zip_archive threadZip{};
+            const bool threadZipOk = mz_zip_reader_init_file(&threadZip, anpFilePath, 0);
 
-            if (fileIndex > -1)
+            if (!threadZipOk)
+                LogW("Failed to open .anp file for a loader thread, extracting its tiles one at a time: ", anpFilePath);
+
+#pragma omp for schedule(dynamic)
+            for (int i = 0; i < static_cast<int>(tileEntries.size()); ++i)
             {
-                size_t allocSize = 0;
-                void* navMeshData = mz_zip_reader_extract_to_heap(&Zip, fileIndex, &allocSize, 0);
-                if (navMeshData)
+                const TileEntry& entry = tileEntries[i];
+                size_t allocSize = entry.Size;
+                void* navMeshData = nullptr;
+
+                if (threadZipOk)
                 {
-                    // Validate tile data size against header before passing to Detour.
-                    // addTile doesn't verify dataSize >= header-claimed layout, which can
-                    // cause Detour to set up internal pointers past the buffer.
-                    bool sizeOk = false;
-                    if (allocSize >= sizeof(dtMeshHeader))
-                    {
-                        const auto* hdr = reinterpret_cast<const dtMeshHeader*>(navMeshData);
-                        if (hdr->magic == DT_NAVMESH_MAGIC && hdr->version == DT_NAVMESH_VERSION)
-                        {
-                            const int headerSize = dtAlign4(static_cast<int>(sizeof(dtMeshHeader)));
-                            const int vertsSize = dtAlign4(static_cast<int>(sizeof(float)) * 3 * hdr->vertCount);
-                            const int polysSize = dtAlign4(static_cast<int>(sizeof(dtPoly)) * hdr->polyCount);
-                            const int linksSize = dtAlign4(static_cast<int>(sizeof(dtLink)) * hdr->maxLinkCount);
-                            const int detailMeshesSize = dtAlign4(static_cast<int>(sizeof(dtPolyDetail)) * hdr->detailMeshCount);
-                            const int detailVertsSize = dtAlign4(static_cast<int>(sizeof(float)) * 3 * hdr->detailVertCount);
-                            const int detailTrisSize = dtAlign4(static_cast<int>(sizeof(unsigned char)) * 4 * hdr->detailTriCount);
-                            const int bvTreeSize = dtAlign4(static_cast<int>(sizeof(dtBVNode)) * hdr->bvNodeCount);
-                            const int offMeshSize = dtAlign4(static_cast<int>(sizeof(dtOffMeshConnection)) * hdr->offMeshConCount);
-
-                            const int64_t totalRequired = static_cast<int64_t>(headerSize) + vertsSize + polysSize
-                                + linksSize + detailMeshesSize + detailVertsSize + detailTrisSize + bvTreeSize + offMeshSize;
-
-                            sizeOk = (totalRequired > 0 && static_cast<int64_t>(allocSize) >= totalRequired);
-                            if (!sizeOk)
-                            {
-                                LogE("ANP tile ", x, "_", y, " data too small: ",
-                                     allocSize, " < ", totalRequired, " (header claims)");
-                            }
-                        }
-                    }
+                    navMeshData = extractTile(threadZip, i, entry, allocSize);
+                }
+                else
+                {
+#pragma omp critical(sharedAnpZip)
+                    navMeshData = extractTile(Zip, i, entry, allocSize);
+                }
+
+                if (!navMeshData)
+                {
+                    LogW("Failed to extract tile ", entry.X, "_", entry.Y, " from .anp file: ", anpFilePath);
+                    continue;
+                }
+
+                // tiles in the arena are freed with it, the navmesh must not free them
+                const int tileFlags = Arena ? 0 : DT_TILE_FREE_DATA;
 
-                    if (sizeOk && dtStatusSucceed(Navmesh->addTile(reinterpret_cast<unsigned char*>(navMeshData),
-                                                                    static_cast<int>(allocSize), DT_TILE_FREE_DATA, 0, 0)))
+                if (!IsTileDataValid(navMeshData, allocSize, entry.X, entry.Y))
+                {
+                    if (tileFlags)
+                        mz_free(navMeshData);
+
+                    continue;
+                }
+
+#pragma omp critical(addAnpTile)
+                {
+                    if (dtStatusSucceed(Navmesh->addTile(reinterpret_cast<unsigned char*>(navMeshData),
+                                                         static_cast<int>(allocSize), tileFlags, 0, 0)))
                     {
                         tilesLoaded++;
                     }
-                    else
+                    else if (tileFlags)
                     {
                         mz_free(navMeshData);
                     }
                 }
             }
+
+            if (threadZipOk)
+                mz_zip_reader_end(&threadZip);
         }
 
         LogI("Loaded .anp: mapId=", MapId, ", tiles=", tilesLoaded);
@@ -189,5 +274,246 @@ public:
         }
     }
 
+    /// Write the tiles of the navmesh to an uncompressed .anp2 container, the runtime alternative to Save.
+    inline bool SaveContainer(const char* outputDir)
+    {
+        const std::lock_guard lock(Mutex);
+
+        try
+        {
+            AnpContainerHeader header{};
+            header.Magic = ANP_CONTAINER_MAGIC;
+            header.Version = ANP_CONTAINER_VERSION;
+            header.MapId = MapId;
+            header.Alignment = ANP_CONTAINER_ALIGNMENT;
+            header.Params = NavmeshParams;
+            header.SideTableCount = 0;
+            header.LayerCount = 1;
+
+            std::vector<const dtMeshTile*> stored;
+
+            for (int i = 0; i < Navmesh->getMaxTiles(); ++i)
+            {
+                const dtMeshTile* tile = static_cast<const dtNavMesh*>(Navmesh)->getTile(i);
+
+                if (!tile || !tile->header)
+                    continue;
+
+                const dtMeshHeader* tileHeader = tile->header;
+
+                if (tileHeader->x < 0 || tileHeader->x >= ANP_CONTAINER_GRID_SIZE || tileHeader->y < 0
+                    || tileHeader->y >= ANP_CONTAINER_GRID_SIZE || tileHeader->layer < 0
+                    || tileHeader->layer >= ANP_CONTAINER_MAX_LAYERS)
+                {
+                    LogW("Tile ", tileHeader->x, "_", tileHeader->y, " layer ", tileHeader->layer,
+                         " of mapId=", MapId, " is outside of the .anp2 tile table, it is not written");
+                    continue;
+                }
+
+                header.LayerCount = std::max(header.LayerCount, static_cast<unsigned int>(tileHeader->layer) + 1);
+                stored.push_back(tile);
+            }
+
+            std::vector<AnpContainerTile> tiles(static_cast<size_t>(ANP_CONTAINER_GRID_SIZE) * ANP_CONTAINER_GRID_SIZE
+                                                * header.LayerCount);
+            std::vector<const dtMeshTile*> tileData(tiles.size());
+            unsigned long long offset = GetAnpContainerDataOffset(header.LayerCount, header.SideTableCount);
+
+            const auto allocate = [&offset](unsigned long long size) noexcept
+            {
+                const unsigned long long blobOffset = offset;
+                offset += (size + ANP_CONTAINER_ALIGNMENT - 1) / ANP_CONTAINER_ALIGNMENT * ANP_CONTAINER_ALIGNMENT;
+                return blobOffset;
+            };
+
+            for (const dtMeshTile* tile : stored)
+            {
+                const size_t slot = (tile->header->x + tile->header->y * ANP_CONTAINER_GRID_SIZE)
+                    * static_cast<size_t>(header.LayerCount) + tile->header->layer;
+
+                // Detour refuses to add a second tile at the same location and layer, only a broken navmesh has one
+                if (tileData[slot])
+                {
+                    LogW("Tile ", tile->header->x, "_", tile->header->y, " layer ", tile->header->layer,
+                         " of mapId=", MapId, " exists twice, only the first one is written");
+                    continue;
+                }
+
+                tileData[slot] = tile;
+                ++header.TileCount;
+            }
+
+            // the blobs are written in slot order, their offsets have to grow in the same order
+            for (size_t slot = 0; slot < tiles.size(); ++slot)
+            {
+                if (tileData[slot])
+                {
+                    tiles[slot].Size = static_cast<unsigned int>(tileData[slot]->dataSize);
+                    tiles[slot].Offset = allocate(tileData[slot]->dataSize);
+                }
+            }
+
+            std::filesystem::path outputPath(outputDir);
+            outputPath.append(std::format("{:03}.anp2", MapId));
+
+            // a running server maps the container, the new one is written next to it and renamed over it
+            std::filesystem::path tempPath(outputPath);
+            tempPath += ".tmp";
+
+            std::ofstream file(tempPath, std::ios::binary);
+
+            if (!file.is_open())
+            {
+                LogE("Failed to open output file: ", tempPath.string());
+                return false;
+            }
+
+            const auto pad = [&file](unsigned long long position)
+            {
+                while (static_cast<unsigned long long>(file.tellp()) < position)
+                    file.put(0);
+            };
+
+            file.write(reinterpret_cast<const char*>(&header), sizeof(header));
+            file.write(reinterpret_cast<const char*>(tiles.data()), tiles.size() * sizeof(AnpContainerTile));
+
+            for (size_t i = 0; i < tiles.size(); ++i)
+            {
+                if (tileData[i])
+                {
+                    pad(tiles[i].Offset);
+                    file.write(reinterpret_cast<const char*>(tileData[i]->data), tiles[i].Size);
+                }
+            }
+
+            pad(offset);
+            file.close();
+
+            if (!file)
+            {
+                std::filesystem::remove(tempPath);
+                return false;
+            }
+
+            std::filesystem::rename(tempPath, outputPath);
+            return true;
+        }
+        catch (const std::exception& e)
+        {
+            LogE("Failed to save .anp2 for mapId=", MapId, ": ", e.what());
+            return false;
+        }
+    }
+
 private:
+    /// Grid position of a tile entry, named "xx_yy" with two digits each. False for every other entry.
+    static bool ParseTileName(const char* name, int& x, int& y) noexcept
+    {
+        const auto isDigit = [](char c) { return c >= '0' && c <= '9'; };
+
+        if (!isDigit(name[0]) || !isDigit(name[1]) || name[2] != '_' || !isDigit(name[3]) || !isDigit(name[4])
+            || name[5] != '\0')
+        {
+            return false;
+        }
+
+        x = (name[0] - '0') * 10 + (name[1] - '0');
+        y = (name[3] - '0') * 10 + (name[4] - '0');
+        return true;
+    }
+
+    /// Check the tile data size against its header before passing it to Detour. addTile does not verify
+    /// that the data covers the layout the header claims, which can cause Detour to set up internal pointers
+    /// past the buffer.
+    static bool IsTileDataValid(const void* data, size_t size, int x, int y) noexcept
+    {
+        if (size < sizeof(dtMeshHeader))
+            return false;
+
+        const auto* hdr = reinterpret_cast<const dtMeshHeader*>(data);
+
+        if (hdr->magic != DT_NAVMESH_MAGIC || hdr->version != DT_NAVMESH_VERSION)
+            return false;
+
+        const int headerSize = dtAlign4(static_cast<int>(sizeof(dtMeshHeader)));
+        const int vertsSize = dtAlign4(static_cast<int>(sizeof(float)) * 3 * hdr->vertCount);
+        const int polysSize = dtAlign4(static_cast<int>(sizeof(dtPoly)) * hdr->polyCount);
+        const int linksSize = dtAlign4(static_cast<int>(sizeof(dtLink)) * hdr->maxLinkCount);
+        const int detailMeshesSize = dtAlign4(static_cast<int>(sizeof(dtPolyDetail)) * hdr->detailMeshCount);
+        const int detailVertsSize = dtAlign4(static_cast<int>(sizeof(float)) * 3 * hdr->detailVertCount);
+        const int detailTrisSize = dtAlign4(static_cast<int>(sizeof(unsigned char)) * 4 * hdr->detailTriCount);
+        const int bvTreeSize = dtAlign4(static_cast<int>(sizeof(dtBVNode)) * hdr->bvNodeCount);
+        const int offMeshSize = dtAlign4(static_cast<int>(sizeof(dtOffMeshConnection)) * hdr->offMeshConCount);
+
+        const int64_t totalRequired = static_cast<int64_t>(headerSize) + vertsSize + polysSize
+            + linksSize + detailMeshesSize + detailVertsSize + detailTrisSize + bvTreeSize + offMeshSize;
+
+        if (totalRequired <= 0 || static_cast<int64_t>(size) < totalRequired)
+        {
+            LogE("ANP tile ", x, "_", y, " data too small: ", size, " < ", totalRequired, " (header claims)");
+            return false;
+        }
+
+        return true;
+    }
+
+    /// Add the tiles of an .anp2 container straight from its mapping, one table lookup per tile.
+    void LoadContainer(std::unique_ptr<MappedFile> container, const char* anpFilePath) noexcept
+    {
+        const unsigned char* data = container->GetData();
+        const size_t size = container->GetSize();
+        const auto* header = reinterpret_cast<const AnpContainerHeader*>(data);
+
+        if (header->Version != ANP_CONTAINER_VERSION || header->Alignment != ANP_CONTAINER_ALIGNMENT
+            || header->LayerCount < 1 || header->LayerCount > ANP_CONTAINER_MAX_LAYERS
+            || size < GetAnpContainerDataOffset(header->LayerCount, header->SideTableCount))
+        {
+            LogE("Unsupported or truncated .anp2 file: ", anpFilePath);
+            return;
+        }
+
+        NavmeshParams = header->Params;
+
+        if (dtStatusFailed(Navmesh->init(&NavmeshParams)))
+        {
+            LogE("Failed to init navmesh from .anp2 file: ", anpFilePath);
+            return;
+        }
+
+        MapId = header->MapId;
+
+        const auto* tiles = reinterpret_cast<const AnpContainerTile*>(header + 1);
+        const auto inFile = [size](unsigned long long offset, unsigned long long length) noexcept
+        {
+            return offset <= size && length <= size - offset;
+        };
+
+        int tilesLoaded = 0;
+
+        const int slotCount = ANP_CONTAINER_GRID_SIZE * ANP_CONTAINER_GRID_SIZE * static_cast<int>(header->LayerCount);
+
+        for (int i = 0; i < slotCount; ++i)
+        {
+            const AnpContainerTile& tile = tiles[i];
+
+            if (!tile.Size)
+                continue;
+
+            const int location = i / static_cast<int>(header->LayerCount);
+            const int x = location % ANP_CONTAINER_GRID_SIZE;
+            const int y = location / ANP_CONTAINER_GRID_SIZE;
+            unsigned char* tileData = container->GetData() + tile.Offset;
+
+            // the navmesh only points into the mapping, it must not free the data
+            if (inFile(tile.Offset, tile.Size) && tile.Offset % ANP_CONTAINER_ALIGNMENT == 0
+                && IsTileDataValid(tileData, tile.Size, x, y)
+                && dtStatusSucceed(Navmesh->addTile(tileData, static_cast<int>(tile.Size), 0, 0, 0)))
+            {
+                tilesLoaded++;
+            }
+        }
+
+        Container = std::move(container);
+        LogI("Loaded .anp2: mapId=", MapId, ", tiles=", tilesLoaded);
+    }
 };
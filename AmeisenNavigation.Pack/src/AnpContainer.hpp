@@ -0,0 +1,70 @@
+#pragma once
+
+#include "../../../recastnavigation/Detour/Include/DetourNavMesh.h"
+
+/// "ANP2", the uncompressed runtime container of a map.
+constexpr unsigned int ANP_CONTAINER_MAGIC = 0x32504E41;
+constexpr unsigned int ANP_CONTAINER_VERSION = 2;
+
+/// Tile blobs start on page boundaries, so they can be used straight from a mapping of the file and the
+/// pages Detour writes to do not spill into other tiles.
+constexpr unsigned int ANP_CONTAINER_ALIGNMENT = 4096;
+
+/// Tiles per side of the tile table, a slot for every tile of the WoW map grid.
+constexpr int ANP_CONTAINER_GRID_SIZE = 64;
+
+/// Upper bound of the tile layers per grid location, tiles of higher layers are not written.
+constexpr int ANP_CONTAINER_MAX_LAYERS = 16;
+
+/// <summary>
+/// Layout of an .anp2 file:
+///
+///   AnpContainerHeader
+///   AnpContainerTile[64 * 64 * LayerCount]
+///                                    indexed by (x + y * 64) * LayerCount + layer, Size 0 if there is no tile
+///   AnpContainerSideTable[SideTableCount]
+///   tile blobs and side tables        raw Detour tile data, each aligned to ANP_CONTAINER_ALIGNMENT
+///
+/// The side table directory is reserved for optional data precomputed for the map, identified by a tag.
+/// None is defined yet, writers leave it empty and readers skip it.
+/// </summary>
+struct AnpContainerHeader
+{
+    unsigned int Magic;
+    unsigned int Version;
+    int MapId;
+    unsigned int Alignment;
+    dtNavMeshParams Params;
+    unsigned int TileCount;
+    unsigned int SideTableCount;
+    unsigned int LayerCount; // highest tile layer + 1, at least 1
+};
+
+struct AnpContainerTile
+{
+    unsigned long long Offset;
+    unsigned int Size;
+    unsigned int Reserved;
+};
+
+struct AnpContainerSideTable
+{
+    unsigned int Tag;
+    unsigned int Reserved;
+    unsigned long long Offset;
+    unsigned long long Size;
+};
+
+static_assert(sizeof(AnpContainerTile) == 16 && sizeof(AnpContainerSideTable) == 24,
+              "the container tables are written as they are in memory");
+
+/// File offset of the first blob, everything before it is read through the header and tables.
+constexpr inline unsigned long long GetAnpContainerDataOffset(unsigned int layerCount,
+                                                              unsigned int sideTableCount) noexcept
+{
+    const unsigned long long tablesEnd = sizeof(AnpContainerHeader)
+        + sizeof(AnpContainerTile) * ANP_CONTAINER_GRID_SIZE * ANP_CONTAINER_GRID_SIZE * layerCount
+        + sizeof(AnpContainerSideTable) * sideTableCount;
+
+    return (tablesEnd + ANP_CONTAINER_ALIGNMENT - 1) / ANP_CONTAINER_ALIGNMENT * ANP_CONTAINER_ALIGNMENT;
+}
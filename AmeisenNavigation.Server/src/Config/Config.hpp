@@ -20,19 +20,33 @@ struct AmeisenNavConfig
 {
     // ── Configuration Fields ─────────────────────────────────────────
 
+    bool mapTileFiles = false;      // use MMAP tiles from copy-on-write mappings of their files
     bool useAnpFileFormat = false;
     float catmullRomSplineAlpha = 0.5f;
     float factionDangerCost = 3.0f;
+    float heightRasterCellSize = 2.0f; // 0 = disabled
     float randomPathMaxDistance = 1.0f;
     int bezierCurvePoints = 8;
     int catmullRomSplinePoints = 4;
+    int flowFieldHotThreshold = 32; // requests per TTL window that make a destination hot, 0 = disabled
+    int flowFieldTtl = 60;          // seconds
+    int landmarkCount = 0;          // landmarks per map for the ALT heuristic, 0 = disabled
+    int mapAdminAccess = 1;         // who may send RELOAD_MAP and UNLOAD_MAP: 0 = nobody, 1 = loopback clients, 2 = everyone
+    int mapIdleTimeout = 0;         // seconds without queries before a map is unloaded, 0 = never
+    int mapMemoryBudgetMb = 0;      // memory of all loaded maps, least recently used ones are unloaded above it, 0 = unlimited
     int maxPointPath = 512;
     int maxPolyPath = 2048;
     int maxSearchNodes = 65535;
     int mmapFormat = 0; // MmapFormat::UNKNOWN
+    int mmapTileBudgetMb = 0;       // MMAP tile streaming budget per map, 0 = load whole maps
+    int pathCacheSize = 4096;
     int port = 47110;
+    int preloadQueries = 4;         // initialised queries per preloaded map, handed to its first clients
     std::string ip = "127.0.0.1";
     std::string mmapsPath = "C:\\meshes\\";
+    std::string preloadMaps = "";   // comma separated ids of the maps loaded at startup, e.g. "0,1,530,571"
+    std::string shards = "";        // comma separated host:port of the servers of a cluster, set = route to them
+    std::string transportsFile = ""; // portals, boats and zeppelins for PATH_CROSS_MAP, on the router of a cluster
 
     // ── Serialization ────────────────────────────────────────────────
 
@@ -101,19 +115,33 @@ private:
     std::map<std::string, ConfigRef> GetFieldMap()
     {
         return {
+            {"bMapTileFiles",           std::ref(mapTileFiles)},
             {"bUseAnpFileFormat",       std::ref(useAnpFileFormat)},
             {"fCatmullRomSplineAlpha",  std::ref(catmullRomSplineAlpha)},
             {"fFactionDangerCost",      std::ref(factionDangerCost)},
+            {"fHeightRasterCellSize",   std::ref(heightRasterCellSize)},
             {"fRandomPathMaxDistance",   std::ref(randomPathMaxDistance)},
             {"iBezierCurvePoints",      std::ref(bezierCurvePoints)},
             {"iCatmullRomSplinePoints", std::ref(catmullRomSplinePoints)},
+            {"iFlowFieldHotThreshold",  std::ref(flowFieldHotThreshold)},
+            {"iFlowFieldTtl",           std::ref(flowFieldTtl)},
+            {"iLandmarkCount",          std::ref(landmarkCount)},
+            {"iMapAdminAccess",         std::ref(mapAdminAccess)},
+            {"iMapIdleTimeout",         std::ref(mapIdleTimeout)},
+            {"iMapMemoryBudgetMb",      std::ref(mapMemoryBudgetMb)},
             {"iMaxPointPath",           std::ref(maxPointPath)},
             {"iMaxPolyPath",            std::ref(maxPolyPath)},
             {"iMaxSearchNodes",         std::ref(maxSearchNodes)},
             {"iMmapFormat",             std::ref(mmapFormat)},
+            {"iMmapTileBudgetMb",       std::ref(mmapTileBudgetMb)},
+            {"iPathCacheSize",          std::ref(pathCacheSize)},
             {"iPort",                   std::ref(port)},
+            {"iPreloadQueries",         std::ref(preloadQueries)},
             {"sIp",                     std::ref(ip)},
             {"sMmapsPath",              std::ref(mmapsPath)},
+            {"sPreloadMaps",            std::ref(preloadMaps)},
+            {"sShards",                 std::ref(shards)},
+            {"sTransportsFile",         std::ref(transportsFile)},
         };
     }
 };
@@ -48,7 +48,15 @@ int __cdecl main(int argc, const char* argv[])
     }
 
     // validate config
-    if (!std::filesystem::exists(config->mmapsPath))
+    if (!config->shards.empty() && ShardRouter::ParseShards(config->shards).empty())
+    {
+        LogE("sShards has to be a comma separated list of host:port: \"", config->shards, "\"");
+        std::cin.get();
+        return 1;
+    }
+
+    // a router only forwards requests, the meshes are on its shards
+    if (config->shards.empty() && !std::filesystem::exists(config->mmapsPath))
     {
         LogE("MMAPS folder does not exist: \"", config->mmapsPath, "\"");
         std::cin.get();
@@ -101,6 +109,65 @@ int __cdecl main(int argc, const char* argv[])
         config->factionDangerCost = 0.0f;
     }
 
+    if (config->landmarkCount < 0 || config->landmarkCount > 32)
+    {
+        LogW("iLandmarkCount has to be a value between 0 and 32, clamping");
+        config->landmarkCount = std::clamp(config->landmarkCount, 0, 32);
+    }
+
+    if (config->pathCacheSize < 0)
+    {
+        LogW("iPathCacheSize negative, disabling the path cache");
+        config->pathCacheSize = 0;
+    }
+
+    if (config->flowFieldHotThreshold < 0)
+    {
+        LogW("iFlowFieldHotThreshold negative, disabling flow fields");
+        config->flowFieldHotThreshold = 0;
+    }
+
+    if (config->flowFieldTtl < 1)
+    {
+        LogW("iFlowFieldTtl has to be at least 1 second, clamping");
+        config->flowFieldTtl = 1;
+    }
+
+    if (config->heightRasterCellSize < 0.0f)
+    {
+        LogW("fHeightRasterCellSize negative, disabling the height raster");
+        config->heightRasterCellSize = 0.0f;
+    }
+
+    if (config->mmapTileBudgetMb < 0)
+    {
+        LogW("iMmapTileBudgetMb negative, loading whole maps");
+        config->mmapTileBudgetMb = 0;
+    }
+
+    if (config->mmapTileBudgetMb > 0 && config->useAnpFileFormat)
+    {
+        LogW("iMmapTileBudgetMb only applies to the MMAP format, loading whole maps");
+    }
+
+    if (config->mapIdleTimeout < 0)
+    {
+        LogW("iMapIdleTimeout negative, keeping idle maps");
+        config->mapIdleTimeout = 0;
+    }
+
+    if (config->mapMemoryBudgetMb < 0)
+    {
+        LogW("iMapMemoryBudgetMb negative, disabling the memory budget");
+        config->mapMemoryBudgetMb = 0;
+    }
+
+    if (config->preloadQueries < 0)
+    {
+        LogW("iPreloadQueries negative, clamping to 0");
+        config->preloadQueries = 0;
+    }
+
     // set ctrl+c handler to cleanup stuff when we exit
     if (!SetConsoleCtrlHandler(SigIntHandler, 1))
     {
@@ -117,8 +184,53 @@ int __cdecl main(int argc, const char* argv[])
     LogI("Config: maxPolyPath=", configPtr->maxPolyPath,
          " maxPointPath=", configPtr->maxPointPath,
          " maxSearchNodes=", configPtr->maxSearchNodes,
+         " landmarks=", configPtr->landmarkCount,
+         " pathCache=", configPtr->pathCacheSize,
+         " flowFieldHot=", configPtr->flowFieldHotThreshold,
+         " heightRaster=", configPtr->heightRasterCellSize,
+         " tileBudgetMb=", configPtr->mmapTileBudgetMb,
+         " mapTiles=", configPtr->mapTileFiles,
+         " mapIdleTimeout=", configPtr->mapIdleTimeout,
+         " mapBudgetMb=", configPtr->mapMemoryBudgetMb,
          " format=", configPtr->useAnpFileFormat ? "ANP" : "MMAP");
     LogI("Config: meshes=\"", configPtr->mmapsPath, "\"");
+
+    if (auto* router = g_NavServer->Router())
+    {
+        LogI("Config: routing to ", router->GetShardCount(), " shards=\"", configPtr->shards, "\"");
+
+        // cross map routes are planned by the router, the shards only search the walking costs on their maps
+        if (!configPtr->transportsFile.empty())
+        {
+            LogI("Config: transports=\"", configPtr->transportsFile, "\"");
+            int invalidLines = 0;
+
+            if (router->LoadTransports(configPtr->transportsFile, &invalidLines) < 0)
+                LogE("Failed to open transports file: ", configPtr->transportsFile);
+            else if (invalidLines > 0)
+                LogW("Skipped ", invalidLines, " malformed lines of transports file: ", configPtr->transportsFile);
+        }
+
+        if (!configPtr->preloadMaps.empty())
+        {
+            LogW("sPreloadMaps is ignored by a router, set it on its shards");
+        }
+    }
+    else
+    {
+        if (!configPtr->transportsFile.empty())
+        {
+            LogI("Config: transports=\"", configPtr->transportsFile, "\"");
+            g_NavServer->Nav()->LoadTransports(configPtr->transportsFile);
+        }
+
+        if (!configPtr->preloadMaps.empty())
+        {
+            LogI("Config: preload=\"", configPtr->preloadMaps, "\" queries=", configPtr->preloadQueries);
+            g_NavServer->PreloadMaps();
+        }
+    }
+
     LogS("Starting server on: ", configPtr->ip, ":", std::to_string(configPtr->port));
     g_NavServer->Run();
 
@@ -221,6 +333,31 @@ void GenericPathCallback(ClientHandler* handler, AnTcpMessageType type, const vo
     const PathRequestData request = *reinterpret_cast<const PathRequestData*>(data);
     bool pathGenerated = false;
 
+    std::optional<PathRegion> region;
+
+    if (request.flags & static_cast<int>(PathRequestFlags::SEARCH_REGION))
+    {
+        const int regionSize = size - static_cast<int>(sizeof(PathRequestData));
+        const auto regionData = reinterpret_cast<const PathRegionData*>(static_cast<const char*>(data)
+                                                                         + sizeof(PathRequestData));
+
+        if (regionSize < static_cast<int>(sizeof(PathRegionData)) || regionData->vertexCount < 2
+            || regionData->vertexCount > PATH_REGION_MAX_VERTICES
+            || regionSize < static_cast<int>(sizeof(PathRegionData)
+                                             + (regionData->vertexCount - 1) * sizeof(Vector3)))
+        {
+            LogE("PathRequest: invalid region (", size, " bytes)");
+            return;
+        }
+
+        const Vector3* vertices = &regionData->firstVertex;
+
+        if (regionData->vertexCount == 2)
+            region.emplace(vertices[0].x, vertices[0].y, vertices[1].x, vertices[1].y);
+        else
+            region.emplace(vertices, regionData->vertexCount);
+    }
+
     auto buffers = g_NavServer->GetClientBuffers(handler->GetId());
     if (!buffers.first || !buffers.second)
     {
@@ -238,11 +375,15 @@ void GenericPathCallback(ClientHandler* handler, AnTcpMessageType type, const vo
     switch (pathType)
     {
         case PathType::STRAIGHT:
-            pathGenerated = g_NavServer->Nav()->GetPath(handler->GetId(), request.mapId, request.start, request.end, path);
+            pathGenerated = g_NavServer->Nav()->GetPath(handler->GetId(), request.mapId, request.start, request.end, path,
+                                                        GetPathSearchFlags(request.flags),
+                                                        region ? &*region : nullptr);
             break;
         case PathType::RANDOM:
             pathGenerated = g_NavServer->Nav()->GetRandomPath(handler->GetId(), request.mapId, request.start, request.end, path,
-                                               g_NavServer->Config()->randomPathMaxDistance);
+                                               g_NavServer->Config()->randomPathMaxDistance,
+                                               GetPathSearchFlags(request.flags),
+                                               region ? &*region : nullptr);
             break;
     }
 
@@ -373,18 +514,687 @@ void GetConfigCallback(ClientHandler* handler, AnTcpMessageType type, const void
     header.useAnpFileFormat = cfg->useAnpFileFormat ? 1 : 0;
     header.pathLength = static_cast<int>(path.size());
 
-    // Build response: header + path string bytes
-    const size_t totalSize = sizeof(GetConfigResponseHeader) + path.size();
+    const auto mapStates = g_NavServer->Nav()->GetMapLoadStates();
+    const int mapStateCount = static_cast<int>(mapStates.size());
+
+    // Build response: header + path string bytes + map state count + map states
+    const size_t statesOffset = sizeof(GetConfigResponseHeader) + path.size();
+    const size_t totalSize = statesOffset + sizeof(int) + mapStates.size() * sizeof(MapStateEntry);
     std::vector<char> buffer(totalSize);
     std::memcpy(buffer.data(), &header, sizeof(GetConfigResponseHeader));
     std::memcpy(buffer.data() + sizeof(GetConfigResponseHeader), path.data(), path.size());
+    std::memcpy(buffer.data() + statesOffset, &mapStateCount, sizeof(int));
+
+    for (size_t i = 0; i < mapStates.size(); ++i)
+    {
+        const MapStateEntry entry{ mapStates[i].first, static_cast<int>(mapStates[i].second) };
+        std::memcpy(buffer.data() + statesOffset + sizeof(int) + i * sizeof(MapStateEntry), &entry, sizeof(entry));
+    }
+
+    handler->SendData(type, buffer.data(), totalSize);
+    LogD("[", handler->GetId(), "] GetConfig path=\"", path, "\" maps=", mapStateCount);
+}
+
+void GetStatsCallback(ClientHandler* handler, AnTcpMessageType type, const void* data, int size)
+{
+    const PathCacheStats stats = g_NavServer->Nav()->GetPathCacheStats();
+
+    GetStatsResponse response;
+    response.pathCacheHits = stats.Hits;
+    response.pathCacheMisses = stats.Misses;
+    response.pathCacheCoalesced = stats.Coalesced;
+    response.pathCacheEntries = stats.Entries;
+
+    const FlowFieldStats flowFieldStats = g_NavServer->Nav()->GetFlowFieldStats();
+    response.flowFieldHits = flowFieldStats.Hits;
+    response.flowFieldCount = flowFieldStats.Fields;
+
+    const auto mapMemory = g_NavServer->Nav()->GetMapMemoryUsage();
+    const int mapCount = static_cast<int>(mapMemory.size());
+
+    // Build response: stats + map count + map memory entries
+    const size_t mapsOffset = sizeof(GetStatsResponse) + sizeof(int);
+    const size_t totalSize = mapsOffset + mapMemory.size() * sizeof(MapMemoryEntry);
+    std::vector<char> buffer(totalSize);
+    std::memcpy(buffer.data(), &response, sizeof(GetStatsResponse));
+    std::memcpy(buffer.data() + sizeof(GetStatsResponse), &mapCount, sizeof(int));
+
+    for (size_t i = 0; i < mapMemory.size(); ++i)
+    {
+        const MapMemoryEntry entry{ mapMemory[i].MapId, 0, mapMemory[i].NavMeshBytes, mapMemory[i].IndexBytes,
+                                    mapMemory[i].IdleSeconds };
+        std::memcpy(buffer.data() + mapsOffset + i * sizeof(MapMemoryEntry), &entry, sizeof(entry));
+    }
+
+    handler->SendData(type, buffer.data(), totalSize);
+    LogD("[", handler->GetId(), "] GetStats pathCacheHitRatio=", stats.GetHitRatio(), " maps=", mapCount);
+}
+
+void PathCostsCallback(ClientHandler* handler, AnTcpMessageType type, const void* data, int size)
+{
+    if (size < static_cast<int>(sizeof(PathCostsRequestData)))
+    {
+        LogE("PathCosts: packet too small (", size, " < ", sizeof(PathCostsRequestData), ")");
+        return;
+    }
+
+    // Use a pointer into the original data buffer (flexible array pattern).
+    const auto* request = reinterpret_cast<const PathCostsRequestData*>(data);
+
+    // Validate target count against received data size
+    const int expectedSize = static_cast<int>(sizeof(PathCostsRequestData))
+        + (request->targetCount - 1) * static_cast<int>(sizeof(Vector3));
+
+    if (request->targetCount <= 0 || request->targetCount > PATH_COSTS_MAX_TARGETS || size < expectedSize)
+    {
+        LogE("PathCosts: invalid target count ", request->targetCount);
+
+        // empty reply, the client checks the size against its target count
+        handler->SendData(type, request, 0);
+        return;
+    }
+
+    Path* straightPath = nullptr;
+
+    if (request->flags & static_cast<int>(PathCostsFlags::STRAIGHT_LENGTH))
+    {
+        straightPath = g_NavServer->GetClientBuffers(handler->GetId()).first;
+    }
+
+    PathCost costs[PATH_COSTS_MAX_TARGETS];
+    const bool ok = g_NavServer->Nav()->GetPathCosts(handler->GetId(), request->mapId, request->start,
+                                                     &request->firstTarget, request->targetCount, costs,
+                                                     straightPath);
+
+    if (straightPath)
+    {
+        straightPath->pointCount = 0;
+    }
+
+    PathCostsResult results[PATH_COSTS_MAX_TARGETS];
+
+    for (int i = 0; i < request->targetCount; ++i)
+    {
+        results[i].cost = ok ? costs[i].cost : -1.0f;
+        results[i].length = ok ? costs[i].length : -1.0f;
+    }
+
+    LogD("[", handler->GetId(), "] PathCosts map=", request->mapId, " targets=", request->targetCount,
+         ok ? " ok" : " FAIL");
+    handler->SendData(type, results, request->targetCount * sizeof(PathCostsResult));
+}
+
+void PathToNearestCallback(ClientHandler* handler, AnTcpMessageType type, const void* data, int size)
+{
+    if (size < static_cast<int>(sizeof(PathToNearestRequestData)))
+    {
+        LogE("PathToNearest: packet too small (", size, " < ", sizeof(PathToNearestRequestData), ")");
+        return;
+    }
+
+    // Use a pointer into the original data buffer (flexible array pattern).
+    const auto* request = reinterpret_cast<const PathToNearestRequestData*>(data);
+
+    const int expectedSize = static_cast<int>(sizeof(PathToNearestRequestData))
+        + (request->goalCount - 1) * static_cast<int>(sizeof(Vector3));
+
+    auto buffers = g_NavServer->GetClientBuffers(handler->GetId());
+
+    if (request->goalCount <= 0 || request->goalCount > PATH_TO_NEAREST_MAX_GOALS || size < expectedSize
+        || !buffers.first || !buffers.second)
+    {
+        LogE("PathToNearest: invalid request, goals=", request->goalCount);
+        Vector3 zero;
+        handler->SendData(type, zero, sizeof(Vector3));
+        return;
+    }
+
+    Path& path = *buffers.first;
+    Path& pathMisc = *buffers.second;
+    path.pointCount = 0;
+    pathMisc.pointCount = 0;
+
+    int goalIndex = -1;
+    const bool pathGenerated = g_NavServer->Nav()->GetPathToNearest(handler->GetId(), request->mapId, request->start,
+                                                                    &request->firstGoal, request->goalCount, path,
+                                                                    &goalIndex);
+
+    if (pathGenerated)
+    {
+        // Response: goal index followed by the path points
+        const Path* pathToSend = ApplyPathFlags(handler, request->mapId, request->flags, path, pathMisc,
+                                                PathType::STRAIGHT);
+        const size_t pointsSize = pathToSend->pointCount * sizeof(Vector3);
+        std::vector<char> buffer(sizeof(int) + pointsSize);
+        std::memcpy(buffer.data(), &goalIndex, sizeof(int));
+        std::memcpy(buffer.data() + sizeof(int), pathToSend->points, pointsSize);
+
+        handler->SendData(type, buffer.data(), buffer.size());
+    }
+    else
+    {
+        Vector3 zero;
+        handler->SendData(type, zero, sizeof(Vector3));
+    }
+
+    LogD("[", handler->GetId(), "] PathToNearest map=", request->mapId, " goals=", request->goalCount,
+         pathGenerated ? " ok" : " FAIL", " goal=", goalIndex);
+
+    path.pointCount = 0;
+    pathMisc.pointCount = 0;
+}
+
+void ReachableWithinCallback(ClientHandler* handler, AnTcpMessageType type, const void* data, int size)
+{
+    if (size < static_cast<int>(sizeof(ReachableWithinData)))
+    {
+        LogE("ReachableWithin: packet too small (", size, " < ", sizeof(ReachableWithinData), ")");
+        return;
+    }
+
+    const ReachableWithinData request = *reinterpret_cast<const ReachableWithinData*>(data);
+    float cost = -1.0f;
+    bool ok = g_NavServer->Nav()->IsReachableWithin(handler->GetId(), request.mapId, request.start, request.end,
+                                                    request.maxCost, &cost);
+    LogD("[", handler->GetId(), "] ReachableWithin map=", request.mapId, " maxCost=", request.maxCost,
+         ok ? " yes" : " no");
+    handler->SendDataVar(type, cost);
+}
+
+void PathMultiCallback(ClientHandler* handler, AnTcpMessageType type, const void* data, int size)
+{
+    if (size < static_cast<int>(sizeof(PathMultiRequestData)))
+    {
+        LogE("PathMulti: packet too small (", size, " < ", sizeof(PathMultiRequestData), ")");
+        return;
+    }
+
+    // Use a pointer into the original data buffer (flexible array pattern).
+    const auto* request = reinterpret_cast<const PathMultiRequestData*>(data);
+
+    const int expectedSize = static_cast<int>(sizeof(PathMultiRequestData))
+        + (request->waypointCount - 1) * static_cast<int>(sizeof(Vector3));
+
+    auto buffers = g_NavServer->GetClientBuffers(handler->GetId());
+
+    if (request->waypointCount < 2 || request->waypointCount > PATH_MULTI_MAX_WAYPOINTS || size < expectedSize
+        || !buffers.first || !buffers.second)
+    {
+        LogE("PathMulti: invalid request, waypoints=", request->waypointCount);
+        Vector3 zero;
+        handler->SendData(type, zero, sizeof(Vector3));
+        return;
+    }
+
+    Path& path = *buffers.first;
+    Path& pathMisc = *buffers.second;
+    path.pointCount = 0;
+    pathMisc.pointCount = 0;
+
+    const bool pathGenerated = g_NavServer->Nav()->GetMultiPath(handler->GetId(), request->mapId,
+                                                                &request->firstWaypoint, request->waypointCount, path,
+                                                                GetPathSearchFlags(request->flags));
+
+    if (pathGenerated)
+    {
+        // smoothing and validation run once over the whole route
+        HandlePathFlagsAndSendData(handler, request->mapId, request->flags, path, pathMisc, type,
+                                   PathType::STRAIGHT);
+    }
+    else
+    {
+        Vector3 zero;
+        handler->SendData(type, zero, sizeof(Vector3));
+    }
+
+    LogD("[", handler->GetId(), "] PathMulti map=", request->mapId, " waypoints=", request->waypointCount,
+         pathGenerated ? " ok" : " FAIL", " pts=", path.pointCount);
+
+    path.pointCount = 0;
+    pathMisc.pointCount = 0;
+}
+
+void PathSessionCallback(ClientHandler* handler, AnTcpMessageType type, const void* data, int size)
+{
+    if (size < static_cast<int>(sizeof(PathSessionRequestData)))
+    {
+        LogE("PathSession: packet too small (", size, " < ", sizeof(PathSessionRequestData), ")");
+        return;
+    }
+
+    const PathSessionRequestData request = *reinterpret_cast<const PathSessionRequestData*>(data);
+
+    auto buffers = g_NavServer->GetClientBuffers(handler->GetId());
+    if (!buffers.first)
+    {
+        LogE("PathSession: no buffers for client ", handler->GetId());
+        return;
+    }
+
+    Path& corners = *buffers.first;
+    corners.pointCount = 0;
+
+    const bool ok = g_NavServer->Nav()->UpdatePathSession(handler->GetId(), request.mapId, request.position,
+                                                          request.target, corners, request.maxCorners,
+                                                          GetPathSearchFlags(request.flags));
+
+    if (ok)
+    {
+        handler->SendData(type, corners.points, corners.pointCount * sizeof(Vector3));
+    }
+    else
+    {
+        Vector3 zero;
+        handler->SendData(type, zero, sizeof(Vector3));
+    }
+
+    LogD("[", handler->GetId(), "] PathSession map=", request.mapId, ok ? " ok" : " FAIL",
+         " corners=", corners.pointCount);
+
+    corners.pointCount = 0;
+}
+
+void ReloadMapCallback(ClientHandler* handler, AnTcpMessageType type, const void* data, int size)
+{
+    if (size < static_cast<int>(sizeof(int)))
+    {
+        LogE("ReloadMap: packet too small (", size, " < ", sizeof(int), ")");
+        return;
+    }
+
+    const int mapId = *reinterpret_cast<const int*>(data);
+
+    if (!IsMapAdmin(handler))
+    {
+        LogW("[", handler->GetId(), "] ReloadMap map=", mapId, " denied for ", handler->GetIpAddress());
+        handler->SendDataVar(type, 0);
+        return;
+    }
+
+    // the new navmesh is built on the reload worker, every client keeps querying the current one meanwhile
+    const int ok = g_NavServer->QueueReload(mapId) ? 1 : 0;
+    LogI("[", handler->GetId(), "] ReloadMap map=", mapId, ok ? " queued" : " not loaded or already queued");
+    handler->SendDataVar(type, ok);
+}
+
+void UnloadMapCallback(ClientHandler* handler, AnTcpMessageType type, const void* data, int size)
+{
+    if (size < static_cast<int>(sizeof(int)))
+    {
+        LogE("UnloadMap: packet too small (", size, " < ", sizeof(int), ")");
+        return;
+    }
+
+    const int mapId = *reinterpret_cast<const int*>(data);
+
+    if (!IsMapAdmin(handler))
+    {
+        LogW("[", handler->GetId(), "] UnloadMap map=", mapId, " denied for ", handler->GetIpAddress());
+        handler->SendDataVar(type, 0);
+        return;
+    }
+
+    const int ok = g_NavServer->Nav()->UnloadMap(mapId) ? 1 : 0;
+    LogI("[", handler->GetId(), "] UnloadMap map=", mapId, ok ? " ok" : " not loaded");
+    handler->SendDataVar(type, ok);
+}
+
+void PathCrossMapCallback(ClientHandler* handler, AnTcpMessageType type, const void* data, int size)
+{
+    if (size < static_cast<int>(sizeof(PathCrossMapRequestData)))
+    {
+        LogE("PathCrossMap: packet too small (", size, " < ", sizeof(PathCrossMapRequestData), ")");
+        return;
+    }
+
+    const PathCrossMapRequestData request = *reinterpret_cast<const PathCrossMapRequestData*>(data);
+
+    std::vector<RouteLeg> legs;
+    float totalCost = -1.0f;
+    const bool ok = g_NavServer->Nav()->GetCrossMapRoute(handler->GetId(), request.startMapId, request.start,
+                                                         request.endMapId, request.end, legs, &totalCost);
+
+    SendCrossMapRoute(handler, type, ok, legs, totalCost);
+    LogD("[", handler->GetId(), "] PathCrossMap map=", request.startMapId, "->", request.endMapId,
+         ok ? " ok" : " FAIL", " legs=", legs.size());
+}
+
+void SendCrossMapRoute(ClientHandler* handler, AnTcpMessageType type, bool ok, const std::vector<RouteLeg>& legs,
+                       float totalCost)
+{
+    const size_t legCount = ok ? legs.size() : 0;
+
+    // Build response: header + legs
+    const PathCrossMapResponseHeader header{ static_cast<int>(legCount), ok ? totalCost : -1.0f };
+    const size_t totalSize = sizeof(PathCrossMapResponseHeader) + legCount * sizeof(CrossMapLeg);
+    std::vector<char> buffer(totalSize);
+    std::memcpy(buffer.data(), &header, sizeof(PathCrossMapResponseHeader));
+
+    for (size_t i = 0; i < legCount; ++i)
+    {
+        const CrossMapLeg leg{ legs[i].TransportId, legs[i].MapId, legs[i].Start, legs[i].EndMapId, legs[i].End,
+                               legs[i].Cost };
+        std::memcpy(buffer.data() + sizeof(PathCrossMapResponseHeader) + i * sizeof(CrossMapLeg), &leg, sizeof(leg));
+    }
 
     handler->SendData(type, buffer.data(), totalSize);
-    LogD("[", handler->GetId(), "] GetConfig path=\"", path, "\"");
+}
+
+void OnRouterClientConnect(ClientHandler* handler)
+{
+    LogI("Client Connected: ", handler->GetIpAddress(), ":", handler->GetPort());
+
+    g_NavServer->Router()->OpenSession(handler->GetId());
+}
+
+void OnRouterClientDisconnect(ClientHandler* handler)
+{
+    if (!g_NavServer->Router()->CloseSession(handler->GetId()))
+        return;
+
+    LogI("Client Disconnected: ", handler->GetIpAddress(), ":", handler->GetPort());
+}
+
+void RouteMapCallback(ClientHandler* handler, AnTcpMessageType type, const void* data, int size)
+{
+    if (size < static_cast<int>(sizeof(int)))
+    {
+        LogE("Route: packet too small (", size, " < ", sizeof(int), ")");
+        return;
+    }
+
+    auto* router = g_NavServer->Router();
+    const auto session = router->GetSession(handler->GetId());
+
+    if (!session)
+        return;
+
+    // every request for a map starts with its id
+    const int mapId = *reinterpret_cast<const int*>(data);
+    const int shard = router->GetShard(mapId);
+
+    // shards only see the router as their client, so it decides who may reload and unload maps
+    if ((type == static_cast<AnTcpMessageType>(MessageType::RELOAD_MAP)
+        || type == static_cast<AnTcpMessageType>(MessageType::UNLOAD_MAP))
+        && !IsMapAdmin(handler))
+    {
+        LogW("[", handler->GetId(), "] Route map=", mapId, " admin request denied for ", handler->GetIpAddress());
+        handler->SendDataVar(type, 0);
+        return;
+    }
+
+    const ShardConnection* shardConnection = router->Forward(*session, shard, type, data, size);
+
+    if (!shardConnection)
+    {
+        // the client notices right away and reconnects instead of waiting for its timeout
+        LogE("[", handler->GetId(), "] Route map=", mapId, " shard ", router->GetAddress(shard).Host, ":",
+             router->GetAddress(shard).Port, " not reachable, disconnecting client");
+        handler->Disconnect();
+        return;
+    }
+
+    // the walking costs of cross map routes on the map may have changed
+    if (type == static_cast<AnTcpMessageType>(MessageType::RELOAD_MAP)
+        || type == static_cast<AnTcpMessageType>(MessageType::UNLOAD_MAP))
+    {
+        router->InvalidateTransportCosts(mapId);
+    }
+
+    handler->SendPacket(shardConnection->GetResponsePacket(), shardConnection->GetResponsePacketSize());
+    LogD("[", handler->GetId(), "] Route type=", static_cast<int>(type), " map=", mapId, " shard=", shard);
+}
+
+void RouteCrossMapCallback(ClientHandler* handler, AnTcpMessageType type, const void* data, int size)
+{
+    if (size < static_cast<int>(sizeof(PathCrossMapRequestData)))
+    {
+        LogE("RouteCrossMap: packet too small (", size, " < ", sizeof(PathCrossMapRequestData), ")");
+        return;
+    }
+
+    auto* router = g_NavServer->Router();
+    const auto session = router->GetSession(handler->GetId());
+
+    if (!session)
+        return;
+
+    const PathCrossMapRequestData request = *reinterpret_cast<const PathCrossMapRequestData*>(data);
+
+    // the route spans the maps of several shards, every map is only searched by the shard that owns it
+    int failedShard = -1;
+    std::vector<char> costsRequest(sizeof(PathCostsRequestData) + (PATH_COSTS_MAX_TARGETS - 1) * sizeof(Vector3));
+
+    const TransportGraph::WalkCostFn walkCosts = [&](int mapId, const Vector3& from, const Vector3* targets,
+                                                     int targetCount, PathCost* costs)
+    {
+        const int shard = router->GetShard(mapId);
+
+        for (int first = 0; first < targetCount; first += PATH_COSTS_MAX_TARGETS)
+        {
+            const int count = std::min(targetCount - first, PATH_COSTS_MAX_TARGETS);
+            const PathCostsRequestData header{ mapId, static_cast<int>(PathCostsFlags::NONE), from, count, {} };
+            const int requestSize = static_cast<int>(sizeof(PathCostsRequestData) + (count - 1) * sizeof(Vector3));
+
+            std::memcpy(costsRequest.data(), &header, offsetof(PathCostsRequestData, firstTarget));
+            std::memcpy(costsRequest.data() + offsetof(PathCostsRequestData, firstTarget), targets + first,
+                        count * sizeof(Vector3));
+
+            const ShardConnection* shardConnection = router->Forward(
+                *session, shard, static_cast<AnTcpMessageType>(MessageType::PATH_COSTS), costsRequest.data(),
+                requestSize);
+
+            if (!shardConnection)
+            {
+                failedShard = shard;
+                return false;
+            }
+
+            if (shardConnection->GetResponseSize() != count * static_cast<int>(sizeof(PathCostsResult)))
+                return false;
+
+            const auto* results = reinterpret_cast<const PathCostsResult*>(shardConnection->GetResponseData());
+
+            for (int i = 0; i < count; ++i)
+                costs[first + i] = PathCost{ results[i].cost, results[i].length };
+        }
+
+        return true;
+    };
+
+    // the cached costs depend on the filter the shards search with
+    const uint64_t filter = ShardRouter::HashBytes(session->Filter.data(), session->Filter.size());
+
+    std::vector<RouteLeg> legs;
+    float totalCost = -1.0f;
+    const bool ok = router->GetTransports()->FindRoute(request.startMapId, request.start, request.endMapId,
+                                                       request.end, filter, walkCosts, legs, &totalCost);
+
+    if (failedShard >= 0)
+    {
+        // the client notices right away and reconnects instead of waiting for its timeout
+        LogE("[", handler->GetId(), "] RouteCrossMap shard ", router->GetAddress(failedShard).Host, ":",
+             router->GetAddress(failedShard).Port, " not reachable, disconnecting client");
+        handler->Disconnect();
+        return;
+    }
+
+    SendCrossMapRoute(handler, type, ok, legs, totalCost);
+    LogD("[", handler->GetId(), "] RouteCrossMap map=", request.startMapId, "->", request.endMapId,
+         ok ? " ok" : " FAIL", " legs=", legs.size());
+}
+
+void RouteConfigureFilterCallback(ClientHandler* handler, AnTcpMessageType type, const void* data, int size)
+{
+    auto* router = g_NavServer->Router();
+    const auto session = router->GetSession(handler->GetId());
+
+    if (!session)
+        return;
+
+    // the shards the client uses already get the filter now, the others when their connection is opened,
+    // if there are none yet the first shard answers whether the filter is valid
+    const bool anyConnected = std::any_of(session->Connections.begin(), session->Connections.end(),
+                                          [](const auto& connection) { return connection->IsConnected(); });
+    const ShardConnection* shardConnection = nullptr;
+
+    for (int shard = 0; shard < static_cast<int>(router->GetShardCount()); ++shard)
+    {
+        if (anyConnected ? !session->Connections[shard]->IsConnected() : shard != 0)
+            continue;
+
+        if (!(shardConnection = router->Forward(*session, shard, type, data, size)))
+        {
+            LogE("[", handler->GetId(), "] RouteConfigureFilter shard ", router->GetAddress(shard).Host, ":",
+                 router->GetAddress(shard).Port, " not reachable, disconnecting client");
+            handler->Disconnect();
+            return;
+        }
+    }
+
+    const bool accepted = shardConnection->GetResponseSize() >= static_cast<int>(sizeof(bool))
+        && *reinterpret_cast<const bool*>(shardConnection->GetResponseData());
+
+    if (accepted)
+    {
+        const auto* bytes = static_cast<const char*>(data);
+        session->Filter.assign(bytes, bytes + size);
+    }
+
+    handler->SendPacket(shardConnection->GetResponsePacket(), shardConnection->GetResponsePacketSize());
+    LogD("[", handler->GetId(), "] RouteConfigureFilter", accepted ? " ok" : " FAIL");
+}
+
+void RouteGetConfigCallback(ClientHandler* handler, AnTcpMessageType type, const void* data, int size)
+{
+    auto* router = g_NavServer->Router();
+    const auto session = router->GetSession(handler->GetId());
+
+    if (!session)
+        return;
+
+    // the header and the meshes path of the first shard that answers, the map states of all of them
+    std::vector<char> buffer;
+    std::vector<MapStateEntry> mapStates;
+
+    for (int shard = 0; shard < static_cast<int>(router->GetShardCount()); ++shard)
+    {
+        const ShardConnection* shardConnection = router->Forward(*session, shard, type, data, size);
+        const int responseSize = shardConnection ? shardConnection->GetResponseSize() : 0;
+        const char* response = shardConnection ? shardConnection->GetResponseData() : nullptr;
+
+        if (responseSize < static_cast<int>(sizeof(GetConfigResponseHeader)))
+        {
+            LogW("[", handler->GetId(), "] RouteGetConfig shard ", router->GetAddress(shard).Host, ":",
+                 router->GetAddress(shard).Port, " did not answer");
+            continue;
+        }
+
+        GetConfigResponseHeader header;
+        std::memcpy(&header, response, sizeof(GetConfigResponseHeader));
+
+        const int statesOffset = static_cast<int>(sizeof(GetConfigResponseHeader)) + header.pathLength;
+        int mapStateCount = 0;
+
+        if (header.pathLength < 0 || responseSize < statesOffset + static_cast<int>(sizeof(int)))
+            continue;
+
+        if (buffer.empty())
+            buffer.assign(response, response + statesOffset);
+
+        std::memcpy(&mapStateCount, response + statesOffset, sizeof(int));
+        mapStateCount = std::clamp(mapStateCount, 0, (responseSize - statesOffset - static_cast<int>(sizeof(int)))
+                                   / static_cast<int>(sizeof(MapStateEntry)));
+
+        const auto* entries = response + statesOffset + sizeof(int);
+        const size_t previousCount = mapStates.size();
+        mapStates.resize(previousCount + mapStateCount);
+        std::memcpy(mapStates.data() + previousCount, entries, mapStateCount * sizeof(MapStateEntry));
+    }
+
+    if (buffer.empty())
+    {
+        LogE("[", handler->GetId(), "] RouteGetConfig no shard answered, disconnecting client");
+        handler->Disconnect();
+        return;
+    }
+
+    // Build response: header + path string bytes + map state count + map states of all shards
+    const int mapStateCount = static_cast<int>(mapStates.size());
+    const size_t statesOffset = buffer.size();
+    buffer.resize(statesOffset + sizeof(int) + mapStates.size() * sizeof(MapStateEntry));
+    std::memcpy(buffer.data() + statesOffset, &mapStateCount, sizeof(int));
+    std::memcpy(buffer.data() + statesOffset + sizeof(int), mapStates.data(), mapStates.size() * sizeof(MapStateEntry));
+
+    handler->SendData(type, buffer.data(), buffer.size());
+    LogD("[", handler->GetId(), "] RouteGetConfig maps=", mapStateCount);
+}
+
+void RouteGetStatsCallback(ClientHandler* handler, AnTcpMessageType type, const void* data, int size)
+{
+    auto* router = g_NavServer->Router();
+    const auto session = router->GetSession(handler->GetId());
+
+    if (!session)
+        return;
+
+    // counters summed over the shards, the loaded maps of all of them
+    GetStatsResponse stats{};
+    std::vector<MapMemoryEntry> mapMemory;
+
+    for (int shard = 0; shard < static_cast<int>(router->GetShardCount()); ++shard)
+    {
+        const ShardConnection* shardConnection = router->Forward(*session, shard, type, data, size);
+        const int responseSize = shardConnection ? shardConnection->GetResponseSize() : 0;
+        const char* response = shardConnection ? shardConnection->GetResponseData() : nullptr;
+        constexpr int mapsOffset = static_cast<int>(sizeof(GetStatsResponse) + sizeof(int));
+
+        if (responseSize < mapsOffset)
+        {
+            LogW("[", handler->GetId(), "] RouteGetStats shard ", router->GetAddress(shard).Host, ":",
+                 router->GetAddress(shard).Port, " did not answer");
+            continue;
+        }
+
+        GetStatsResponse shardStats;
+        std::memcpy(&shardStats, response, sizeof(GetStatsResponse));
+        stats.pathCacheHits += shardStats.pathCacheHits;
+        stats.pathCacheMisses += shardStats.pathCacheMisses;
+        stats.pathCacheCoalesced += shardStats.pathCacheCoalesced;
+        stats.pathCacheEntries += shardStats.pathCacheEntries;
+        stats.flowFieldHits += shardStats.flowFieldHits;
+        stats.flowFieldCount += shardStats.flowFieldCount;
+
+        int mapCount = 0;
+        std::memcpy(&mapCount, response + sizeof(GetStatsResponse), sizeof(int));
+        mapCount = std::clamp(mapCount, 0, (responseSize - mapsOffset) / static_cast<int>(sizeof(MapMemoryEntry)));
+
+        const size_t previousCount = mapMemory.size();
+        mapMemory.resize(previousCount + mapCount);
+        std::memcpy(mapMemory.data() + previousCount, response + mapsOffset, mapCount * sizeof(MapMemoryEntry));
+    }
+
+    // Build response: stats + map count + map memory entries of all shards
+    const int mapCount = static_cast<int>(mapMemory.size());
+    const size_t mapsOffset = sizeof(GetStatsResponse) + sizeof(int);
+    const size_t totalSize = mapsOffset + mapMemory.size() * sizeof(MapMemoryEntry);
+    std::vector<char> buffer(totalSize);
+    std::memcpy(buffer.data(), &stats, sizeof(GetStatsResponse));
+    std::memcpy(buffer.data() + sizeof(GetStatsResponse), &mapCount, sizeof(int));
+    std::memcpy(buffer.data() + mapsOffset, mapMemory.data(), mapMemory.size() * sizeof(MapMemoryEntry));
+
+    handler->SendData(type, buffer.data(), totalSize);
+    LogD("[", handler->GetId(), "] RouteGetStats maps=", mapCount);
 }
 
 void NavServer::RegisterCallbacks()
 {
+    if (router_)
+    {
+        RegisterRouterCallbacks();
+        return;
+    }
+
     server_->SetOnClientConnected(OnClientConnect);
     server_->SetOnClientDisconnected(OnClientDisconnect);
 
@@ -397,4 +1207,98 @@ void NavServer::RegisterCallbacks()
     server_->AddCallback(static_cast<AnTcpMessageType>(MessageType::CONFIGURE_FILTER), ConfigureFilterCallback);
     server_->AddCallback(static_cast<AnTcpMessageType>(MessageType::GET_HEIGHT), GetHeightCallback);
     server_->AddCallback(static_cast<AnTcpMessageType>(MessageType::GET_CONFIG), GetConfigCallback);
+    server_->AddCallback(static_cast<AnTcpMessageType>(MessageType::GET_STATS), GetStatsCallback);
+    server_->AddCallback(static_cast<AnTcpMessageType>(MessageType::PATH_COSTS), PathCostsCallback);
+    server_->AddCallback(static_cast<AnTcpMessageType>(MessageType::PATH_TO_NEAREST), PathToNearestCallback);
+    server_->AddCallback(static_cast<AnTcpMessageType>(MessageType::REACHABLE_WITHIN), ReachableWithinCallback);
+    server_->AddCallback(static_cast<AnTcpMessageType>(MessageType::PATH_MULTI), PathMultiCallback);
+    server_->AddCallback(static_cast<AnTcpMessageType>(MessageType::PATH_SESSION), PathSessionCallback);
+    server_->AddCallback(static_cast<AnTcpMessageType>(MessageType::RELOAD_MAP), ReloadMapCallback);
+    server_->AddCallback(static_cast<AnTcpMessageType>(MessageType::UNLOAD_MAP), UnloadMapCallback);
+    server_->AddCallback(static_cast<AnTcpMessageType>(MessageType::PATH_CROSS_MAP), PathCrossMapCallback);
+}
+
+void NavServer::RegisterRouterCallbacks()
+{
+    server_->SetOnClientConnected(OnRouterClientConnect);
+    server_->SetOnClientDisconnected(OnRouterClientDisconnect);
+
+    for (const MessageType type : { MessageType::PATH, MessageType::MOVE_ALONG_SURFACE, MessageType::RANDOM_POINT,
+                                    MessageType::RANDOM_POINT_AROUND, MessageType::CAST_RAY, MessageType::RANDOM_PATH,
+                                    MessageType::GET_HEIGHT, MessageType::PATH_COSTS, MessageType::PATH_TO_NEAREST,
+                                    MessageType::REACHABLE_WITHIN, MessageType::PATH_MULTI, MessageType::PATH_SESSION,
+                                    MessageType::RELOAD_MAP, MessageType::UNLOAD_MAP })
+    {
+        server_->AddCallback(static_cast<AnTcpMessageType>(type), RouteMapCallback);
+    }
+
+    server_->AddCallback(static_cast<AnTcpMessageType>(MessageType::PATH_CROSS_MAP), RouteCrossMapCallback);
+    server_->AddCallback(static_cast<AnTcpMessageType>(MessageType::CONFIGURE_FILTER), RouteConfigureFilterCallback);
+    server_->AddCallback(static_cast<AnTcpMessageType>(MessageType::GET_CONFIG), RouteGetConfigCallback);
+    server_->AddCallback(static_cast<AnTcpMessageType>(MessageType::GET_STATS), RouteGetStatsCallback);
+}
+
+void NavServer::PreloadMaps()
+{
+    std::stringstream mapIds(config_->preloadMaps);
+
+    for (std::string token; std::getline(mapIds, token, ',');)
+    {
+        int mapId = 0;
+
+        try
+        {
+            mapId = std::stoi(token);
+        }
+        catch (...)
+        {
+            LogW("sPreloadMaps: skipping invalid map id \"", token, "\"");
+            continue;
+        }
+
+        preloaders_.emplace_back([this, mapId]() { nav_->PreloadMap(mapId, config_->preloadQueries); });
+    }
+}
+
+bool NavServer::QueueReload(int mapId)
+{
+    const MapLoadState state = nav_->GetMapLoadState(mapId);
+
+    if (state == MapLoadState::NOT_LOADED || state == MapLoadState::FAILED)
+        return false;
+
+    std::lock_guard lock(reloadMutex_);
+
+    // a reload that did not start yet picks up the newest files as well
+    if (std::find(reloadQueue_.begin(), reloadQueue_.end(), mapId) != reloadQueue_.end())
+        return false;
+
+    reloadQueue_.push_back(mapId);
+
+    if (!reloader_.joinable())
+    {
+        reloader_ = std::jthread([this](std::stop_token stopToken)
+        {
+            for (;;)
+            {
+                int reloadMapId = 0;
+
+                {
+                    std::unique_lock queueLock(reloadMutex_);
+
+                    if (!reloadCondition_.wait(queueLock, stopToken, [this]() { return !reloadQueue_.empty(); }))
+                        return;
+
+                    reloadMapId = reloadQueue_.front();
+                    reloadQueue_.pop_front();
+                }
+
+                const bool ok = nav_->ReloadMap(reloadMapId);
+                LogI("ReloadMap map=", reloadMapId, ok ? " ok" : " FAIL");
+            }
+        });
+    }
+
+    reloadCondition_.notify_one();
+    return true;
 }
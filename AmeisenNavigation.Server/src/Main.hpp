@@ -3,8 +3,10 @@
 #include "NavServer.hpp"
 #include <Utils/Logger.hpp>
 
+#include <algorithm>
 #include <filesystem>
 #include <iostream>
+#include <optional>
 
 constexpr auto AMEISENNAV_VERSION = "1.8.4.0";
 
@@ -25,9 +27,59 @@ void RandomPointAroundCallback(ClientHandler* handler, AnTcpMessageType type, co
 void ConfigureFilterCallback(ClientHandler* handler, AnTcpMessageType type, const void* data, int size);
 void GetHeightCallback(ClientHandler* handler, AnTcpMessageType type, const void* data, int size);
 void GetConfigCallback(ClientHandler* handler, AnTcpMessageType type, const void* data, int size);
+void GetStatsCallback(ClientHandler* handler, AnTcpMessageType type, const void* data, int size);
+void PathCostsCallback(ClientHandler* handler, AnTcpMessageType type, const void* data, int size);
+void PathToNearestCallback(ClientHandler* handler, AnTcpMessageType type, const void* data, int size);
+void ReachableWithinCallback(ClientHandler* handler, AnTcpMessageType type, const void* data, int size);
+void PathMultiCallback(ClientHandler* handler, AnTcpMessageType type, const void* data, int size);
+void PathSessionCallback(ClientHandler* handler, AnTcpMessageType type, const void* data, int size);
+void ReloadMapCallback(ClientHandler* handler, AnTcpMessageType type, const void* data, int size);
+void UnloadMapCallback(ClientHandler* handler, AnTcpMessageType type, const void* data, int size);
+void PathCrossMapCallback(ClientHandler* handler, AnTcpMessageType type, const void* data, int size);
 
-inline void HandlePathFlagsAndSendData(ClientHandler* handler, int mapId, int flags, Path& path, Path& smoothPath,
-                                       AnTcpMessageType type, PathType pathType)
+/// Send the PATH_CROSS_MAP response, the legs of the route or none if there is no route.
+void SendCrossMapRoute(ClientHandler* handler, AnTcpMessageType type, bool ok, const std::vector<RouteLeg>& legs,
+                       float totalCost);
+
+void OnRouterClientConnect(ClientHandler* handler);
+void OnRouterClientDisconnect(ClientHandler* handler);
+
+void RouteMapCallback(ClientHandler* handler, AnTcpMessageType type, const void* data, int size);
+void RouteCrossMapCallback(ClientHandler* handler, AnTcpMessageType type, const void* data, int size);
+void RouteConfigureFilterCallback(ClientHandler* handler, AnTcpMessageType type, const void* data, int size);
+void RouteGetConfigCallback(ClientHandler* handler, AnTcpMessageType type, const void* data, int size);
+void RouteGetStatsCallback(ClientHandler* handler, AnTcpMessageType type, const void* data, int size);
+
+/// Translate the wire PathRequestFlags into the search flags of the navigation library.
+inline int GetPathSearchFlags(int flags) noexcept
+{
+    int searchFlags = static_cast<int>(PathSearchFlags::NONE);
+
+    if (flags & static_cast<int>(PathRequestFlags::SEARCH_LANDMARKS))
+        searchFlags |= static_cast<int>(PathSearchFlags::LANDMARKS);
+
+    if (flags & static_cast<int>(PathRequestFlags::SEARCH_HIERARCHICAL))
+        searchFlags |= static_cast<int>(PathSearchFlags::HIERARCHICAL);
+
+    return searchFlags;
+}
+
+/// Whether iMapAdminAccess lets the client send RELOAD_MAP and UNLOAD_MAP, which affect every client of the map.
+/// Shards of a cluster see the router as the client and the router checks the bots itself, shards on another host
+/// than their router need everyone allowed.
+inline bool IsMapAdmin(ClientHandler* handler)
+{
+    switch (g_NavServer->Config()->mapAdminAccess)
+    {
+        case 1: return handler->GetIpAddress().starts_with("127.");
+        case 2: return true;
+        default: return false;
+    }
+}
+
+/// Apply the smoothing and validation requested in flags, returns the buffer that holds the final path.
+inline Path* ApplyPathFlags(ClientHandler* handler, int mapId, int flags, Path& path, Path& smoothPath,
+                            PathType pathType)
 {
     Path* pathToSend = &path;
     Path* altPath = &smoothPath;
@@ -79,5 +131,12 @@ inline void HandlePathFlagsAndSendData(ClientHandler* handler, int mapId, int fl
         }
     }
 
+    return pathToSend;
+}
+
+inline void HandlePathFlagsAndSendData(ClientHandler* handler, int mapId, int flags, Path& path, Path& smoothPath,
+                                       AnTcpMessageType type, PathType pathType)
+{
+    const Path* pathToSend = ApplyPathFlags(handler, mapId, flags, path, smoothPath, pathType);
     handler->SendData(type, pathToSend->points, pathToSend->pointCount * sizeof(Vector3));
 }
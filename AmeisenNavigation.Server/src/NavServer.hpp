@@ -4,22 +4,33 @@
 #include "AmeisenNavigation.hpp"
 #include "Protocol.hpp"
 #include "Config/Config.hpp"
+#include "Router/ShardRouter.hpp"
 
+#include <condition_variable>
+#include <deque>
 #include <memory>
 #include <mutex>
 #include <shared_mutex>
+#include <thread>
 #include <unordered_map>
+#include <vector>
 
 /// Owns all server state: TCP server, navigation engine, config, and per-client path buffers.
 /// A single global pointer (g_NavServer) is used by C-style callbacks to reach this state.
+/// With sShards set the server is the router of a cluster, it loads no maps and has no navigation engine.
 class NavServer
 {
 public:
     NavServer(std::unique_ptr<AmeisenNavConfig> config)
         : config_(std::move(config))
-        , nav_(std::make_unique<AmeisenNavigation>(
+        , nav_(config_->shards.empty() ? std::make_unique<AmeisenNavigation>(
               config_->mmapsPath, config_->maxPolyPath, config_->maxSearchNodes,
-              config_->useAnpFileFormat, config_->factionDangerCost))
+              config_->useAnpFileFormat, config_->factionDangerCost, config_->landmarkCount,
+              config_->pathCacheSize, config_->flowFieldHotThreshold, config_->flowFieldTtl,
+              config_->heightRasterCellSize, config_->mmapTileBudgetMb, config_->mapTileFiles,
+              config_->mapIdleTimeout, config_->mapMemoryBudgetMb) : nullptr)
+        , router_(config_->shards.empty() ? nullptr
+              : std::make_unique<ShardRouter>(ShardRouter::ParseShards(config_->shards)))
         , server_(std::make_unique<AnTcpServer>(config_->ip, config_->port))
     {
     }
@@ -33,6 +44,7 @@ public:
 
     AnTcpServer* Server() noexcept { return server_.get(); }
     AmeisenNavigation* Nav() noexcept { return nav_.get(); }
+    ShardRouter* Router() noexcept { return router_.get(); }
     AmeisenNavConfig* Config() noexcept { return config_.get(); }
 
     // ── Client path buffer management ────────────────────────────────
@@ -68,16 +80,38 @@ public:
     // ── Server lifecycle ─────────────────────────────────────────────
 
     void RegisterCallbacks();
+
+    /// Forward every request to the shard of its map instead of answering it, used with sShards set.
+    void RegisterRouterCallbacks();
+
+    /// Start loading the maps of sPreloadMaps, each on its own thread. Returns right away, GET_CONFIG
+    /// reports the state of every map.
+    void PreloadMaps();
+
+    /// Queue a rebuild of a loaded map on the reload worker, which builds one map at a time so the handler
+    /// threads keep answering. False if the map is not loaded or its reload is still waiting in the queue.
+    bool QueueReload(int mapId);
+
     void Run() noexcept { server_->Run(); }
     void Stop() noexcept { server_->Stop(); }
 
 private:
     std::unique_ptr<AmeisenNavConfig> config_;
     std::unique_ptr<AmeisenNavigation> nav_;
+    std::unique_ptr<ShardRouter> router_;
     std::unique_ptr<AnTcpServer> server_;
 
     std::shared_mutex bufferMutex_;
     std::unordered_map<size_t, std::pair<std::unique_ptr<Path>, std::unique_ptr<Path>>> clientBuffers_;
+
+    // declared last, joined before the navigation engine the maps are loaded into is destroyed
+    std::vector<std::jthread> preloaders_;
+
+    std::mutex reloadMutex_;
+    std::condition_variable_any reloadCondition_;
+    std::deque<int> reloadQueue_;
+    // declared after its queue, stopped and joined first
+    std::jthread reloader_;
 };
 
 /// Single global access point for C-style callbacks.
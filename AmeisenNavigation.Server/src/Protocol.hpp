@@ -18,6 +18,15 @@ enum class MessageType
     CONFIGURE_FILTER,    // Configure the client's dtQueryFilter area costs
     GET_HEIGHT,          // Get the navmesh terrain height at a position
     GET_CONFIG,          // Get the server's configuration (meshes path, format, etc.)
+    GET_STATS,           // Get runtime statistics (path cache hits, misses, etc.)
+    PATH_COSTS,          // Get the walking cost and length from one start to many targets
+    PATH_TO_NEAREST,     // Generate a straight path to the closest of many goals
+    REACHABLE_WITHIN,    // Check if a position is reachable within a maximum path cost
+    PATH_MULTI,          // Generate a straight path along an ordered list of waypoints
+    PATH_SESSION,        // Get the next corners of the client's persistent path towards a (moving) target
+    RELOAD_MAP,          // Build a map again from its files in the background and swap it in, see iMapAdminAccess
+    UNLOAD_MAP,          // Free a map, it is loaded again by the next request for it, see iMapAdminAccess
+    PATH_CROSS_MAP,      // Plan a route over several maps, the walking and transport legs in order
 };
 
 enum class PathType
@@ -34,8 +43,21 @@ enum class PathRequestFlags : int
     SMOOTH_BEZIERCURVE = 1 << 2, // Smooth path using Bezier Curve
     VALIDATE_CPOP = 1 << 3,      // Validate smoothed path using closestPointOnPoly
     VALIDATE_MAS = 1 << 4,       // Validate smoothed path using moveAlongSurface
+    SEARCH_LANDMARKS = 1 << 5,   // Use the landmark (ALT) heuristic, falls back to findPath if not built yet
+    SEARCH_HIERARCHICAL = 1 << 6, // Plan on the tile graph first, then refine inside of the corridor tiles
+    SEARCH_BIDIRECTIONAL = 1 << 7, // Reserved (ignored), expanded more nodes than the regular search
+    SEARCH_REGION = 1 << 8,      // Confine the search to the PathRegionData that follows the request
 };
 
+enum class PathCostsFlags : int
+{
+    NONE = 0,
+    STRAIGHT_LENGTH = 1 << 0, // Measure lengths along the straight path instead of the poly corridor
+};
+
+/// Maximum number of targets of a PATH_COSTS request.
+constexpr int PATH_COSTS_MAX_TARGETS = 64;
+
 struct PathRequestData
 {
     int mapId;
@@ -44,6 +66,17 @@ struct PathRequestData
     Vector3 end;
 };
 
+/// Maximum number of vertices of a PathRegionData.
+constexpr int PATH_REGION_MAX_VERTICES = 32;
+
+/// Appended to PATH and RANDOM_PATH requests with SEARCH_REGION set. Two vertices are the corners of a box,
+/// three or more a polygon. Only x and y of the vertices are used.
+struct PathRegionData
+{
+    int vertexCount;
+    Vector3 firstVertex;
+};
+
 struct MoveRequestData
 {
     int mapId;
@@ -71,6 +104,88 @@ struct GetHeightData
     Vector3 position;
 };
 
+struct PathCostsRequestData
+{
+    int mapId;
+    int flags;
+    Vector3 start;
+    int targetCount;
+    Vector3 firstTarget;
+};
+
+/// Maximum number of goals of a PATH_TO_NEAREST request.
+constexpr int PATH_TO_NEAREST_MAX_GOALS = 64;
+
+struct PathToNearestRequestData
+{
+    int mapId;
+    int flags; // PathRequestFlags, only smoothing and validation apply
+    Vector3 start;
+    int goalCount;
+    Vector3 firstGoal;
+};
+
+struct PathCostsResult
+{
+    float cost;   // -1 if the target is not reachable
+    float length;
+};
+
+/// Maximum number of waypoints of a PATH_MULTI request.
+constexpr int PATH_MULTI_MAX_WAYPOINTS = 64;
+
+struct PathMultiRequestData
+{
+    int mapId;
+    int flags; // PathRequestFlags
+    int waypointCount;
+    Vector3 firstWaypoint;
+};
+
+struct PathSessionRequestData
+{
+    int mapId;
+    int flags; // PathRequestFlags, only the search flags apply
+    Vector3 position;
+    Vector3 target;
+    int maxCorners; // clamped to PATH_SESSION_MAX_CORNERS
+};
+
+struct PathCrossMapRequestData
+{
+    int startMapId;
+    Vector3 start;
+    int endMapId;
+    Vector3 end;
+};
+
+/// The PATH_CROSS_MAP response is this header followed by legCount legs, none if there is no route.
+struct PathCrossMapResponseHeader
+{
+    int legCount;
+    float totalCost; // -1 if there is no route
+};
+
+/// Walking legs have transportId -1 and stay on mapId, request their path with PATH when getting to them.
+/// Transport legs go from the departure on mapId to the arrival on endMapId.
+struct CrossMapLeg
+{
+    int transportId;
+    int mapId;
+    Vector3 start;
+    int endMapId;
+    Vector3 end;
+    float cost;
+};
+
+struct ReachableWithinData
+{
+    int mapId;
+    Vector3 start;
+    Vector3 end;
+    float maxCost;
+};
+
 struct GetConfigResponseHeader
 {
     int mmapFormat;
@@ -78,6 +193,34 @@ struct GetConfigResponseHeader
     int pathLength;
 };
 
+/// The GET_CONFIG response continues after the path with an int count and one entry per map that was
+/// preloaded or queried, so bots can wait for a map instead of timing out on their first request.
+struct MapStateEntry
+{
+    int mapId;
+    int state; // MapLoadState
+};
+
+struct GetStatsResponse
+{
+    unsigned long long pathCacheHits;
+    unsigned long long pathCacheMisses;
+    unsigned long long pathCacheCoalesced;
+    unsigned long long pathCacheEntries;
+    unsigned long long flowFieldHits;
+    unsigned long long flowFieldCount;
+};
+
+/// The GET_STATS response continues with an int count and one entry per loaded map.
+struct MapMemoryEntry
+{
+    int mapId;
+    int reserved;
+    unsigned long long navMeshBytes;
+    unsigned long long indexBytes;
+    long long idleSeconds;
+};
+
 struct FilterConfig
 {
     char areaId;
@@ -0,0 +1,427 @@
+#pragma once
+
+#include "AnTcpServer.hpp"
+#include "../Protocol.hpp"
+
+#include <Search/TransportGraph.hpp>
+
+#include <algorithm>
+#include <atomic>
+#include <cstdint>
+#include <cstring>
+#include <memory>
+#include <mutex>
+#include <sstream>
+#include <string>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+/// Points every shard gets on the hash ring, more points spread the maps more evenly over the shards.
+constexpr int SHARD_RING_POINTS = 64;
+
+/// Spread the bits of a key over the whole ring (splitmix64 finalizer).
+constexpr inline uint64_t MixShardKey(uint64_t key) noexcept
+{
+    key = (key ^ (key >> 30)) * 0xBF58476D1CE4E5B9ull;
+    key = (key ^ (key >> 27)) * 0x94D049BB133111EBull;
+    return key ^ (key >> 31);
+}
+
+/// Address of a server of the cluster the router forwards to.
+struct ShardAddress
+{
+    std::string Host;
+    std::string Port;
+};
+
+/// <summary>
+/// Blocking AnTCP connection from the router to one shard, only ever used by the thread of one router client.
+/// Requests are sent straight from the buffer they were received in and responses are kept framed the way
+/// they came in, so they can be passed on to the client as they are.
+/// </summary>
+class ShardConnection
+{
+    std::mutex SocketMutex; // orders opening and closing against Abort from other threads
+    SOCKET Socket;
+    AnTcpSizeType ResponseSize; // including the size and type header
+    std::vector<char> Response;
+
+public:
+    ShardConnection() noexcept
+        : SocketMutex(),
+        Socket(INVALID_SOCKET),
+        ResponseSize(0),
+        Response(sizeof(AnTcpSizeType) + sizeof(AnTcpMessageType) + ANTCP_MAX_PACKET_SIZE)
+    {}
+
+    ~ShardConnection() noexcept { Close(); }
+
+    ShardConnection(const ShardConnection&) = delete;
+    ShardConnection& operator=(const ShardConnection&) = delete;
+
+    inline bool IsConnected() const noexcept { return Socket != INVALID_SOCKET; }
+
+    bool Connect(const ShardAddress& address) noexcept
+    {
+        Close();
+
+        addrinfo hints{ 0 };
+        hints.ai_family = AF_INET;
+        hints.ai_socktype = SOCK_STREAM;
+        hints.ai_protocol = IPPROTO_TCP;
+
+        addrinfo* addrResult{ nullptr };
+
+        if (getaddrinfo(address.Host.c_str(), address.Port.c_str(), &hints, &addrResult) != 0)
+            return false;
+
+        SOCKET shardSocket = socket(addrResult->ai_family, addrResult->ai_socktype, addrResult->ai_protocol);
+
+        if (shardSocket != INVALID_SOCKET
+            && connect(shardSocket, addrResult->ai_addr, static_cast<int>(addrResult->ai_addrlen)) == SOCKET_ERROR)
+        {
+            closesocket(shardSocket);
+            shardSocket = INVALID_SOCKET;
+        }
+
+        freeaddrinfo(addrResult);
+
+        if (shardSocket == INVALID_SOCKET)
+            return false;
+
+        // requests are small and answered one at a time, Nagle would only delay them
+        int flag = 1;
+        setsockopt(shardSocket, IPPROTO_TCP, TCP_NODELAY, reinterpret_cast<const char*>(&flag), sizeof(flag));
+
+        const std::lock_guard lock(SocketMutex);
+        Socket = shardSocket;
+        return true;
+    }
+
+    void Close() noexcept
+    {
+        const std::lock_guard lock(SocketMutex);
+
+        if (Socket != INVALID_SOCKET)
+        {
+            closesocket(Socket);
+            Socket = INVALID_SOCKET;
+        }
+    }
+
+    /// Wake the thread waiting in Exchange from another thread, that thread closes the connection.
+    void Abort() noexcept
+    {
+        const std::lock_guard lock(SocketMutex);
+
+        if (Socket != INVALID_SOCKET)
+            shutdown(Socket, SD_BOTH);
+    }
+
+    /// Send a request and wait for the response of the shard. The connection is closed if either fails.
+    bool Exchange(AnTcpMessageType type, const void* data, int size) noexcept
+    {
+        if (Socket == INVALID_SOCKET || size < 0 || size > ANTCP_MAX_PACKET_SIZE)
+            return false;
+
+        const AnTcpSizeType packetSize = static_cast<AnTcpSizeType>(size + sizeof(AnTcpMessageType));
+        char header[sizeof(AnTcpSizeType) + sizeof(AnTcpMessageType)];
+        memcpy(header, &packetSize, sizeof(AnTcpSizeType));
+        memcpy(header + sizeof(AnTcpSizeType), &type, sizeof(AnTcpMessageType));
+
+        // header and payload go out in one send without copying the payload behind the header
+        WSABUF buffers[2]{ { static_cast<ULONG>(sizeof(header)), header },
+                           { static_cast<ULONG>(size), static_cast<CHAR*>(const_cast<void*>(data)) } };
+        DWORD sentBytes = 0;
+
+        if (WSASend(Socket, buffers, size > 0 ? 2 : 1, &sentBytes, 0, nullptr, nullptr) == SOCKET_ERROR
+            || sentBytes != static_cast<DWORD>(sizeof(header) + size))
+        {
+            Close();
+            return false;
+        }
+
+        AnTcpSizeType responseSize = 0;
+
+        if (!Receive(Response.data(), sizeof(AnTcpSizeType)))
+        {
+            Close();
+            return false;
+        }
+
+        memcpy(&responseSize, Response.data(), sizeof(AnTcpSizeType));
+
+        if (responseSize < static_cast<AnTcpSizeType>(sizeof(AnTcpMessageType))
+            || responseSize > static_cast<AnTcpSizeType>(sizeof(AnTcpMessageType) + ANTCP_MAX_PACKET_SIZE)
+            || !Receive(Response.data() + sizeof(AnTcpSizeType), responseSize)
+            || static_cast<AnTcpMessageType>(Response[sizeof(AnTcpSizeType)]) != type)
+        {
+            Close();
+            return false;
+        }
+
+        ResponseSize = static_cast<AnTcpSizeType>(sizeof(AnTcpSizeType)) + responseSize;
+        return true;
+    }
+
+    /// Last response including its header, as the shard sent it.
+    inline const char* GetResponsePacket() const noexcept { return Response.data(); }
+    inline size_t GetResponsePacketSize() const noexcept { return static_cast<size_t>(ResponseSize); }
+
+    /// Payload of the last response.
+    inline const char* GetResponseData() const noexcept
+    {
+        return Response.data() + sizeof(AnTcpSizeType) + sizeof(AnTcpMessageType);
+    }
+
+    inline int GetResponseSize() const noexcept
+    {
+        return ResponseSize - static_cast<int>(sizeof(AnTcpSizeType) + sizeof(AnTcpMessageType));
+    }
+
+private:
+    bool Receive(char* buffer, int size) noexcept
+    {
+        for (int offset = 0; offset < size;)
+        {
+            const int receivedBytes = recv(Socket, buffer + offset, size - offset, 0);
+
+            if (receivedBytes <= 0)
+                return false;
+
+            offset += receivedBytes;
+        }
+
+        return true;
+    }
+};
+
+/// Connections of one router client, one per shard, opened on first use. The shards keep state per
+/// connection (filter, path session, movement), so they belong to the client and are not shared.
+struct RouterSession
+{
+    std::vector<std::unique_ptr<ShardConnection>> Connections;
+    std::vector<char> Filter; // last accepted CONFIGURE_FILTER request, sent on every new connection first
+    std::atomic<bool> Closed;
+
+    explicit RouterSession(size_t shardCount)
+        : Connections(),
+        Filter(),
+        Closed(false)
+    {
+        Connections.reserve(shardCount);
+
+        for (size_t i = 0; i < shardCount; ++i)
+            Connections.push_back(std::make_unique<ShardConnection>());
+    }
+};
+
+/// <summary>
+/// Routes requests to the servers of a cluster that each serve a part of the maps. A map belongs to the shard
+/// whose point follows the map on a consistent hash ring. The points are derived from the shard addresses,
+/// so the order of the list does not matter and adding or removing a shard only moves the maps of the ring
+/// segments it takes over or gives back.
+///
+/// Cross map routes span the maps of several shards, the router plans them itself over its own transports
+/// and asks the shard of every map the route passes for the walking costs on it.
+/// </summary>
+class ShardRouter
+{
+    std::vector<ShardAddress> Shards;
+    std::vector<std::pair<uint64_t, int>> Ring; // point -> shard, sorted by point
+
+    std::mutex SessionMutex;
+    std::unordered_map<size_t, std::shared_ptr<RouterSession>> Sessions;
+
+    // transports between maps for cross map routes, replaced as a whole by LoadTransports
+    std::mutex TransportMutex;
+    std::shared_ptr<TransportGraph> Transports;
+
+public:
+    explicit ShardRouter(std::vector<ShardAddress> shards)
+        : Shards(std::move(shards)),
+        Ring(),
+        SessionMutex(),
+        Sessions(),
+        TransportMutex(),
+        Transports()
+    {
+        Ring.reserve(Shards.size() * SHARD_RING_POINTS);
+
+        for (int shard = 0; shard < static_cast<int>(Shards.size()); ++shard)
+        {
+            const std::string name = Shards[shard].Host + ':' + Shards[shard].Port;
+
+            for (int i = 0; i < SHARD_RING_POINTS; ++i)
+                Ring.emplace_back(MixShardKey(HashBytes(name.data(), name.size()) + static_cast<uint64_t>(i)), shard);
+        }
+
+        std::sort(Ring.begin(), Ring.end());
+    }
+
+    ShardRouter(const ShardRouter&) = delete;
+    ShardRouter& operator=(const ShardRouter&) = delete;
+
+    /// Parse a comma separated list of host:port, empty if any of the entries is malformed.
+    static std::vector<ShardAddress> ParseShards(const std::string& shards)
+    {
+        std::vector<ShardAddress> addresses;
+        std::stringstream entries(shards);
+
+        for (std::string entry; std::getline(entries, entry, ',');)
+        {
+            entry.erase(0, entry.find_first_not_of(' '));
+            entry.erase(entry.find_last_not_of(' ') + 1);
+
+            const size_t delim = entry.rfind(':');
+            int port = 0;
+
+            try
+            {
+                port = delim != std::string::npos ? std::stoi(entry.substr(delim + 1)) : 0;
+            }
+            catch (...) { port = 0; }
+
+            if (delim == 0 || port <= 0 || port > 65535)
+                return {};
+
+            addresses.push_back(ShardAddress{ entry.substr(0, delim), std::to_string(port) });
+        }
+
+        return addresses;
+    }
+
+    inline size_t GetShardCount() const noexcept { return Shards.size(); }
+
+    inline const ShardAddress& GetAddress(int shard) const noexcept { return Shards[shard]; }
+
+    /// Shard that serves a map.
+    inline int GetShard(int mapId) const noexcept
+    {
+        const uint64_t key = MixShardKey(static_cast<uint32_t>(mapId));
+        auto it = std::lower_bound(Ring.begin(), Ring.end(), std::make_pair(key, 0));
+        return it != Ring.end() ? it->second : Ring.front().second;
+    }
+
+    /// Read the transports for cross map routes, see TransportGraph for the format of the file. Replaces the
+    /// transports loaded before, returns their count or -1 if the file could not be read.
+    int LoadTransports(const std::string& file, int* invalidLines = nullptr)
+    {
+        auto transports = std::make_shared<TransportGraph>();
+        const int transportCount = transports->Load(file, invalidLines);
+
+        if (transportCount >= 0)
+        {
+            const std::lock_guard lock(TransportMutex);
+            Transports = std::move(transports);
+        }
+
+        return transportCount;
+    }
+
+    /// Transports for cross map routes, an empty graph if none were loaded.
+    std::shared_ptr<TransportGraph> GetTransports()
+    {
+        const std::lock_guard lock(TransportMutex);
+
+        if (!Transports)
+            Transports = std::make_shared<TransportGraph>();
+
+        return Transports;
+    }
+
+    /// Drop the walking costs on a map cached for cross map routes, after it was reloaded or unloaded.
+    void InvalidateTransportCosts(int mapId)
+    {
+        if (const auto transports = GetTransports())
+            transports->Invalidate(mapId);
+    }
+
+    /// FNV-1a of some bytes, e.g. of a shard address or of the filter of a session.
+    static inline uint64_t HashBytes(const char* bytes, size_t size) noexcept
+    {
+        uint64_t hash = 0xCBF29CE484222325ull;
+
+        for (size_t i = 0; i < size; ++i)
+            hash = (hash ^ static_cast<unsigned char>(bytes[i])) * 0x100000001B3ull;
+
+        return hash;
+    }
+
+    void OpenSession(size_t clientId)
+    {
+        const std::lock_guard lock(SessionMutex);
+        Sessions[clientId] = std::make_shared<RouterSession>(Shards.size());
+    }
+
+    /// Close the connections of a client, a request it is still waiting on returns right away. False if
+    /// the client had no session.
+    bool CloseSession(size_t clientId) noexcept
+    {
+        std::shared_ptr<RouterSession> session;
+
+        {
+            const std::lock_guard lock(SessionMutex);
+
+            if (auto it = Sessions.find(clientId); it != Sessions.end())
+            {
+                session = std::move(it->second);
+                Sessions.erase(it);
+            }
+        }
+
+        if (!session)
+            return false;
+
+        session->Closed.store(true, std::memory_order_release);
+
+        for (const auto& connection : session->Connections)
+            connection->Abort();
+
+        return true;
+    }
+
+    /// Session of a client, held by the request that uses it so it outlives a concurrent CloseSession.
+    std::shared_ptr<RouterSession> GetSession(size_t clientId) noexcept
+    {
+        const std::lock_guard lock(SessionMutex);
+        auto it = Sessions.find(clientId);
+        return it != Sessions.end() ? it->second : nullptr;
+    }
+
+    /// Send a request to a shard over the connection of the session and wait for the response. Returns the
+    /// connection holding the response, nullptr if the shard could not be reached.
+    const ShardConnection* Forward(RouterSession& session, int shard, AnTcpMessageType type, const void* data,
+                                   int size) noexcept
+    {
+        ShardConnection& connection = *session.Connections[shard];
+
+        // a connection that was open before may have been closed by the shard in the meantime (restart),
+        // that one gets a second try on a new connection
+        for (bool reused = connection.IsConnected(); !session.Closed.load(std::memory_order_acquire); reused = false)
+        {
+            if ((connection.IsConnected() || Connect(session, shard)) && connection.Exchange(type, data, size))
+                return &connection;
+
+            if (!reused)
+                break;
+        }
+
+        return nullptr;
+    }
+
+private:
+    /// Open the connection to a shard and configure the filter the client set before on it.
+    bool Connect(RouterSession& session, int shard) noexcept
+    {
+        ShardConnection& connection = *session.Connections[shard];
+
+        if (!connection.Connect(Shards[shard]))
+            return false;
+
+        return session.Filter.empty()
+            || connection.Exchange(static_cast<AnTcpMessageType>(MessageType::CONFIGURE_FILTER), session.Filter.data(),
+                                   static_cast<int>(session.Filter.size()));
+    }
+};
@@ -72,19 +72,36 @@ AmeisenNavClient* AmeisenNavigation::GetClient(size_t clientId)
 }
 
 bool AmeisenNavigation::GetPath(size_t clientId, int mapId, const Vector3& startPosition, const Vector3& endPosition,
-                                Path& path)
+                                Path& path, int searchFlags, const PathRegion* region)
 {
     AmeisenNavClient* client;
     dtNavMeshQuery* query;
+    ClientRequestLock requestLock;
 
-    if (!TryGetClientAndQuery(clientId, mapId, client, query))
+    if (!TryGetClientAndQuery(clientId, mapId, client, query, requestLock))
     {
         return false;
     }
     ANAV_DEBUG_ONLY(">> [", clientId, "] GetPath (", mapId, ") ", startPosition, " -> ", endPosition);
 
-    if (CalculateNormalPath(query, client->QueryFilter(), client->GetPolyPathBuffer(), client->GetPolyPathBufferSize(),
-                            startPosition, endPosition, path))
+    const auto indexes = GetIndexes(mapId, query->getAttachedNavMesh());
+    const Vector3 positions[]{ startPosition, endPosition };
+    NavTileLock tileLock;
+    bool found = false;
+
+    PolySearch* search = searchFlags || region ? client->GetPolySearch(MaxSearchNodes) : nullptr;
+
+    // a partial path on a streamed map may end at the border of the loaded tiles, search again with more of them
+    SearchStreamed(mapId, query, search, positions, 2, nullptr, 0.0f, tileLock, [&]()
+    {
+        bool partial = false;
+        found = CalculateNormalPath(query, client->QueryFilter(), indexes.get(), client->GetPolyPathBuffer(),
+                                    client->GetPolyPathBufferSize(), startPosition, endPosition, path, nullptr,
+                                    search, searchFlags, region, &partial);
+        return found && partial;
+    });
+
+    if (found)
     {
         path.ToWowCoords();
         return true;
@@ -94,21 +111,38 @@ bool AmeisenNavigation::GetPath(size_t clientId, int mapId, const Vector3& start
 }
 
 bool AmeisenNavigation::GetRandomPath(size_t clientId, int mapId, const Vector3& startPosition,
-                                      const Vector3& endPosition, Path& path, float maxRandomDistance)
+                                      const Vector3& endPosition, Path& path, float maxRandomDistance,
+                                      int searchFlags, const PathRegion* region)
 {
     AmeisenNavClient* client;
     dtNavMeshQuery* query;
+    ClientRequestLock requestLock;
 
-    if (!TryGetClientAndQuery(clientId, mapId, client, query))
+    if (!TryGetClientAndQuery(clientId, mapId, client, query, requestLock))
     {
         return false;
     }
     ANAV_DEBUG_ONLY(">> [", clientId, "] GetRandomPath (", mapId, ") ", startPosition, " -> ", endPosition);
 
     auto polyPathBuffer = client->GetPolyPathBuffer();
+    const auto indexes = GetIndexes(mapId, query->getAttachedNavMesh());
+    const Vector3 positions[]{ startPosition, endPosition };
+    NavTileLock tileLock;
+    bool found = false;
+
+    PolySearch* search = searchFlags || region ? client->GetPolySearch(MaxSearchNodes) : nullptr;
 
-    if (CalculateNormalPath(query, client->QueryFilter(), polyPathBuffer, client->GetPolyPathBufferSize(),
-                            startPosition, endPosition, path, polyPathBuffer))
+    // a partial path on a streamed map may end at the border of the loaded tiles, search again with more of them
+    SearchStreamed(mapId, query, search, positions, 2, nullptr, maxRandomDistance, tileLock, [&]()
+    {
+        bool partial = false;
+        found = CalculateNormalPath(query, client->QueryFilter(), indexes.get(), polyPathBuffer,
+                                    client->GetPolyPathBufferSize(), startPosition, endPosition, path,
+                                    polyPathBuffer, search, searchFlags, region, &partial);
+        return found && partial;
+    });
+
+    if (found)
     {
         for (int i = 0; i < path.pointCount; ++i)
         {
@@ -140,14 +174,17 @@ bool AmeisenNavigation::MoveAlongSurface(size_t clientId, int mapId, const Vecto
 {
     AmeisenNavClient* client;
     dtNavMeshQuery* query;
+    ClientRequestLock requestLock;
 
-    if (!TryGetClientAndQuery(clientId, mapId, client, query))
+    if (!TryGetClientAndQuery(clientId, mapId, client, query, requestLock))
     {
         return false;
     }
     ANAV_DEBUG_ONLY(">> [", clientId, "] MoveAlongSurface (", mapId, ") ", startPosition, " -> ", endPosition);
 
-    if (PolyPosition start; dtStatusSucceed(GetNearestPoly(query, client->QueryFilter(), startPosition, start)))
+    const auto tileLock = LockTiles(mapId, query, { startPosition, endPosition });
+
+    if (PolyPosition start; GetMovementPoly(client, query, mapId, startPosition, start))
     {
         Vector3 rdEnd;
         endPosition.CopyToRDCoords(rdEnd);
@@ -160,6 +197,10 @@ bool AmeisenNavigation::MoveAlongSurface(size_t clientId, int mapId, const Vecto
 
         if (dtStatusSucceed(moveAlongSurfaceStatus))
         {
+            // the client is going to stand at the end of the move next time
+            if (visitedCount > 0)
+                client->GetMovementHandle().Set(mapId, query->getAttachedNavMesh(), visited[visitedCount - 1]);
+
             positionToGoTo.ToWowCoords();
             ANAV_DEBUG_ONLY(">> [", clientId, "] moveAlongSurface: ", positionToGoTo);
             return true;
@@ -177,15 +218,19 @@ bool AmeisenNavigation::GetRandomPoint(size_t clientId, int mapId, Vector3& posi
 {
     AmeisenNavClient* client;
     dtNavMeshQuery* query;
+    ClientRequestLock requestLock;
 
-    if (!TryGetClientAndQuery(clientId, mapId, client, query))
+    if (!TryGetClientAndQuery(clientId, mapId, client, query, requestLock))
     {
         return false;
     }
     ANAV_DEBUG_ONLY(">> [", clientId, "] GetRandomPoint (", mapId, ")");
 
+    const auto tileLock = LockTiles(mapId, query, nullptr, 0);
+    const auto indexes = GetIndexes(mapId, query->getAttachedNavMesh());
+
     dtPolyRef polyRef;
-    dtStatus findRandomPointStatus = query->findRandomPoint(client->QueryFilter(), GetRandomFloat, &polyRef, position);
+    dtStatus findRandomPointStatus = FindRandomPoint(query, client->QueryFilter(), indexes.get(), &polyRef, position);
 
     if (dtStatusSucceed(findRandomPointStatus))
     {
@@ -198,122 +243,208 @@ bool AmeisenNavigation::GetRandomPoint(size_t clientId, int mapId, Vector3& posi
     return false;
 }
 
-bool AmeisenNavigation::GetRandomPointAround(size_t clientId, int mapId, const Vector3& startPosition, float radius,
-                                             Vector3& position)
+bool AmeisenNavigation::GetMultiPath(size_t clientId, int mapId, const Vector3* waypoints, int waypointCount,
+                                     Path& path, int searchFlags)
 {
     AmeisenNavClient* client;
     dtNavMeshQuery* query;
+    ClientRequestLock requestLock;
 
-    if (!TryGetClientAndQuery(clientId, mapId, client, query))
+    if (!TryGetClientAndQuery(clientId, mapId, client, query, requestLock))
     {
         return false;
     }
-    ANAV_DEBUG_ONLY(">> [", clientId, "] GetRandomPointAround (", mapId, ") startPosition: ", startPosition,
-                    " radius: ", radius);
+    ANAV_DEBUG_ONLY(">> [", clientId, "] GetMultiPath (", mapId, ") ", waypointCount, " waypoints");
+
+    path.pointCount = 0;
+
+    if (!path.points || path.maxSize <= 0 || waypointCount < 2)
+        return false;
 
-    if (PolyPosition start; dtStatusSucceed(GetNearestPoly(query, client->QueryFilter(), startPosition, start)))
+    dtQueryFilter* filter = client->QueryFilter();
+    dtPolyRef* polyPathBuffer = client->GetPolyPathBuffer();
+    const auto indexes = GetIndexes(mapId, query->getAttachedNavMesh());
+    PolySearch* search = searchFlags ? client->GetPolySearch(MaxSearchNodes) : nullptr;
+    NavTileLock tileLock;
+    bool found = false;
+
+    // a leg on a streamed map may end at the border of the loaded tiles, search again with more of them
+    SearchStreamed(mapId, query, search, waypoints, waypointCount, nullptr, 0.0f, tileLock, [&]()
     {
-        dtPolyRef polyRef;
-        dtStatus findRandomPointAroundStatus = query->findRandomPointAroundCircle(
-            start.poly, start.pos, radius, client->QueryFilter(), GetRandomFloat, &polyRef, position);
+        path.pointCount = 0;
+        found = false;
 
-        if (dtStatusSucceed(findRandomPointAroundStatus))
+        PolyPosition legStart;
+
+        if (!dtStatusSucceed(GetNearestPoly(query, filter, indexes.get(), waypoints[0], legStart)) || legStart.poly == 0)
+            return false;
+
+        for (int i = 1; i < waypointCount && !path.IsFull(); ++i)
         {
-            position.ToWowCoords();
-            return true;
-        }
-    }
+            PolyPosition legEnd;
 
-    return false;
-}
+            if (!dtStatusSucceed(GetNearestPoly(query, filter, indexes.get(), waypoints[i], legEnd)) || legEnd.poly == 0)
+            {
+                ANAV_ERROR_MSG(">> [", clientId, "] Waypoint ", i, " is not on the navmesh");
+                return false;
+            }
 
-bool AmeisenNavigation::GetHeight(size_t clientId, int mapId, const Vector3& position, Vector3& out)
-{
-    AmeisenNavClient* client;
-    dtNavMeshQuery* query;
+            int polyPathCount = 0;
+            const dtStatus polyPathStatus = CalculatePolyPath(query, filter, legStart, legEnd, polyPathBuffer,
+                                                              &polyPathCount, client->GetPolyPathBufferSize(),
+                                                              search, indexes.get(), searchFlags);
 
-    if (!TryGetClientAndQuery(clientId, mapId, client, query))
-    {
-        return false;
-    }
-    ANAV_DEBUG_ONLY(">> [", clientId, "] GetHeight (", mapId, ") ", position);
+            if (!dtStatusSucceed(polyPathStatus) || polyPathCount <= 0)
+            {
+                ANAV_ERROR_MSG(">> [", clientId, "] Failed to find leg ", i, ": ", polyPathStatus);
+                return false;
+            }
 
-    // Use large vertical extents since the caller may not know the Z at all.
-    Vector3 rdPos;
-    position.CopyToRDCoords(rdPos);
+            // every leg starts with the point the previous one ended on, overwrite it
+            const int overlap = path.pointCount > 0 ? 1 : 0;
+            int legPointCount = 0;
 
-    dtPolyRef polyRef = 0;
-    Vector3 nearestPt;
-    dtStatus findStatus = query->findNearestPoly(rdPos, HEIGHT_QUERY_EXTENTS, client->QueryFilter(), &polyRef, nearestPt);
+            const dtStatus straightPathStatus =
+                SafeFindStraightPath(query, legStart.pos, legEnd.pos, polyPathBuffer, polyPathCount,
+                                     reinterpret_cast<float*>(path.points + path.pointCount - overlap), nullptr,
+                                     nullptr, &legPointCount, path.GetSpace() + overlap);
 
-    if (dtStatusSucceed(findStatus) && polyRef != 0)
+            if (!dtStatusSucceed(straightPathStatus) || legPointCount <= 0)
+            {
+                ANAV_ERROR_MSG(">> [", clientId, "] Failed to call findStraightPath for leg ", i, ": ",
+                               straightPathStatus);
+                return false;
+            }
+
+            path.pointCount += legPointCount - overlap;
+
+            // the leg did not reach its waypoint, the following ones would start from the wrong place
+            if (dtStatusDetail(polyPathStatus, DT_PARTIAL_RESULT))
+            {
+                found = true;
+                return true;
+            }
+
+            legStart = legEnd;
+        }
+
+        found = true;
+        return false;
+    });
+
+    if (!found)
     {
-        nearestPt.ToWowCoords();
-        out = nearestPt;
-        return true;
+        path.pointCount = 0;
+        return false;
     }
 
-    return false;
+    ANAV_DEBUG_ONLY(">> GetMultiPath: ", path.pointCount, "/", path.maxSize);
+    path.ToWowCoords();
+    return true;
 }
 
-bool AmeisenNavigation::CastMovementRay(size_t clientId, int mapId, const Vector3& startPosition,
-                                        const Vector3& endPosition, dtRaycastHit* raycastHit)
+bool AmeisenNavigation::GetPathCosts(size_t clientId, int mapId, const Vector3& startPosition, const Vector3* targets,
+                                     int targetCount, PathCost* costs, Path* straightPath)
 {
     AmeisenNavClient* client;
     dtNavMeshQuery* query;
+    ClientRequestLock requestLock;
 
-    if (!TryGetClientAndQuery(clientId, mapId, client, query))
+    if (!TryGetClientAndQuery(clientId, mapId, client, query, requestLock))
     {
         return false;
     }
-    ANAV_DEBUG_ONLY(">> [", clientId, "] CastMovementRay (", mapId, ") ", startPosition, " -> ", endPosition);
+    ANAV_DEBUG_ONLY(">> [", clientId, "] GetPathCosts (", mapId, ") ", startPosition, " -> ", targetCount, " targets");
+
+    dtQueryFilter* filter = client->QueryFilter();
+    const auto indexes = GetIndexes(mapId, query->getAttachedNavMesh());
+    PolySearch* search = client->GetPolySearch(MaxSearchNodes);
+    NavTileLock tileLock;
+    PolyPosition start;
+    std::vector<PolySearchGoal> goals;
+    std::vector<int> goalTargets;
+    dtStatus status = DT_FAILURE;
 
-    if (PolyPosition start; dtStatusSucceed(GetNearestPoly(query, client->QueryFilter(), startPosition, start)))
+    // targets that were not reached on a streamed map may be behind the border of the loaded tiles
+    SearchStreamed(mapId, query, search, targets, targetCount, &startPosition, 0.0f, tileLock, [&]()
     {
-        Vector3 rdEnd;
-        endPosition.CopyToRDCoords(rdEnd);
+        goals.clear();
+        goalTargets.clear();
 
-        dtStatus castMovementRayStatus =
-            query->raycast(start.poly, start.pos, rdEnd, client->QueryFilter(), 0, raycastHit);
+        if (!dtStatusSucceed(GetNearestPoly(query, filter, indexes.get(), startPosition, start)))
+            start.poly = 0;
 
-        if (dtStatusSucceed(castMovementRayStatus))
-        {
-            return raycastHit->t == FLT_MAX;
-        }
-        else
-        {
-            ANAV_ERROR_MSG(">> [", clientId, "] Failed to call raycast: ", castMovementRayStatus);
-        }
-    }
+        if (start.poly == 0)
+            return false;
 
-    return false;
-}
+        // targets off the mesh stay unreachable
+        GetSearchGoals(query, filter, indexes.get(), targets, targetCount, goals, goalTargets);
 
-bool AmeisenNavigation::PostProcessClosestPointOnPoly(size_t clientId, int mapId, const Path& input,
-                                                      Path& output)
-{
-    AmeisenNavClient* client;
-    dtNavMeshQuery* query;
+        if (goals.empty())
+            return false;
+
+        const int goalCount = static_cast<int>(goals.size());
+
+        // the estimate must not exceed the real cost on cheap areas, or goals get settled at too high a cost
+        const NearestGoalHeuristic heuristic{ goals.data(), goalCount,
+                                              dtMin(PolyGraph::GetMinAreaCost(filter), 1.0f) };
+        status = search->FindGoals(query->getAttachedNavMesh(), start.poly, start.pos, filter, heuristic,
+                                   goals.data(), goalCount, goalCount);
+
+        return dtStatusSucceed(status) && dtStatusDetail(status, DT_PARTIAL_RESULT);
+    });
+
+    if (start.poly == 0)
+        return false;
 
-    if (!TryGetClientAndQuery(clientId, mapId, client, query))
+    std::fill_n(costs, targetCount, PathCost{});
+
+    if (goals.empty())
+        return true;
+
+    const int goalCount = static_cast<int>(goals.size());
+
+    if (dtStatusFailed(status))
     {
+        ANAV_ERROR_MSG(">> [", clientId, "] Failed to search path costs: ", status);
         return false;
     }
-    ANAV_DEBUG_ONLY(">> [", clientId, "] PostProcessClosestPointOnPoly (", mapId, ") ");
 
-    for (int i = 0; i < input.pointCount; ++i)
+    ANAV_DEBUG_ONLY(">> FindGoals: ", search->GetLastExpandedNodes(), " nodes expanded");
+
+    dtPolyRef* polyPathBuffer = client->GetPolyPathBuffer();
+
+    for (int g = 0; g < goalCount; ++g)
     {
-        if (PolyPosition start; dtStatusSucceed(GetNearestPoly(query, client->QueryFilter(), input.points[i], start)))
+        const PolySearchGoal& goal = goals[g];
+
+        if (!goal.Node)
+            continue;
+
+        PathCost& cost = costs[goalTargets[g]];
+        cost.cost = goal.Cost;
+        cost.length = goal.Length;
+
+        int polyPathCount = 0;
+
+        if (!straightPath
+            || !dtStatusSucceed(search->GetGoalPath(goal, polyPathBuffer, &polyPathCount,
+                                                    client->GetPolyPathBufferSize())))
         {
-            Vector3 closest;
-            bool posOverPoly = false;
+            continue;
+        }
 
-            if (dtStatusSucceed(query->closestPointOnPoly(start.poly, start.pos, closest, &posOverPoly)))
+        straightPath->pointCount = 0;
+
+        if (dtStatusSucceed(SafeFindStraightPath(query, start.pos, goal.Pos, polyPathBuffer, polyPathCount,
+                                                 reinterpret_cast<float*>(straightPath->points), nullptr, nullptr,
+                                                 &straightPath->pointCount, straightPath->maxSize)))
+        {
+            cost.length = 0.0f;
+
+            for (int i = 1; i < straightPath->pointCount; ++i)
             {
-                closest.ToWowCoords();
-                output.Append(&closest);
-                if (output.IsFull())
-                    break;
+                cost.length += dtVdist((*straightPath)[i - 1], (*straightPath)[i]);
             }
         }
     }
@@ -321,158 +452,1468 @@ bool AmeisenNavigation::PostProcessClosestPointOnPoly(size_t clientId, int mapId
     return true;
 }
 
-bool AmeisenNavigation::PostProcessMoveAlongSurface(size_t clientId, int mapId, const Path& input,
-                                                    Path& output)
+bool AmeisenNavigation::GetPathToNearest(size_t clientId, int mapId, const Vector3& startPosition,
+                                         const Vector3* goalPositions, int goalCount, Path& path, int* goalIndex)
 {
     AmeisenNavClient* client;
     dtNavMeshQuery* query;
+    ClientRequestLock requestLock;
 
-    if (!TryGetClientAndQuery(clientId, mapId, client, query))
+    if (!TryGetClientAndQuery(clientId, mapId, client, query, requestLock))
     {
         return false;
     }
-    ANAV_DEBUG_ONLY(">> [", clientId, "] PostProcessMoveAlongSurface (", mapId, ") ");
+    ANAV_DEBUG_ONLY(">> [", clientId, "] GetPathToNearest (", mapId, ") ", startPosition, " -> ", goalCount, " goals");
 
-    Vector3 lastPosRD;
-    input.points[0].CopyToRDCoords(lastPosRD);
-    output.TryAppend(&input.points[0]);
+    path.pointCount = 0;
 
-    for (int i = 1; i < input.pointCount; ++i)
+    if (!path.points || path.maxSize <= 0)
+        return false;
+
+    dtQueryFilter* filter = client->QueryFilter();
+    const auto indexes = GetIndexes(mapId, query->getAttachedNavMesh());
+    PolySearch* search = client->GetPolySearch(MaxSearchNodes);
+    NavTileLock tileLock;
+    PolyPosition start;
+    std::vector<PolySearchGoal> goals;
+    std::vector<int> goalTargets;
+    dtStatus status = DT_FAILURE;
+
+    // on a streamed map the goals may only be reachable through tiles behind the border of the loaded ones
+    SearchStreamed(mapId, query, search, goalPositions, goalCount, &startPosition, 0.0f, tileLock, [&]()
     {
-        if (PolyPosition start; dtStatusSucceed(GetNearestPoly(query, client->QueryFilter(), lastPosRD, start, false)))
-        {
-            Vector3 rdEnd;
-            input.points[i].CopyToRDCoords(rdEnd);
+        goals.clear();
+        goalTargets.clear();
+        status = DT_FAILURE;
 
-            float distance = dtVdist(start.pos, rdEnd);
+        if (!dtStatusSucceed(GetNearestPoly(query, filter, indexes.get(), startPosition, start)))
+            start.poly = 0;
 
-            if (distance > MOVE_ALONG_SURFACE_MAX_CHUNK)
-            {
-                Vector3 velocity;
-                dtVsub(velocity, rdEnd, start.pos);
-                dtVnormalize(velocity);
-                dtVscale(velocity, velocity, distance / std::ceilf(distance / MOVE_ALONG_SURFACE_MAX_CHUNK));
-                dtVadd(rdEnd, start.pos, velocity);
-                i--;
-            }
+        if (start.poly == 0)
+            return false;
 
-            int visitedCount = 0;
-            dtPolyRef visited[MOVE_ALONG_SURFACE_VISITED_SIZE];
-            Vector3 positionToGoTo;
+        GetSearchGoals(query, filter, indexes.get(), goalPositions, goalCount, goals, goalTargets);
 
-            dtStatus moveAlongSurfaceStatus =
-                query->moveAlongSurface(start.poly, start.pos, rdEnd, client->QueryFilter(), positionToGoTo, visited,
-                                        &visitedCount, MOVE_ALONG_SURFACE_VISITED_SIZE);
+        if (goals.empty())
+            return false;
 
-            if (dtStatusSucceed(moveAlongSurfaceStatus))
-            {
-                lastPosRD = positionToGoTo;
-                positionToGoTo.ToWowCoords();
-                output.Append(&positionToGoTo);
+        const int searchGoalCount = static_cast<int>(goals.size());
 
-                if (output.IsFull())
-                    break;
-            }
-        }
-    }
+        // the first goal that gets settled is the closest one, as long as the estimate stays below the real cost
+        // on cheap areas
+        const NearestGoalHeuristic heuristic{ goals.data(), searchGoalCount,
+                                              dtMin(PolyGraph::GetMinAreaCost(filter), 1.0f) };
+        status = search->FindGoals(query->getAttachedNavMesh(), start.poly, start.pos, filter, heuristic,
+                                   goals.data(), searchGoalCount, 1);
 
-    return true;
-}
+        ANAV_DEBUG_ONLY(">> FindGoals: ", search->GetLastExpandedNodes(), " nodes expanded");
 
-void AmeisenNavigation::SmoothPathChaikinCurve(const Path& input, Path& output) const noexcept
-{
-    ChaikinCurve::SmoothPath(input.points, input.pointCount, output.points, &output.pointCount, output.GetSpace());
-}
+        return dtStatusSucceed(status) && dtStatusDetail(status, DT_PARTIAL_RESULT);
+    });
 
-void AmeisenNavigation::SmoothPathCatmullRom(const Path& input, Path& output, int points, float alpha) const noexcept
-{
-    CatmullRomSpline::SmoothPath(input.points, input.pointCount, output.points, &output.pointCount, output.GetSpace(),
-                                 points, alpha);
-}
+    if (start.poly == 0 || goals.empty())
+        return false;
 
-void AmeisenNavigation::SmoothPathBezier(const Path& input, Path& output, int points) const noexcept
-{
-    BezierCurve::SmoothPath(input.points, input.pointCount, output.points, &output.pointCount, output.GetSpace(),
-                            points);
-}
+    const auto nearest = std::find_if(goals.begin(), goals.end(), [](const auto& goal) { return goal.Node; });
 
-bool AmeisenNavigation::TryGetClientAndQuery(size_t clientId, int mapId, AmeisenNavClient*& client,
-                                             dtNavMeshQuery*& query)
-{
+    if (dtStatusFailed(status) || nearest == goals.end())
     {
-        std::shared_lock lock(ClientsMutex);
-        auto it = Clients.find(clientId);
-        if (it == Clients.end() || !it->second)
-            return false;
-        client = it->second.get();
+        ANAV_ERROR_MSG(">> [", clientId, "] No goal reachable: ", status);
+        return false;
     }
 
-    // we already have a query
-    if (query = client->GetNavmeshQuery(mapId))
+    dtPolyRef* polyPathBuffer = client->GetPolyPathBuffer();
+    int polyPathCount = 0;
+
+    if (!dtStatusSucceed(search->GetGoalPath(*nearest, polyPathBuffer, &polyPathCount,
+                                             client->GetPolyPathBufferSize())))
     {
-        return true;
+        return false;
     }
 
-    const auto navMesh = NavSource->Get(mapId);
+    const dtStatus straightPathStatus = SafeFindStraightPath(query, start.pos, nearest->Pos, polyPathBuffer,
+                                                             polyPathCount, reinterpret_cast<float*>(path.points),
+                                                             nullptr, nullptr, &path.pointCount, path.maxSize);
 
-    // we need to allocate a new query, but first check whether we need to load a map or not
-    if (!navMesh)
+    if (!dtStatusSucceed(straightPathStatus) || path.pointCount <= 0)
     {
-        ANAV_ERROR_MSG(">> [", clientId, "] Failed load MMAPs for map '", mapId, "'");
+        ANAV_ERROR_MSG(">> [", clientId, "] Failed to call findStraightPath: ", straightPathStatus);
         return false;
     }
 
-    // allocate and init the new query
-    query = dtAllocNavMeshQuery();
+    if (goalIndex)
+        *goalIndex = goalTargets[nearest - goals.begin()];
 
-    if (!query)
+    path.ToWowCoords();
+    return true;
+}
+
+bool AmeisenNavigation::IsReachableWithin(size_t clientId, int mapId, const Vector3& startPosition,
+                                          const Vector3& endPosition, float maxCost, float* cost)
+{
+    *cost = -1.0f;
+
+    AmeisenNavClient* client;
+    dtNavMeshQuery* query;
+    ClientRequestLock requestLock;
+
+    if (!TryGetClientAndQuery(clientId, mapId, client, query, requestLock))
     {
-        ANAV_ERROR_MSG(">> [", clientId, "] Failed allocate NavMeshQuery for map '", mapId, "'");
         return false;
     }
+    ANAV_DEBUG_ONLY(">> [", clientId, "] IsReachableWithin (", mapId, ") ", startPosition, " -> ", endPosition,
+                    " maxCost: ", maxCost);
 
-    dtStatus initQueryStatus = query->init(navMesh, MaxSearchNodes);
+    if (!(maxCost >= 0.0f))
+        return false;
 
-    if (dtStatusFailed(initQueryStatus))
+    dtQueryFilter* filter = client->QueryFilter();
+    const auto indexes = GetIndexes(mapId, query->getAttachedNavMesh());
+    PolySearch* search = client->GetPolySearch(MaxSearchNodes);
+    const Vector3 positions[]{ startPosition, endPosition };
+    NavTileLock tileLock;
+    PolySearchGoal goal{};
+    dtStatus status = DT_FAILURE;
+
+    // a detour below maxCost on a streamed map may lead through tiles behind the border of the loaded ones
+    SearchStreamed(mapId, query, search, positions, 2, nullptr, 0.0f, tileLock, [&]()
     {
-        dtFreeNavMeshQuery(query);
-        ANAV_ERROR_MSG(">> [", clientId, "] Failed to init NavMeshQuery for map '", mapId, "': ", initQueryStatus);
+        PolyPosition start;
+        PolyPosition end;
+        goal.Node = nullptr;
+
+        if (!dtStatusSucceed(GetNearestPoly(query, filter, indexes.get(), startPosition, start)) || start.poly == 0
+            || !dtStatusSucceed(GetNearestPoly(query, filter, indexes.get(), endPosition, end)) || end.poly == 0)
+        {
+            return false;
+        }
+
+        goal = PolySearchGoal{ end.poly, { end.pos.x, end.pos.y, end.pos.z } };
+
+        // nodes are pruned by cost + estimate, the estimate must not exceed the real cost on cheap areas
+        const NearestGoalHeuristic heuristic{ &goal, 1, dtMin(PolyGraph::GetMinAreaCost(filter), 1.0f) };
+        status = search->FindGoals(query->getAttachedNavMesh(), start.poly, start.pos, filter, heuristic,
+                                   &goal, 1, 1, maxCost);
+
+        ANAV_DEBUG_ONLY(">> FindGoals: ", search->GetLastExpandedNodes(), " nodes expanded");
+        return dtStatusSucceed(status) && dtStatusDetail(status, DT_PARTIAL_RESULT);
+    });
+
+    if (dtStatusFailed(status) || !goal.Node)
         return false;
-    }
 
-    client->SetNavmeshQuery(mapId, query);
+    *cost = goal.Cost;
     return true;
 }
 
-bool AmeisenNavigation::CalculateNormalPath(dtNavMeshQuery* query, dtQueryFilter* filter, dtPolyRef* polyPathBuffer,
-                                            int maxPolyPathCount, const Vector3& startPosition,
-                                            const Vector3& endPosition, Path& path, dtPolyRef* visited) noexcept
+int AmeisenNavigation::LoadTransports(const std::string& file)
 {
-    // Reset output count - ensures GetSpace() returns the full buffer size
-    path.pointCount = 0;
+    auto transports = std::make_shared<TransportGraph>();
+    int invalidLines = 0;
+    const int transportCount = transports->Load(file, &invalidLines);
 
-    if (!path.points || path.maxSize <= 0)
-        return false;
+    if (transportCount < 0)
+    {
+        LogE("Failed to open transports file: ", file);
+        return -1;
+    }
 
-    PolyPosition start;
-    if (!dtStatusSucceed(GetNearestPoly(query, filter, startPosition, start)) || start.poly == 0)
-        return false;
+    if (invalidLines > 0)
+        LogW("Skipped ", invalidLines, " malformed lines of transports file: ", file);
 
-    PolyPosition end;
-    if (!dtStatusSucceed(GetNearestPoly(query, filter, endPosition, end)) || end.poly == 0)
+    {
+        std::lock_guard lock(TransportMutex);
+        Transports = std::move(transports);
+    }
+
+    LogI("Loaded ", transportCount, " transports from: ", file);
+    return transportCount;
+}
+
+bool AmeisenNavigation::GetCrossMapRoute(size_t clientId, int startMapId, const Vector3& startPosition, int endMapId,
+                                         const Vector3& endPosition, std::vector<RouteLeg>& legs, float* totalCost)
+{
+    legs.clear();
+    AmeisenNavClient* client = GetClient(clientId);
+
+    if (!client)
         return false;
 
-    int polyPathCount = 0;
-    dtStatus polyPathStatus = query->findPath(start.poly, end.poly, start.pos, end.pos, filter, polyPathBuffer,
-                                              &polyPathCount, maxPolyPathCount);
+    ANAV_DEBUG_ONLY(">> [", clientId, "] GetCrossMapRoute (", startMapId, ") ", startPosition, " -> (", endMapId,
+                    ") ", endPosition);
+
+    std::shared_ptr<TransportGraph> transports;
 
-    if (!dtStatusSucceed(polyPathStatus) || polyPathCount <= 0)
     {
-        ANAV_ERROR_MSG(">> Failed to call findPath: ", polyPathStatus);
+        std::lock_guard lock(TransportMutex);
+        transports = Transports;
+    }
+
+    // without transports only routes on one map exist
+    if (!transports)
+        transports = std::make_shared<TransportGraph>();
+
+    // one search per position the route can continue from, towards every departure of its map
+    const TransportGraph::WalkCostFn walkCosts = [this, clientId](int mapId, const Vector3& from,
+                                                                   const Vector3* targets, int targetCount,
+                                                                   PathCost* costs)
+    {
+        return GetPathCosts(clientId, mapId, from, targets, targetCount, costs);
+    };
+
+    return transports->FindRoute(startMapId, startPosition, endMapId, endPosition,
+                                 PolyGraph::GetFilterSignature(client->QueryFilter()), walkCosts, legs, totalCost);
+}
+
+bool AmeisenNavigation::UpdatePathSession(size_t clientId, int mapId, const Vector3& position, const Vector3& target,
+                                          Path& corners, int maxCorners, int searchFlags)
+{
+    corners.pointCount = 0;
+
+    AmeisenNavClient* client;
+    dtNavMeshQuery* query;
+    ClientRequestLock requestLock;
+
+    if (!TryGetClientAndQuery(clientId, mapId, client, query, requestLock))
+    {
         return false;
     }
+    ANAV_DEBUG_ONLY(">> [", clientId, "] UpdatePathSession (", mapId, ") ", position, " -> ", target);
 
-    ANAV_DEBUG_ONLY(">> findPath: ", polyPathCount, "/", maxPolyPathCount);
+    const auto tileLock = LockTiles(mapId, query, { position, target });
+
+    maxCorners = std::min({ maxCorners, corners.maxSize, PATH_SESSION_MAX_CORNERS });
+
+    if (maxCorners <= 0)
+        return false;
+
+    dtQueryFilter* filter = client->QueryFilter();
+    PathSession* session = client->GetPathSession();
+    dtPathCorridor& corridor = session->Corridor;
+
+    Vector3 rdPosition;
+    position.CopyToRDCoords(rdPosition);
+
+    Vector3 rdTarget;
+    target.CopyToRDCoords(rdTarget);
+
+    const auto drifted = [](const float* a, const float* b) noexcept
+    {
+        return dtVdist2DSqr(a, b) > dtSqr(PATH_SESSION_MAX_DRIFT);
+    };
+
+    // polys of replaced tiles fail the validation, no need to compare the tiles
+    bool replan = session->MapId != mapId || session->NavMesh != query->getAttachedNavMesh()
+        || session->SearchFlags != searchFlags || !corridor.isValid(PATH_SESSION_LOOKAHEAD, query, filter);
+
+    if (!replan)
+    {
+        replan = !corridor.movePosition(rdPosition, query, filter) || drifted(corridor.getPos(), rdPosition);
+    }
+
+    if (!replan)
+    {
+        // the end of a partial corridor is as close as it gets, only search again once the target moved
+        replan = session->Partial
+            ? drifted(session->PlannedTarget, rdTarget)
+            : !corridor.moveTargetPosition(rdTarget, query, filter) || drifted(corridor.getTarget(), rdTarget);
+    }
+
+    if (replan)
+    {
+        if (!PlanPathSession(client, query, session, mapId, rdPosition, rdTarget, searchFlags))
+            return false;
+    }
+    else
+    {
+        corridor.optimizePathTopology(query, filter);
+    }
+
+    unsigned char cornerFlags[PATH_SESSION_MAX_CORNERS];
+    dtPolyRef cornerRefs[PATH_SESSION_MAX_CORNERS];
+    corners.pointCount = corridor.findCorners(reinterpret_cast<float*>(corners.points), cornerFlags, cornerRefs,
+                                              maxCorners, query, filter);
+
+    // already standing on the target
+    if (corners.pointCount == 0)
+    {
+        dtVcopy(corners.points[0], corridor.getTarget());
+        corners.pointCount = 1;
+    }
+
+    ANAV_DEBUG_ONLY(">> PathSession: ", replan ? "replanned, " : "", corridor.getPathCount(), " polys, ",
+                    corners.pointCount, " corners");
+
+    corners.ToWowCoords();
+    return true;
+}
+
+bool AmeisenNavigation::GetRandomPointAround(size_t clientId, int mapId, const Vector3& startPosition, float radius,
+                                             Vector3& position)
+{
+    AmeisenNavClient* client;
+    dtNavMeshQuery* query;
+    ClientRequestLock requestLock;
+
+    if (!TryGetClientAndQuery(clientId, mapId, client, query, requestLock))
+    {
+        return false;
+    }
+    ANAV_DEBUG_ONLY(">> [", clientId, "] GetRandomPointAround (", mapId, ") startPosition: ", startPosition,
+                    " radius: ", radius);
+
+    const auto tileLock = LockTiles(mapId, query, { startPosition }, radius);
+    const auto indexes = GetIndexes(mapId, query->getAttachedNavMesh());
+
+    if (PolyPosition start;
+        dtStatusSucceed(GetNearestPoly(query, client->QueryFilter(), indexes.get(), startPosition, start)))
+    {
+        dtPolyRef polyRef;
+        dtStatus findRandomPointAroundStatus = FindRandomPointAroundCircle(
+            query, client->QueryFilter(), indexes.get(), start.poly, start.pos, radius, &polyRef, position);
+
+        if (dtStatusSucceed(findRandomPointAroundStatus))
+        {
+            position.ToWowCoords();
+            return true;
+        }
+    }
+
+    return false;
+}
+
+bool AmeisenNavigation::GetHeight(size_t clientId, int mapId, const Vector3& position, Vector3& out)
+{
+    AmeisenNavClient* client;
+    dtNavMeshQuery* query;
+    ClientRequestLock requestLock;
+
+    if (!TryGetClientAndQuery(clientId, mapId, client, query, requestLock))
+    {
+        return false;
+    }
+    ANAV_DEBUG_ONLY(">> [", clientId, "] GetHeight (", mapId, ") ", position);
+
+    const auto tileLock = LockTiles(mapId, query, { position });
+
+    // Use large vertical extents since the caller may not know the Z at all.
+    Vector3 rdPos;
+    position.CopyToRDCoords(rdPos);
+
+    // one lookup in the height raster, cells it can not interpolate are left to findNearestPoly
+    if (const auto indexes = GetIndexes(mapId, query->getAttachedNavMesh()); indexes && indexes->Heights)
+    {
+        float height;
+
+        if (indexes->Heights->TryGetHeight(client->QueryFilter(), rdPos, &height))
+        {
+            out = Vector3(position.x, position.y, height);
+            return true;
+        }
+    }
+
+    dtPolyRef polyRef = 0;
+    Vector3 nearestPt;
+    dtStatus findStatus = query->findNearestPoly(rdPos, HEIGHT_QUERY_EXTENTS, client->QueryFilter(), &polyRef, nearestPt);
+
+    if (dtStatusSucceed(findStatus) && polyRef != 0)
+    {
+        nearestPt.ToWowCoords();
+        out = nearestPt;
+        return true;
+    }
+
+    return false;
+}
+
+bool AmeisenNavigation::CastMovementRay(size_t clientId, int mapId, const Vector3& startPosition,
+                                        const Vector3& endPosition, dtRaycastHit* raycastHit)
+{
+    AmeisenNavClient* client;
+    dtNavMeshQuery* query;
+    ClientRequestLock requestLock;
+
+    if (!TryGetClientAndQuery(clientId, mapId, client, query, requestLock))
+    {
+        return false;
+    }
+    ANAV_DEBUG_ONLY(">> [", clientId, "] CastMovementRay (", mapId, ") ", startPosition, " -> ", endPosition);
+
+    const auto tileLock = LockTiles(mapId, query, { startPosition, endPosition });
+
+    if (PolyPosition start; GetMovementPoly(client, query, mapId, startPosition, start))
+    {
+        Vector3 rdEnd;
+        endPosition.CopyToRDCoords(rdEnd);
+
+        dtStatus castMovementRayStatus =
+            query->raycast(start.poly, start.pos, rdEnd, client->QueryFilter(), 0, raycastHit);
+
+        if (dtStatusSucceed(castMovementRayStatus))
+        {
+            return raycastHit->t == FLT_MAX;
+        }
+        else
+        {
+            ANAV_ERROR_MSG(">> [", clientId, "] Failed to call raycast: ", castMovementRayStatus);
+        }
+    }
+
+    return false;
+}
+
+bool AmeisenNavigation::PostProcessClosestPointOnPoly(size_t clientId, int mapId, const Path& input,
+                                                      Path& output)
+{
+    AmeisenNavClient* client;
+    dtNavMeshQuery* query;
+    ClientRequestLock requestLock;
+
+    if (!TryGetClientAndQuery(clientId, mapId, client, query, requestLock))
+    {
+        return false;
+    }
+    ANAV_DEBUG_ONLY(">> [", clientId, "] PostProcessClosestPointOnPoly (", mapId, ") ");
+
+    const auto tileLock = LockTiles(mapId, query, input.points, input.pointCount);
+    const auto indexes = GetIndexes(mapId, query->getAttachedNavMesh());
+
+    for (int i = 0; i < input.pointCount; ++i)
+    {
+        if (PolyPosition start;
+            dtStatusSucceed(GetNearestPoly(query, client->QueryFilter(), indexes.get(), input.points[i], start)))
+        {
+            Vector3 closest;
+            bool posOverPoly = false;
+
+            if (dtStatusSucceed(query->closestPointOnPoly(start.poly, start.pos, closest, &posOverPoly)))
+            {
+                closest.ToWowCoords();
+                output.Append(&closest);
+                if (output.IsFull())
+                    break;
+            }
+        }
+    }
+
+    return true;
+}
+
+bool AmeisenNavigation::PostProcessMoveAlongSurface(size_t clientId, int mapId, const Path& input,
+                                                    Path& output)
+{
+    AmeisenNavClient* client;
+    dtNavMeshQuery* query;
+    ClientRequestLock requestLock;
+
+    if (!TryGetClientAndQuery(clientId, mapId, client, query, requestLock))
+    {
+        return false;
+    }
+    ANAV_DEBUG_ONLY(">> [", clientId, "] PostProcessMoveAlongSurface (", mapId, ") ");
+
+    const auto tileLock = LockTiles(mapId, query, input.points, input.pointCount);
+    const auto indexes = GetIndexes(mapId, query->getAttachedNavMesh());
+
+    Vector3 lastPosRD;
+    input.points[0].CopyToRDCoords(lastPosRD);
+    output.TryAppend(&input.points[0]);
+
+    for (int i = 1; i < input.pointCount; ++i)
+    {
+        if (PolyPosition start;
+            dtStatusSucceed(GetNearestPoly(query, client->QueryFilter(), indexes.get(), lastPosRD, start, false)))
+        {
+            Vector3 rdEnd;
+            input.points[i].CopyToRDCoords(rdEnd);
+
+            float distance = dtVdist(start.pos, rdEnd);
+
+            if (distance > MOVE_ALONG_SURFACE_MAX_CHUNK)
+            {
+                Vector3 velocity;
+                dtVsub(velocity, rdEnd, start.pos);
+                dtVnormalize(velocity);
+                dtVscale(velocity, velocity, distance / std::ceilf(distance / MOVE_ALONG_SURFACE_MAX_CHUNK));
+                dtVadd(rdEnd, start.pos, velocity);
+                i--;
+            }
+
+            int visitedCount = 0;
+            dtPolyRef visited[MOVE_ALONG_SURFACE_VISITED_SIZE];
+            Vector3 positionToGoTo;
+
+            dtStatus moveAlongSurfaceStatus =
+                query->moveAlongSurface(start.poly, start.pos, rdEnd, client->QueryFilter(), positionToGoTo, visited,
+                                        &visitedCount, MOVE_ALONG_SURFACE_VISITED_SIZE);
+
+            if (dtStatusSucceed(moveAlongSurfaceStatus))
+            {
+                lastPosRD = positionToGoTo;
+                positionToGoTo.ToWowCoords();
+                output.Append(&positionToGoTo);
+
+                if (output.IsFull())
+                    break;
+            }
+        }
+    }
+
+    return true;
+}
+
+void AmeisenNavigation::SmoothPathChaikinCurve(const Path& input, Path& output) const noexcept
+{
+    ChaikinCurve::SmoothPath(input.points, input.pointCount, output.points, &output.pointCount, output.GetSpace());
+}
+
+void AmeisenNavigation::SmoothPathCatmullRom(const Path& input, Path& output, int points, float alpha) const noexcept
+{
+    CatmullRomSpline::SmoothPath(input.points, input.pointCount, output.points, &output.pointCount, output.GetSpace(),
+                                 points, alpha);
+}
+
+void AmeisenNavigation::SmoothPathBezier(const Path& input, Path& output, int points) const noexcept
+{
+    BezierCurve::SmoothPath(input.points, input.pointCount, output.points, &output.pointCount, output.GetSpace(),
+                            points);
+}
+
+bool AmeisenNavigation::GetMovementPoly(AmeisenNavClient* client, dtNavMeshQuery* query, int mapId,
+                                        const Vector3& position, PolyPosition& poly) const noexcept
+{
+    const dtNavMesh* navMesh = query->getAttachedNavMesh();
+    const dtQueryFilter* filter = client->QueryFilter();
+    MovementHandle& handle = client->GetMovementHandle();
+
+    Vector3 rdPosition;
+    position.CopyToRDCoords(rdPosition);
+
+    if (handle.TryLocate(mapId, navMesh, filter, rdPosition, NEAREST_POLY_EXTENTS[1], poly))
+    {
+        handle.Set(mapId, navMesh, poly.poly);
+        return true;
+    }
+
+    // teleported, or moved more than one poly since the last query
+    const auto indexes = GetIndexes(mapId, navMesh);
+
+    if (!dtStatusSucceed(GetNearestPoly(query, filter, indexes.get(), rdPosition, poly, false)) || poly.poly == 0)
+    {
+        handle.Set(mapId, navMesh, 0);
+        return false;
+    }
+
+    handle.Set(mapId, navMesh, poly.poly);
+    return true;
+}
+
+bool AmeisenNavigation::TryGetClientAndQuery(size_t clientId, int mapId, AmeisenNavClient*& client,
+                                             dtNavMeshQuery*& query, ClientRequestLock& requestLock)
+{
+    {
+        std::shared_lock lock(ClientsMutex);
+        auto it = Clients.find(clientId);
+        if (it == Clients.end() || !it->second)
+            return false;
+        client = it->second.get();
+    }
+
+    // the map sweeper releases the queries of clients that are not in a request
+    requestLock = client->LockRequest();
+
+    // we already have a query and the navmesh it was initialised with is still the current one
+    const uint64_t generation = NavSource->GetGeneration();
+
+    if (query = client->GetNavmeshQuery(mapId, generation))
+    {
+        return true;
+    }
+
+    // maps may have been unloaded or reloaded since, let go of the navmeshes that are not current anymore
+    client->ReleaseNavmeshQueries([this, mapId](int queryMapId, const dtNavMesh* navMesh)
+    {
+        return queryMapId != mapId && NavSource->GetIfLoaded(queryMapId).get() != navMesh;
+    });
+
+    const NavMeshRef navMesh = NavSource->Get(mapId);
+
+    // we need to allocate a new query, but first check whether we need to load a map or not
+    if (!navMesh)
+    {
+        ANAV_ERROR_MSG(">> [", clientId, "] Failed load MMAPs for map '", mapId, "'");
+        return false;
+    }
+
+    // the map may have been reloaded, init the query again for the new navmesh, it keeps its node pool
+    if (query = client->GetNavmeshQuery(mapId))
+    {
+        if (query->getAttachedNavMesh() != navMesh.get())
+        {
+            dtStatus initQueryStatus = query->init(navMesh.get(), MaxSearchNodes);
+
+            if (dtStatusFailed(initQueryStatus))
+            {
+                client->ReleaseNavmeshQueries([mapId](int queryMapId, const dtNavMesh*) { return queryMapId == mapId; });
+                ANAV_ERROR_MSG(">> [", clientId, "] Failed to init NavMeshQuery for map '", mapId, "': ", initQueryStatus);
+                return false;
+            }
+        }
+
+        client->SetNavmeshQuery(mapId, query, navMesh, generation, GetMapUsage(mapId));
+        QueueIndexBuild(mapId, navMesh);
+        return true;
+    }
+
+    // preloaded maps come with initialised queries
+    if (query = TakeWarmQuery(mapId, navMesh.get()))
+    {
+        client->SetNavmeshQuery(mapId, query, navMesh, generation, GetMapUsage(mapId));
+        QueueIndexBuild(mapId, navMesh);
+        return true;
+    }
+
+    // allocate and init the new query
+    query = dtAllocNavMeshQuery();
+
+    if (!query)
+    {
+        ANAV_ERROR_MSG(">> [", clientId, "] Failed allocate NavMeshQuery for map '", mapId, "'");
+        return false;
+    }
+
+    dtStatus initQueryStatus = query->init(navMesh.get(), MaxSearchNodes);
+
+    if (dtStatusFailed(initQueryStatus))
+    {
+        dtFreeNavMeshQuery(query);
+        ANAV_ERROR_MSG(">> [", clientId, "] Failed to init NavMeshQuery for map '", mapId, "': ", initQueryStatus);
+        return false;
+    }
+
+    client->SetNavmeshQuery(mapId, query, navMesh, generation, GetMapUsage(mapId));
+    QueueIndexBuild(mapId, navMesh);
+    return true;
+}
+
+dtNavMeshQuery* AmeisenNavigation::TakeWarmQuery(int mapId, const dtNavMesh* navMesh)
+{
+    std::lock_guard lock(PreloadMutex);
+    auto& state = LoadStates[mapId];
+
+    // maps that were not preloaded are reported from their first query on
+    if (state != MapLoadState::LOADING)
+        state = MapLoadState::INDEXING;
+
+    auto it = WarmQueries.find(mapId);
+
+    while (it != WarmQueries.end() && !it->second.empty())
+    {
+        NavMeshQueryPtr query = std::move(it->second.back());
+        it->second.pop_back();
+
+        // queries of a map that got reloaded since are initialised again, they keep their node pool
+        if (query->getAttachedNavMesh() == navMesh || dtStatusSucceed(query->init(navMesh, MaxSearchNodes)))
+            return query.release();
+    }
+
+    return nullptr;
+}
+
+bool AmeisenNavigation::PreloadMap(int mapId, int warmQueryCount)
+{
+    {
+        std::lock_guard lock(PreloadMutex);
+        LoadStates[mapId] = MapLoadState::LOADING;
+    }
+
+    const auto start = std::chrono::high_resolution_clock::now();
+    const NavMeshRef navMesh = NavSource->Get(mapId);
+    GetMapUsage(mapId)->Pinned = true;
+
+    if (!navMesh)
+    {
+        std::lock_guard lock(PreloadMutex);
+        LoadStates[mapId] = MapLoadState::FAILED;
+        ANAV_ERROR_MSG("Failed to preload map '", mapId, "'");
+        return false;
+    }
+
+    // init allocates and clears the node pool and open list, the expensive part of a new query
+    std::vector<NavMeshQueryPtr> queries;
+    queries.reserve(static_cast<size_t>(std::max(warmQueryCount, 0)));
+
+    for (int i = 0; i < warmQueryCount; ++i)
+    {
+        NavMeshQueryPtr query(dtAllocNavMeshQuery());
+
+        if (!query || dtStatusFailed(query->init(navMesh.get(), MaxSearchNodes)))
+            break;
+
+        queries.push_back(std::move(query));
+    }
+
+    const size_t warmQueries = queries.size();
+
+    {
+        std::lock_guard lock(PreloadMutex);
+        auto& pool = WarmQueries[mapId];
+
+        for (auto& query : queries)
+            pool.push_back(std::move(query));
+
+        LoadStates[mapId] = MapLoadState::INDEXING;
+    }
+
+    QueueIndexBuild(mapId, navMesh);
+
+    const auto ms = std::chrono::duration_cast<std::chrono::milliseconds>(
+        std::chrono::high_resolution_clock::now() - start).count();
+    LogI("Preloaded map '", mapId, "' with ", warmQueries, " queries, ", ms, "ms");
+    return true;
+}
+
+bool AmeisenNavigation::ReloadMap(int mapId)
+{
+    NavMeshRef previous = NavSource->Reload(mapId);
+
+    if (!previous)
+        return false;
+
+    InvalidateNavMesh(previous.get());
+    InvalidateTransportCosts(mapId);
+
+    // gone right here if no client is still using it, the indexes of the new navmesh are built meanwhile
+    previous.reset();
+
+    if (const NavMeshRef navMesh = NavSource->Get(mapId))
+        QueueIndexBuild(mapId, navMesh);
+
+    return true;
+}
+
+bool AmeisenNavigation::UnloadMap(int mapId)
+{
+    NavMeshRef navMesh = NavSource->Unload(mapId);
+
+    if (!navMesh)
+        return false;
+
+    InvalidateNavMesh(navMesh.get());
+    InvalidateTransportCosts(mapId);
+
+    {
+        std::lock_guard lock(PreloadMutex);
+        LoadStates.erase(mapId);
+        WarmQueries.erase(mapId);
+    }
+
+    LogI("Unloaded map '", mapId, "'");
+    return true;
+}
+
+std::vector<MapMemoryUsage> AmeisenNavigation::GetMapMemoryUsage() const
+{
+    std::vector<int> mapIds;
+
+    {
+        std::lock_guard lock(UsageMutex);
+        mapIds.reserve(Usages.size());
+
+        for (const auto& [mapId, usage] : Usages)
+            mapIds.push_back(mapId);
+    }
+
+    std::sort(mapIds.begin(), mapIds.end());
+
+    const int64_t now = MapUsage::Now();
+    std::vector<MapMemoryUsage> memoryUsage;
+
+    for (const int mapId : mapIds)
+    {
+        if (const NavMeshRef navMesh = NavSource->GetIfLoaded(mapId))
+            memoryUsage.push_back(GetMapMemoryUsage(mapId, navMesh.get(), now));
+    }
+
+    return memoryUsage;
+}
+
+MapLoadState AmeisenNavigation::GetMapLoadState(int mapId) const
+{
+    {
+        std::lock_guard lock(PreloadMutex);
+        auto it = LoadStates.find(mapId);
+
+        if (it == LoadStates.end())
+            return MapLoadState::NOT_LOADED;
+
+        if (it->second != MapLoadState::INDEXING)
+            return it->second;
+    }
+
+    // streamed maps have no indexes to wait for
+    if (NavSource->StreamsTiles())
+        return MapLoadState::READY;
+
+    std::lock_guard lock(IndexMutex);
+    auto it = Indexes.find(mapId);
+
+    return it != Indexes.end() && it->second && it->second->Built.load(std::memory_order_acquire)
+        ? MapLoadState::READY
+        : MapLoadState::INDEXING;
+}
+
+std::vector<std::pair<int, MapLoadState>> AmeisenNavigation::GetMapLoadStates() const
+{
+    std::vector<std::pair<int, MapLoadState>> states;
+
+    {
+        std::lock_guard lock(PreloadMutex);
+        states.reserve(LoadStates.size());
+
+        for (const auto& [mapId, state] : LoadStates)
+            states.emplace_back(mapId, state);
+    }
+
+    std::sort(states.begin(), states.end());
+
+    for (auto& [mapId, state] : states)
+        state = GetMapLoadState(mapId);
+
+    return states;
+}
+
+NavTileLock AmeisenNavigation::LockTiles(int mapId, const dtNavMeshQuery* query, const Vector3* positions, int count,
+                                         const Vector3* origin, float margin) const noexcept
+{
+    if (!NavSource->StreamsTiles())
+        return {};
+
+    if (count <= 0 && !origin)
+        return NavSource->LockTiles(mapId, query->getAttachedNavMesh(), nullptr, nullptr);
+
+    Vector3 bmin;
+    Vector3 bmax;
+    GetLockBounds(positions, count, origin, margin, bmin, bmax);
+    return NavSource->LockTiles(mapId, query->getAttachedNavMesh(), bmin, bmax);
+}
+
+void AmeisenNavigation::GetLockBounds(const Vector3* positions, int count, const Vector3* origin, float margin,
+                                      Vector3& bmin, Vector3& bmax) noexcept
+{
+    (origin ? *origin : positions[0]).CopyToRDCoords(bmin);
+    bmax = bmin;
+
+    for (int i = 0; i < count; ++i)
+    {
+        Vector3 rdPosition;
+        positions[i].CopyToRDCoords(rdPosition);
+        dtVmin(bmin, rdPosition);
+        dtVmax(bmax, rdPosition);
+    }
+
+    bmin.x -= margin;
+    bmin.z -= margin;
+    bmax.x += margin;
+    bmax.z += margin;
+}
+
+void AmeisenNavigation::QueueIndexBuild(int mapId, const NavMeshRef& navMesh)
+{
+    // the indexes cover the tiles that are loaded when they get built
+    if (NavSource->StreamsTiles())
+        return;
+
+    // a query can still hold a navmesh that was reloaded or unloaded since, nothing would remove its indexes
+    // again and they would keep it alive
+    if (NavSource->GetIfLoaded(mapId) != navMesh)
+        return;
+
+    // released outside of the lock, the replaced indexes may hold the last reference to their navmesh
+    std::shared_ptr<MapIndexes> replaced;
+
+    {
+        std::lock_guard lock(IndexMutex);
+        auto& current = Indexes[mapId];
+
+        if (current && current->NavMesh == navMesh.get())
+            return;
+
+        replaced = std::move(current);
+        current = std::make_shared<MapIndexes>();
+        StartIndexBuild(mapId, navMesh, current);
+    }
+
+    // ReloadMap or UnloadMap may have run since the check above and invalidated the navmesh before the
+    // indexes were added
+    if (NavSource->GetIfLoaded(mapId) != navMesh)
+        InvalidateNavMesh(navMesh.get());
+}
+
+void AmeisenNavigation::StartIndexBuild(int mapId, const NavMeshRef& navMesh, std::shared_ptr<MapIndexes> indexes)
+{
+    indexes->NavMesh = navMesh.get();
+    indexes->NavMeshOwner = navMesh;
+    indexes->Tiles = std::make_unique<TileGraph>(navMesh.get());
+    indexes->NearestPolys = std::make_unique<NearestPolyGrid>(navMesh.get());
+    indexes->RandomPoints = std::make_unique<RandomPointTable>(navMesh.get());
+
+    if (LandmarkCount > 0)
+        indexes->Landmarks = std::make_unique<LandmarkTable>(navMesh.get(), LandmarkCount);
+
+    if (HeightRasterCellSize > 0.0f)
+        indexes->Heights = std::make_unique<HeightRaster>(navMesh.get(), HeightRasterCellSize);
+
+    ANAV_DEBUG_ONLY(">> Building search indexes for map '", mapId, "'");
+
+    // builders that are done no longer take IndexMutex, joining them under it can not deadlock
+    std::erase_if(IndexBuilders, [](const IndexBuilder& builder)
+    {
+        return builder.Done->load(std::memory_order_acquire);
+    });
+
+    auto done = std::make_shared<std::atomic<bool>>(false);
+
+    IndexBuilders.push_back(IndexBuilder{ done, std::jthread([mapId, indexes, done](std::stop_token stopToken) mutable
+    {
+        try
+        {
+            auto start = std::chrono::high_resolution_clock::now();
+            const auto elapsedMs = [&start]()
+            {
+                const auto now = std::chrono::high_resolution_clock::now();
+                const auto ms = std::chrono::duration_cast<std::chrono::milliseconds>(now - start).count();
+                start = now;
+                return ms;
+            };
+
+            if (indexes->NearestPolys->Build())
+            {
+                LogI("Built nearest poly grid for map '", mapId, "': ", indexes->NearestPolys->GetTileCount(),
+                     " tiles, ", indexes->NearestPolys->GetMemoryUsage() / 1024, " KB, ", elapsedMs(), "ms");
+            }
+
+            if (!stopToken.stop_requested() && indexes->RandomPoints->Build())
+            {
+                LogI("Built random point table for map '", mapId, "': ", indexes->RandomPoints->GetCellCount(),
+                     " cells, ", indexes->RandomPoints->GetMemoryUsage() / 1024, " KB, ", elapsedMs(), "ms");
+            }
+
+            if (!stopToken.stop_requested() && indexes->Tiles->Build())
+            {
+                LogI("Built tile graph for map '", mapId, "': ", indexes->Tiles->GetNodeCount(), " nodes, ",
+                     indexes->Tiles->GetMemoryUsage() / 1024, " KB, ", elapsedMs(), "ms");
+            }
+
+            if (indexes->Landmarks && !stopToken.stop_requested() && indexes->Landmarks->Build(stopToken))
+            {
+                LogI("Built landmark table for map '", mapId, "': ", indexes->Landmarks->GetLandmarkCount(),
+                     " landmarks, ", indexes->Landmarks->GetMemoryUsage() / 1024, " KB, ", elapsedMs(), "ms");
+            }
+        }
+        catch (const std::exception& e) { ANAV_ERROR_MSG("Failed to build search indexes for map '", mapId, "': ", e.what()); }
+
+        indexes->Built.store(true, std::memory_order_release);
+
+        // the indexes may hold the last reference to their navmesh, whose release takes IndexMutex
+        indexes.reset();
+        done->store(true, std::memory_order_release);
+    }) });
+}
+
+void AmeisenNavigation::InvalidateNavMesh(const dtNavMesh* navMesh)
+{
+    if (CorridorCache)
+        CorridorCache->Invalidate(navMesh);
+
+    if (FlowFields)
+        FlowFields->Invalidate(navMesh);
+
+    // released outside of the lock, the indexes may hold the last reference to the navmesh
+    std::vector<std::shared_ptr<MapIndexes>> invalidated;
+
+    {
+        std::lock_guard lock(IndexMutex);
+
+        for (auto& [mapId, indexes] : Indexes)
+        {
+            if (indexes && indexes->NavMesh == navMesh)
+                invalidated.push_back(std::move(indexes));
+        }
+    }
+}
+
+void AmeisenNavigation::InvalidateTransportCosts(int mapId)
+{
+    std::shared_ptr<TransportGraph> transports;
+
+    {
+        std::lock_guard lock(TransportMutex);
+        transports = Transports;
+    }
+
+    if (transports)
+        transports->Invalidate(mapId);
+}
+
+std::shared_ptr<MapUsage> AmeisenNavigation::GetMapUsage(int mapId)
+{
+    std::lock_guard lock(UsageMutex);
+    auto& usage = Usages[mapId];
+
+    if (!usage)
+        usage = std::make_shared<MapUsage>();
+
+    return usage;
+}
+
+MapMemoryUsage AmeisenNavigation::GetMapMemoryUsage(int mapId, const dtNavMesh* navMesh, int64_t now) const
+{
+    MapMemoryUsage memoryUsage{ mapId, 0, 0, 0 };
+
+    const auto indexes = GetIndexes(mapId, navMesh);
+
+    {
+        // streamed tiles are added and removed while the map is in use
+        const NavTileLock tileLock = NavSource->LockTiles(mapId, navMesh, nullptr, nullptr);
+        memoryUsage.NavMeshBytes = GetNavMeshMemoryUsage(navMesh);
+
+        // only the rasters of tiles that are still in the navmesh count
+        if (indexes && indexes->Heights)
+            indexes->Heights->ReleaseStaleTiles();
+    }
+
+    if (indexes)
+    {
+        // the height raster grows on demand and is locked, the others can only be read once their build is done
+        if (indexes->Heights)
+            memoryUsage.IndexBytes += indexes->Heights->GetMemoryUsage();
+
+        if (indexes->Built.load(std::memory_order_acquire))
+        {
+            memoryUsage.IndexBytes += indexes->Tiles->GetMemoryUsage() + indexes->NearestPolys->GetMemoryUsage()
+                + indexes->RandomPoints->GetMemoryUsage()
+                + (indexes->Landmarks ? indexes->Landmarks->GetMemoryUsage() : 0);
+        }
+    }
+
+    std::lock_guard lock(UsageMutex);
+    auto it = Usages.find(mapId);
+
+    if (it != Usages.end())
+        memoryUsage.IdleSeconds = now - it->second->LastUsed.load(std::memory_order_relaxed);
+
+    return memoryUsage;
+}
+
+void AmeisenNavigation::SweepMaps()
+{
+    struct LoadedMap
+    {
+        int MapId;
+        int64_t LastUsed;
+        bool Pinned;
+        size_t Bytes;
+    };
+
+    std::vector<std::pair<int, std::shared_ptr<MapUsage>>> usages;
+
+    {
+        std::lock_guard lock(UsageMutex);
+        usages.assign(Usages.begin(), Usages.end());
+    }
+
+    const int64_t now = MapUsage::Now();
+    std::vector<LoadedMap> loaded;
+    size_t totalBytes = 0;
+
+    for (const auto& [mapId, usage] : usages)
+    {
+        const NavMeshRef navMesh = NavSource->GetIfLoaded(mapId);
+
+        if (!navMesh)
+            continue;
+
+        const int64_t lastUsed = usage->LastUsed.load(std::memory_order_relaxed);
+
+        if (!usage->Pinned && MapIdleTimeout > 0 && now - lastUsed > MapIdleTimeout)
+        {
+            LogI("Map '", mapId, "' was idle for ", now - lastUsed, "s");
+            UnloadMap(mapId);
+            continue;
+        }
+
+        const MapMemoryUsage memoryUsage = GetMapMemoryUsage(mapId, navMesh.get(), now);
+        loaded.push_back(LoadedMap{ mapId, lastUsed, usage->Pinned, memoryUsage.NavMeshBytes + memoryUsage.IndexBytes });
+        totalBytes += loaded.back().Bytes;
+    }
+
+    if (!MapMemoryBudget || totalBytes <= MapMemoryBudget)
+        return;
+
+    std::sort(loaded.begin(), loaded.end(), [](const LoadedMap& a, const LoadedMap& b) { return a.LastUsed < b.LastUsed; });
+
+    for (size_t i = 0; i + 1 < loaded.size() && totalBytes > MapMemoryBudget; ++i)
+    {
+        if (loaded[i].Pinned)
+            continue;
+
+        LogI("Maps use ", totalBytes >> 20, " MB of the ", MapMemoryBudget >> 20, " MB budget, evicting map '",
+             loaded[i].MapId, "'");
+
+        if (UnloadMap(loaded[i].MapId))
+            totalBytes -= loaded[i].Bytes;
+    }
+}
+
+void AmeisenNavigation::ReleaseIdleQueries()
+{
+    std::shared_lock lock(ClientsMutex);
+
+    for (const auto& [clientId, client] : Clients)
+    {
+        // clients in a request release them on their own with their next one
+        client->TryReleaseNavmeshQueries([this](int mapId, const dtNavMesh* navMesh)
+        {
+            return NavSource->GetIfLoaded(mapId).get() != navMesh;
+        });
+    }
+}
+
+std::shared_ptr<const MapIndexes> AmeisenNavigation::GetIndexes(int mapId, const dtNavMesh* navMesh) const
+{
+    std::shared_lock lock(IndexMutex);
+    auto it = Indexes.find(mapId);
+
+    if (it != Indexes.end() && it->second && it->second->NavMesh == navMesh)
+    {
+        return it->second;
+    }
+
+    return nullptr;
+}
+
+dtStatus AmeisenNavigation::FindNearestPoly(const dtNavMeshQuery* query, const dtQueryFilter* filter,
+                                            const MapIndexes* indexes, const float* center, const float* halfExtents,
+                                            dtPolyRef* polyRef, float* nearest) const noexcept
+{
+    if (indexes && indexes->NearestPolys->IsReady()
+        && indexes->NearestPolys->FindPolyBelow(filter, center, halfExtents[1], polyRef, nearest))
+    {
+        return DT_SUCCESS;
+    }
+
+    return query->findNearestPoly(center, halfExtents, filter, polyRef, nearest);
+}
+
+dtStatus AmeisenNavigation::FindRandomPoint(const dtNavMeshQuery* query, const dtQueryFilter* filter,
+                                            const MapIndexes* indexes, dtPolyRef* randomRef, float* randomPt) const
+{
+    if (indexes && indexes->RandomPoints->IsReady()
+        && indexes->RandomPoints->GetRandomPoint(filter, GetRandomFloat, randomRef, randomPt))
+    {
+        return DT_SUCCESS;
+    }
+
+    return query->findRandomPoint(filter, GetRandomFloat, randomRef, randomPt);
+}
+
+dtStatus AmeisenNavigation::FindRandomPointAroundCircle(const dtNavMeshQuery* query, const dtQueryFilter* filter,
+                                                        const MapIndexes* indexes, dtPolyRef startRef,
+                                                        const float* center, float radius, dtPolyRef* randomRef,
+                                                        float* randomPt) const
+{
+    if (indexes && indexes->RandomPoints->IsReady()
+        && indexes->RandomPoints->GetRandomPointAroundCircle(startRef, center, radius, filter, GetRandomFloat,
+                                                             randomRef, randomPt))
+    {
+        return DT_SUCCESS;
+    }
+
+    return query->findRandomPointAroundCircle(startRef, center, radius, filter, GetRandomFloat, randomRef, randomPt);
+}
+
+dtStatus AmeisenNavigation::FindPolyPath(dtNavMeshQuery* query, dtQueryFilter* filter, const PolyPosition& start,
+                                         const PolyPosition& end, dtPolyRef* polyPathBuffer, int* polyPathCount,
+                                         int maxPolyPathCount, PolySearch* search, const MapIndexes* indexes,
+                                         int searchFlags, const PathRegion* region) noexcept
+{
+    if (search)
+    {
+        const dtNavMesh* navMesh = query->getAttachedNavMesh();
+        const LandmarkTable* landmarks = indexes && (searchFlags & static_cast<int>(PathSearchFlags::LANDMARKS))
+            && indexes->Landmarks && indexes->Landmarks->IsReady() ? indexes->Landmarks.get() : nullptr;
+
+        std::vector<unsigned int> corridorTiles;
+
+        if (indexes && (searchFlags & static_cast<int>(PathSearchFlags::HIERARCHICAL)) && indexes->Tiles->IsReady()
+            && indexes->Tiles->GetTileDistance(start.poly, end.poly) >= TILE_GRAPH_MIN_TILE_DISTANCE)
+        {
+            try
+            {
+                int abstractNodes = 0;
+
+                if (indexes->Tiles->FindCorridorTiles(start.poly, end.poly, start.pos, end.pos, filter, corridorTiles,
+                                                      &abstractNodes))
+                {
+                    ANAV_DEBUG_ONLY(">> Tile corridor: ", corridorTiles.size(), " tiles, ", abstractNodes,
+                                    " nodes expanded");
+                }
+            }
+            catch (const std::exception& e)
+            {
+                ANAV_ERROR_MSG(">> Failed to plan tile corridor: ", e.what());
+                corridorTiles.clear();
+            }
+        }
+
+        if (landmarks || !corridorTiles.empty() || region)
+        {
+            // call fn with the constraint matching the corridor and the region
+            const auto constrained = [&](const auto& fn) noexcept
+            {
+                const TileSetConstraint tiles{ navMesh, &corridorTiles };
+                const RegionConstraint inRegion{ navMesh, region };
+
+                if (region)
+                {
+                    return corridorTiles.empty()
+                        ? fn(inRegion)
+                        : fn(BothConstraints<TileSetConstraint, RegionConstraint>{ tiles, inRegion });
+                }
+
+                return corridorTiles.empty() ? fn(AnyPoly{}) : fn(tiles);
+            };
+
+            const auto run = [&]() noexcept
+            {
+                return constrained([&](const auto& constraint) noexcept
+                {
+                    if (landmarks)
+                    {
+                        const LandmarkHeuristic heuristic{ landmarks, landmarks->GetRow(end.poly), end.pos,
+                                                           PolyGraph::GetMinAreaCost(filter) };
+                        return search->FindPath(navMesh, start.poly, end.poly, start.pos, end.pos, filter, heuristic,
+                                                polyPathBuffer, polyPathCount, maxPolyPathCount, constraint);
+                    }
+
+                    return search->FindPath(navMesh, start.poly, end.poly, start.pos, end.pos, filter,
+                                            EuclideanHeuristic{ end.pos }, polyPathBuffer, polyPathCount,
+                                            maxPolyPathCount, constraint);
+                });
+            };
+
+            dtStatus status = run();
+
+            ANAV_DEBUG_ONLY(">> findPath (", landmarks ? "landmarks" : "euclidean",
+                            corridorTiles.empty() ? "" : ", corridor", region ? ", region" : "", "): ",
+                            search->GetLastExpandedNodes(), " nodes expanded");
+
+            // a corridor that turned out to be too narrow falls back to the search without it
+            if (dtStatusSucceed(status) && !corridorTiles.empty() && dtStatusDetail(status, DT_PARTIAL_RESULT))
+            {
+                corridorTiles.clear();
+                status = region ? run() : DT_FAILURE;
+            }
+
+            // the region must never be left, its partial results are final
+            if (dtStatusSucceed(status) || region)
+                return status;
+        }
+    }
+
+    return query->findPath(start.poly, end.poly, start.pos, end.pos, filter, polyPathBuffer, polyPathCount,
+                           maxPolyPathCount);
+}
+
+bool AmeisenNavigation::PlanPathSession(AmeisenNavClient* client, dtNavMeshQuery* query, PathSession* session,
+                                        int mapId, const Vector3& position, const Vector3& target,
+                                        int searchFlags) noexcept
+{
+    dtQueryFilter* filter = client->QueryFilter();
+    const dtNavMesh* navMesh = query->getAttachedNavMesh();
+
+    // a failed plan is retried on the next update
+    session->NavMesh = nullptr;
+
+    const auto indexes = GetIndexes(mapId, navMesh);
+    PolyPosition start;
+    PolyPosition end;
+
+    if (!dtStatusSucceed(GetNearestPoly(query, filter, indexes.get(), position, start, false)) || start.poly == 0
+        || !dtStatusSucceed(GetNearestPoly(query, filter, indexes.get(), target, end, false)) || end.poly == 0)
+    {
+        return false;
+    }
+    dtPolyRef* polyPathBuffer = client->GetPolyPathBuffer();
+    int polyPathCount = 0;
+
+    const dtStatus polyPathStatus = CalculatePolyPath(query, filter, start, end, polyPathBuffer, &polyPathCount,
+                                                      client->GetPolyPathBufferSize(),
+                                                      searchFlags ? client->GetPolySearch(MaxSearchNodes) : nullptr,
+                                                      indexes.get(), searchFlags);
+
+    if (!dtStatusSucceed(polyPathStatus) || polyPathCount <= 0)
+    {
+        ANAV_ERROR_MSG(">> Failed to plan path session: ", polyPathStatus);
+        return false;
+    }
+
+    session->Corridor.reset(start.poly, start.pos);
+    session->Corridor.setCorridor(end.pos, polyPathBuffer, polyPathCount);
+    session->MapId = mapId;
+    session->NavMesh = navMesh;
+    session->SearchFlags = searchFlags;
+    session->Partial = polyPathBuffer[polyPathCount - 1] != end.poly;
+    dtVcopy(session->PlannedTarget, target);
+    return true;
+}
+
+void AmeisenNavigation::GetSearchGoals(const dtNavMeshQuery* query, const dtQueryFilter* filter,
+                                       const MapIndexes* indexes, const Vector3* positions, int count,
+                                       std::vector<PolySearchGoal>& goals, std::vector<int>& goalIndices) const
+{
+    goals.reserve(count);
+    goalIndices.reserve(count);
+
+    for (int i = 0; i < count; ++i)
+    {
+        if (PolyPosition end; dtStatusSucceed(GetNearestPoly(query, filter, indexes, positions[i], end))
+            && end.poly != 0)
+        {
+            goals.push_back(PolySearchGoal{ end.poly, { end.pos.x, end.pos.y, end.pos.z } });
+            goalIndices.push_back(i);
+        }
+    }
+}
+
+bool AmeisenNavigation::FindPolyPathInFlowField(dtNavMeshQuery* query, dtQueryFilter* filter,
+                                                const PolyPosition& start, const PolyPosition& end,
+                                                dtPolyRef* polyPathBuffer, int* polyPathCount, int maxPolyPathCount,
+                                                dtStatus* status) noexcept
+{
+    const dtNavMesh* navMesh = query->getAttachedNavMesh();
+    const FlowFieldKey key{ navMesh, end.poly, PolyGraph::GetFilterSignature(filter) };
+
+    try
+    {
+        // the field is built towards the end position of the request that made the destination hot,
+        // later requests only differ inside the destination poly
+        const auto field = FlowFields->Acquire(key, [&]() -> std::shared_ptr<const FlowField>
+        {
+            auto flowField = std::make_shared<FlowField>(end.poly);
+            flowField->Build(navMesh, end.pos, filter, MaxSearchNodes);
+
+            ANAV_DEBUG_ONLY(">> Built flow field for poly ", end.poly, ": ", flowField->GetPolyCount(), " polys");
+            return flowField;
+        });
+
+        if (!field || !field->Walk(start.poly, polyPathBuffer, polyPathCount, maxPolyPathCount, status))
+            return false;
+
+        FlowFields->AddHit();
+        return true;
+    }
+    catch (const std::exception& e)
+    {
+        ANAV_ERROR_MSG(">> Flow field failed: ", e.what());
+        return false;
+    }
+}
+
+dtStatus AmeisenNavigation::CalculatePolyPath(dtNavMeshQuery* query, dtQueryFilter* filter, const PolyPosition& start,
+                                              const PolyPosition& end, dtPolyRef* polyPathBuffer, int* polyPathCount,
+                                              int maxPolyPathCount, PolySearch* search, const MapIndexes* indexes,
+                                              int searchFlags, const PathRegion* region) noexcept
+{
+    if (region)
+    {
+        return FindPolyPath(query, filter, start, end, polyPathBuffer, polyPathCount, maxPolyPathCount, search,
+                            indexes, searchFlags, region);
+    }
+
+    dtStatus polyPathStatus = DT_FAILURE;
+    bool cached = FlowFields && FindPolyPathInFlowField(query, filter, start, end, polyPathBuffer, polyPathCount,
+                                                        maxPolyPathCount, &polyPathStatus);
+
+    if (!cached && CorridorCache)
+    {
+        const PathCacheKey key{ query->getAttachedNavMesh(), start.poly, end.poly,
+                                PolyGraph::GetFilterSignature(filter), searchFlags };
+
+        try
+        {
+            const auto corridor = CorridorCache->GetOrCompute(key, [&]() -> std::shared_ptr<const CachedCorridor>
+            {
+                polyPathStatus = FindPolyPath(query, filter, start, end, polyPathBuffer, polyPathCount,
+                                              maxPolyPathCount, search, indexes, searchFlags);
+
+                if (!dtStatusSucceed(polyPathStatus) || *polyPathCount <= 0)
+                    return nullptr;
+
+                return std::make_shared<CachedCorridor>(CachedCorridor{
+                    std::vector<dtPolyRef>(polyPathBuffer, polyPathBuffer + *polyPathCount), polyPathStatus });
+            });
+
+            // requests that did not run the search themselves copy the shared result
+            if (corridor)
+            {
+                *polyPathCount = dtMin(static_cast<int>(corridor->Polys.size()), maxPolyPathCount);
+                std::copy_n(corridor->Polys.begin(), *polyPathCount, polyPathBuffer);
+                polyPathStatus = corridor->Status;
+            }
+
+            cached = true;
+        }
+        catch (const std::exception& e)
+        {
+            ANAV_ERROR_MSG(">> Path cache failed, searching uncached: ", e.what());
+        }
+    }
+
+    if (!cached)
+    {
+        polyPathStatus = FindPolyPath(query, filter, start, end, polyPathBuffer, polyPathCount, maxPolyPathCount,
+                                      search, indexes, searchFlags);
+    }
+
+    return polyPathStatus;
+}
+
+bool AmeisenNavigation::CalculateNormalPath(dtNavMeshQuery* query, dtQueryFilter* filter, const MapIndexes* indexes,
+                                            dtPolyRef* polyPathBuffer, int maxPolyPathCount,
+                                            const Vector3& startPosition, const Vector3& endPosition, Path& path,
+                                            dtPolyRef* visited, PolySearch* search, int searchFlags,
+                                            const PathRegion* region, bool* partial) noexcept
+{
+    // Reset output count - ensures GetSpace() returns the full buffer size
+    path.pointCount = 0;
+
+    if (!path.points || path.maxSize <= 0)
+        return false;
+
+    PolyPosition start;
+    if (!dtStatusSucceed(GetNearestPoly(query, filter, indexes, startPosition, start)) || start.poly == 0)
+        return false;
+
+    PolyPosition end;
+    if (!dtStatusSucceed(GetNearestPoly(query, filter, indexes, endPosition, end)) || end.poly == 0)
+        return false;
+
+    int polyPathCount = 0;
+    const dtStatus polyPathStatus = CalculatePolyPath(query, filter, start, end, polyPathBuffer, &polyPathCount,
+                                                      maxPolyPathCount, search, indexes, searchFlags, region);
+
+    if (!dtStatusSucceed(polyPathStatus) || polyPathCount <= 0)
+    {
+        ANAV_ERROR_MSG(">> Failed to call findPath: ", polyPathStatus);
+        return false;
+    }
+
+    ANAV_DEBUG_ONLY(">> findPath: ", polyPathCount, "/", maxPolyPathCount);
+
+    if (partial)
+        *partial = dtStatusDetail(polyPathStatus, DT_PARTIAL_RESULT);
 
     dtStatus straightPathStatus = SafeFindStraightPath(query, start.pos, end.pos, polyPathBuffer, polyPathCount,
                                                          reinterpret_cast<float*>(path.points), nullptr,
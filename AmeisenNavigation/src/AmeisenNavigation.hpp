@@ -1,31 +1,48 @@
 #pragma once
 
+#include <algorithm>
+#include <chrono>
+#include <condition_variable>
 #include <format>
+#include <initializer_list>
 #include <memory>
 #include <mutex>
 #include <random>
 #include <shared_mutex>
 #include <string>
+#include <thread>
 #include <unordered_map>
+#include <utility>
+#include <vector>
 
 #include "../../recastnavigation/Detour/Include/DetourCommon.h"
 #include "../../recastnavigation/Detour/Include/DetourNavMesh.h"
 #include "../../recastnavigation/Detour/Include/DetourNavMeshQuery.h"
 
+#include "Caches/FlowFieldCache.hpp"
+#include "Caches/PathCache.hpp"
 #include "Clients/AmeisenNavClient.hpp"
+#include "Indexes/MapIndexes.hpp"
 #include "NavSources/Anp/AnpNavSource.hpp"
 #include "NavSources/Anp/AnpQueryFilterProvider.hpp"
 #include "NavSources/INavSource.hpp"
 #include "NavSources/Mmap/MmapNavSource.hpp"
 #include "NavSources/Mmap/MmapQueryFilterProvider.hpp"
+#include "Search/PathRegion.hpp"
+#include "Search/PathSearchFlags.hpp"
+#include "Search/PolySearch.hpp"
+#include "Search/TransportGraph.hpp"
 #include "Smoothing/BezierCurve.hpp"
 #include "Smoothing/CatmullRomSpline.hpp"
 #include "Smoothing/ChaikinCurve.hpp"
 #include "Utils/Path.hpp"
+#include "Utils/PathCost.hpp"
 #include "Utils/PolyPosition.hpp"
 #include "Utils/Vector3.hpp"
 #include "Utils/VectorUtils.hpp"
 #include "Utils/Logger.hpp"
+#include "Utils/MapLoadState.hpp"
+#include "Utils/MapUsage.hpp"
 
 // Debug-only tracing (compiled out in Release)
 #ifdef _DEBUG
@@ -56,20 +73,93 @@ constexpr float MOVE_ALONG_SURFACE_MAX_CHUNK = 25.0f;
 /// Size of the visited polygon buffer for moveAlongSurface calls.
 constexpr int MOVE_ALONG_SURFACE_VISITED_SIZE = 8;
 
+/// Maximum number of flow fields kept at once, each one covers up to MaxSearchNodes polys.
+constexpr size_t FLOW_FIELD_MAX_FIELDS = 16;
+
+/// Maximum number of corners returned by a path session update.
+constexpr int PATH_SESSION_MAX_CORNERS = 32;
+
+/// Distance (2D) a session position or target may end up away from the requested one before the corridor
+/// is searched again, moveAlongSurface stops at walls and only walks a few polys.
+constexpr float PATH_SESSION_MAX_DRIFT = 2.0f;
+
+/// Number of corridor polys ahead of the position that are validated on every session update.
+constexpr int PATH_SESSION_LOOKAHEAD = 16;
+
+/// How often a partial path on a map with streamed tiles is searched again with more tiles around its endpoints.
+constexpr int STREAMED_PATH_RETRIES = 3;
+
+/// Upper bound of the margin a retried search locks around its positions, targets that are not reachable
+/// within it are reported as unreachable instead of streaming in the whole map.
+constexpr float STREAMED_PATH_MAX_MARGIN = 1600.0f;
+
+/// Lowest amount the margin grows by per retry, positions close to each other still get new tiles.
+constexpr float STREAMED_PATH_MIN_GROWTH = 64.0f;
+
+/// How often loaded maps are checked against the idle timeout and the memory budget.
+constexpr std::chrono::seconds MAP_SWEEP_INTERVAL{ 10 };
+
 class AmeisenNavigation
 {
 private:
+    struct IndexBuilder
+    {
+        std::shared_ptr<std::atomic<bool>> Done; // set once the builder let go of its indexes
+        std::jthread Thread;
+    };
+
     int MaxPolyPath;
     int MaxSearchNodes;
+    int LandmarkCount;
+    float HeightRasterCellSize;
+    int MapIdleTimeout; // seconds, 0 keeps idle maps
+    size_t MapMemoryBudget; // bytes, 0 for no limit
     std::unique_ptr<INavSource> NavSource;
     std::unique_ptr<IQueryFilterProvider> FilterProvider;
     mutable std::shared_mutex ClientsMutex;
     std::unordered_map<size_t, std::unique_ptr<AmeisenNavClient>> Clients;
+    std::unique_ptr<PathCache> CorridorCache; // nullptr if disabled
+    std::unique_ptr<FlowFieldCache> FlowFields; // nullptr if disabled
+
+    // maps loaded ahead of their first query keep initialised queries until clients pick them up
+    mutable std::mutex PreloadMutex;
+    std::unordered_map<int, MapLoadState> LoadStates;
+    std::unordered_map<int, std::vector<NavMeshQueryPtr>> WarmQueries;
+
+    // last use of every map that was loaded, clients touch it on every query
+    mutable std::mutex UsageMutex;
+    std::unordered_map<int, std::shared_ptr<MapUsage>> Usages;
+
+    // transports between maps for cross map routes, replaced as a whole by LoadTransports
+    mutable std::mutex TransportMutex;
+    std::shared_ptr<TransportGraph> Transports;
+
+    // search indexes are built in the background, the builders are declared last so they are
+    // stopped and joined before the navmeshes they read from get destroyed. Finished builders are
+    // joined and removed by the next build.
+    mutable std::shared_mutex IndexMutex;
+    std::unordered_map<int, std::shared_ptr<MapIndexes>> Indexes;
+    std::vector<IndexBuilder> IndexBuilders;
+
+    // unloads idle maps and enforces the memory budget, only running if either is enabled
+    std::mutex SweepMutex;
+    std::condition_variable_any SweepCondition;
+    std::jthread MapSweeper;
 
 public:
     AmeisenNavigation(const std::string& meshFolder, int maxPolyPath, int maxSearchNodes, bool useAnp = false,
-                       float factionDangerCost = 3.0f)
-        : MaxPolyPath(maxPolyPath), MaxSearchNodes(maxSearchNodes)
+                       float factionDangerCost = 3.0f, int landmarkCount = 0, int pathCacheSize = 0,
+                       int flowFieldHotThreshold = 0, int flowFieldTtl = 60, float heightRasterCellSize = 0.0f,
+                       int tileBudgetMb = 0, bool mapTileFiles = false, int mapIdleTimeout = 0,
+                       int mapMemoryBudgetMb = 0)
+        : MaxPolyPath(maxPolyPath), MaxSearchNodes(maxSearchNodes), LandmarkCount(landmarkCount),
+        HeightRasterCellSize(heightRasterCellSize), MapIdleTimeout(std::max(mapIdleTimeout, 0)),
+        MapMemoryBudget(static_cast<size_t>(std::max(mapMemoryBudgetMb, 0)) << 20),
+        CorridorCache(pathCacheSize > 0 ? std::make_unique<PathCache>(pathCacheSize) : nullptr),
+        FlowFields(flowFieldHotThreshold > 0 && flowFieldTtl > 0
+                       ? std::make_unique<FlowFieldCache>(flowFieldHotThreshold, std::chrono::seconds(flowFieldTtl),
+                                                          FLOW_FIELD_MAX_FIELDS)
+                       : nullptr)
     {
         if (useAnp)
         {
@@ -78,14 +168,56 @@ public:
         }
         else
         {
-            auto mmapSource = std::make_unique<MmapNavSource>(meshFolder.c_str(), MmapFormat::UNKNOWN);
+            auto mmapSource = std::make_unique<MmapNavSource>(meshFolder.c_str(), MmapFormat::UNKNOWN,
+                                                              static_cast<size_t>(std::max(tileBudgetMb, 0)) << 20,
+                                                              mapTileFiles);
             FilterProvider = std::make_unique<MmapQueryFilterProvider>(mmapSource->GetFormat());
             NavSource = std::move(mmapSource);
         }
+
+        // cached corridors and fields keep polys of tiles that may be evicted
+        if (NavSource->StreamsTiles())
+        {
+            CorridorCache.reset();
+            FlowFields.reset();
+        }
+
+        // queries that were still running on a reloaded navmesh may have cached results for it after ReloadMap
+        // dropped them, drop them again once the navmesh is freed and can not be mistaken for a new one
+        NavSource->SetRetireCallback([this](const dtNavMesh* navMesh) { InvalidateNavMesh(navMesh); });
+
+        if (MapIdleTimeout > 0 || MapMemoryBudget > 0)
+        {
+            MapSweeper = std::jthread([this](std::stop_token stopToken)
+            {
+                std::unique_lock lock(SweepMutex);
+
+                while (!stopToken.stop_requested())
+                {
+                    // wakes up early when a stop is requested
+                    SweepCondition.wait_for(lock, stopToken, MAP_SWEEP_INTERVAL, [] { return false; });
+
+                    if (!stopToken.stop_requested())
+                    {
+                        SweepMaps();
+                        ReleaseIdleQueries();
+                    }
+                }
+            });
+        }
     }
 
     ~AmeisenNavigation()
     {
+        if (MapSweeper.joinable())
+        {
+            MapSweeper.request_stop();
+            MapSweeper.join();
+        }
+
+        NavSource->SetRetireCallback(nullptr);
+        IndexBuilders.clear();
+
         std::unique_lock lock(ClientsMutex);
         Clients.clear();
     }
@@ -98,12 +230,52 @@ public:
     AmeisenNavClient* GetClient(size_t clientId);
 
     /// Find a path from start to end. Returns true on success, populates path.
+    /// searchFlags is a combination of PathSearchFlags, the search never leaves region if one is given.
     bool GetPath(size_t clientId, int mapId, const Vector3& startPosition, const Vector3& endPosition,
-                 Path& path);
+                 Path& path, int searchFlags = 0, const PathRegion* region = nullptr);
 
     /// Find a path with randomized intermediate waypoints (within maxRandomDistance).
     bool GetRandomPath(size_t clientId, int mapId, const Vector3& startPosition, const Vector3& endPosition, Path& path,
-                       float maxRandomDistance);
+                       float maxRandomDistance, int searchFlags = 0, const PathRegion* region = nullptr);
+
+    /// Path along an ordered list of waypoints. Every waypoint is snapped once and each leg starts on the poly
+    /// the previous one ended on. The legs are concatenated into path, the route ends early if a leg could
+    /// only be found partially.
+    bool GetMultiPath(size_t clientId, int mapId, const Vector3* waypoints, int waypointCount, Path& path,
+                      int searchFlags = 0);
+
+    /// Walking cost and length from start to every target, found by a single search that expands until
+    /// all targets are reached. Lengths are measured along the poly corridor, or along the straight path if
+    /// straightPath is given, it is used as scratch buffer. Returns false if the start is not on the mesh.
+    bool GetPathCosts(size_t clientId, int mapId, const Vector3& startPosition, const Vector3* targets,
+                      int targetCount, PathCost* costs, Path* straightPath = nullptr);
+
+    /// Path to whichever goal is closest by walking cost, found by a single search that stops at the first
+    /// goal it reaches. goalIndex, if not nullptr, is set to the index of that goal.
+    bool GetPathToNearest(size_t clientId, int mapId, const Vector3& startPosition, const Vector3* goalPositions,
+                          int goalCount, Path& path, int* goalIndex);
+
+    /// Check whether end can be reached from start with a path cost of at most maxCost. The search is pruned
+    /// at maxCost, so failing checks stay cheap. cost is set to the path cost if reachable, -1 otherwise.
+    bool IsReachableWithin(size_t clientId, int mapId, const Vector3& startPosition, const Vector3& endPosition,
+                           float maxCost, float* cost);
+
+    /// Read the transports between maps (portals, boats, zeppelins, dungeon entrances) from a data file, see
+    /// TransportGraph for its format. Replaces the transports loaded before, returns their count or -1 if the
+    /// file could not be read.
+    int LoadTransports(const std::string& file);
+
+    /// Cheapest route from start on startMapId to end on endMapId, walking and taking the loaded transports.
+    /// legs is set to the walking and transport legs in order. Only the walking costs are searched, the paths
+    /// of the walking legs are left to GetPath when the client gets to them. False if there is no route.
+    bool GetCrossMapRoute(size_t clientId, int startMapId, const Vector3& startPosition, int endMapId,
+                          const Vector3& endPosition, std::vector<RouteLeg>& legs, float* totalCost = nullptr);
+
+    /// Next corners (at most maxCorners) from position towards target, following the corridor of the previous
+    /// call. Small moves of either end only adjust the corridor, it is searched again when the map changed,
+    /// an end moved too far or the corridor became invalid. Every client has one session.
+    bool UpdatePathSession(size_t clientId, int mapId, const Vector3& position, const Vector3& target,
+                           Path& corners, int maxCorners, int searchFlags = 0);
 
     bool MoveAlongSurface(size_t clientId, int mapId, const Vector3& startPosition, const Vector3& endPosition,
                           Vector3& positionToGoTo);
@@ -126,6 +298,42 @@ public:
     /// Walk the path along the navmesh surface (validates smoothed paths with chunking).
     bool PostProcessMoveAlongSurface(size_t clientId, int mapId, const Path& input, Path& output);
 
+    /// Hit and miss counters of the shared corridor cache, all zero if the cache is disabled.
+    PathCacheStats GetPathCacheStats() const noexcept
+    {
+        return CorridorCache ? CorridorCache->GetStats() : PathCacheStats{};
+    }
+
+    /// Flow field usage, all zero if flow fields are disabled.
+    FlowFieldStats GetFlowFieldStats() const noexcept
+    {
+        return FlowFields ? FlowFields->GetStats() : FlowFieldStats{};
+    }
+
+    /// Load a map ahead of its first query, start building its search indexes and initialise warmQueryCount
+    /// queries that are handed to the first clients using the map. Blocks until the map is loaded, call it
+    /// from worker threads to preload maps in parallel.
+    bool PreloadMap(int mapId, int warmQueryCount = 0);
+
+    /// Build the navmesh of a loaded map again from its files, after it got exported again, and swap it in
+    /// without dropping clients. Queries that are running finish on the previous navmesh, every client moves
+    /// to the new one with its next query. Blocks while the new navmesh is built, false if the map is not
+    /// loaded or could not be built.
+    bool ReloadMap(int mapId);
+
+    /// Remove a map, the next query for it loads it again. Its memory is freed once every client that used it
+    /// sent another query or disconnected. Returns false if the map is not loaded.
+    bool UnloadMap(int mapId);
+
+    /// Memory held by every loaded map, ordered by map id.
+    std::vector<MapMemoryUsage> GetMapMemoryUsage() const;
+
+    /// Load state of a map, maps that were neither preloaded nor queried are NOT_LOADED.
+    MapLoadState GetMapLoadState(int mapId) const;
+
+    /// Load states of all maps that were preloaded or queried so far, ordered by map id.
+    std::vector<std::pair<int, MapLoadState>> GetMapLoadStates() const;
+
     void SmoothPathChaikinCurve(const Path& input, Path& output) const noexcept;
 
     void SmoothPathCatmullRom(const Path& input, Path& output, int points, float alpha) const noexcept;
@@ -133,30 +341,196 @@ public:
     void SmoothPathBezier(const Path& input, Path& output, int points) const noexcept;
 
 private:
-    inline dtStatus GetNearestPoly(const dtNavMeshQuery* query, const dtQueryFilter* filter, const Vector3& position,
-                                   Vector3& closestPointOnPoly, dtPolyRef* polyRef,
-                                   bool convertWowToRd = true) const noexcept
+    /// Snap a position to the navmesh, with the nearest poly grid of indexes (the ones of the query's map from
+    /// GetIndexes, may be nullptr) if it is built.
+    inline dtStatus GetNearestPoly(const dtNavMeshQuery* query, const dtQueryFilter* filter,
+                                   const MapIndexes* indexes, const Vector3& position, Vector3& closestPointOnPoly,
+                                   dtPolyRef* polyRef, bool convertWowToRd = true) const noexcept
     {
         if (convertWowToRd)
         {
             position.CopyToRDCoords(closestPointOnPoly);
-            return query->findNearestPoly(closestPointOnPoly, NEAREST_POLY_EXTENTS, filter, polyRef, closestPointOnPoly);
+            return FindNearestPoly(query, filter, indexes, closestPointOnPoly, NEAREST_POLY_EXTENTS, polyRef,
+                                   closestPointOnPoly);
         }
 
-        return query->findNearestPoly(position, NEAREST_POLY_EXTENTS, filter, polyRef, closestPointOnPoly);
+        return FindNearestPoly(query, filter, indexes, position, NEAREST_POLY_EXTENTS, polyRef, closestPointOnPoly);
     }
 
-    inline dtStatus GetNearestPoly(const dtNavMeshQuery* query, const dtQueryFilter* filter, const Vector3& position,
-                                   PolyPosition& poly, bool convertWowToRd = true) const noexcept
+    inline dtStatus GetNearestPoly(const dtNavMeshQuery* query, const dtQueryFilter* filter,
+                                   const MapIndexes* indexes, const Vector3& position, PolyPosition& poly,
+                                   bool convertWowToRd = true) const noexcept
     {
-        return GetNearestPoly(query, filter, position, poly.pos, &poly.poly, convertWowToRd);
+        return GetNearestPoly(query, filter, indexes, position, poly.pos, &poly.poly, convertWowToRd);
     }
 
     inline bool IsNavmeshLoaded(int mapId) noexcept { return NavSource->Get(mapId) != nullptr; }
 
-    bool TryGetClientAndQuery(size_t clientId, int mapId, AmeisenNavClient*& client, dtNavMeshQuery*& query);
+    /// dtNavMeshQuery::findNearestPoly, answered by the nearest poly grid of indexes if the position stands on
+    /// the mesh and the grid is built.
+    dtStatus FindNearestPoly(const dtNavMeshQuery* query, const dtQueryFilter* filter, const MapIndexes* indexes,
+                             const float* center, const float* halfExtents, dtPolyRef* polyRef,
+                             float* nearest) const noexcept;
+
+    /// dtNavMeshQuery::findRandomPoint, answered by the random point table of indexes once it is built.
+    dtStatus FindRandomPoint(const dtNavMeshQuery* query, const dtQueryFilter* filter, const MapIndexes* indexes,
+                             dtPolyRef* randomRef, float* randomPt) const;
+
+    /// dtNavMeshQuery::findRandomPointAroundCircle, answered by the random point table of indexes for circles
+    /// that fit its grid. It picks from the same polys, but the point always lies inside of the circle.
+    dtStatus FindRandomPointAroundCircle(const dtNavMeshQuery* query, const dtQueryFilter* filter,
+                                         const MapIndexes* indexes, dtPolyRef startRef, const float* center,
+                                         float radius, dtPolyRef* randomRef, float* randomPt) const;
+
+    /// Get the client and its query for a map, requestLock keeps the client for the calling request.
+    bool TryGetClientAndQuery(size_t clientId, int mapId, AmeisenNavClient*& client, dtNavMeshQuery*& query,
+                              ClientRequestLock& requestLock);
+
+    /// Take one of the queries initialised by PreloadMap for the navmesh, nullptr if none is left. Marks the
+    /// map as loaded for GetMapLoadState.
+    dtNavMeshQuery* TakeWarmQuery(int mapId, const dtNavMesh* navMesh);
+
+    /// Load the tiles around positions and origin (wow coordinates, origin is optional) if the nav source
+    /// streams them, and keep them loaded while the lock is held. Without positions the tiles that are loaded
+    /// already are locked.
+    NavTileLock LockTiles(int mapId, const dtNavMeshQuery* query, const Vector3* positions, int count,
+                          const Vector3* origin = nullptr, float margin = 0.0f) const noexcept;
+
+    inline NavTileLock LockTiles(int mapId, const dtNavMeshQuery* query, std::initializer_list<Vector3> positions,
+                                 float margin = 0.0f) const noexcept
+    {
+        return LockTiles(mapId, query, positions.begin(), static_cast<int>(positions.size()), nullptr, margin);
+    }
+
+    /// Snap the position of a moving client, starting at the poly of its movement handle and falling back to
+    /// a nearest poly search if it is not there anymore. The handle is updated with the result.
+    bool GetMovementPoly(AmeisenNavClient* client, dtNavMeshQuery* query, int mapId, const Vector3& position,
+                         PolyPosition& poly) const noexcept;
+
+    /// Start building the search indexes of a map in the background, if not done yet.
+    void QueueIndexBuild(int mapId, const NavMeshRef& navMesh);
+
+    /// Create the indexes of a navmesh in indexes and build them on a builder thread, IndexMutex is held.
+    void StartIndexBuild(int mapId, const NavMeshRef& navMesh, std::shared_ptr<MapIndexes> indexes);
+
+    /// Drop the cached corridors, flow fields and search indexes of a navmesh.
+    void InvalidateNavMesh(const dtNavMesh* navMesh);
+
+    /// Drop the walking costs between transports cached for a map.
+    void InvalidateTransportCosts(int mapId);
+
+    /// Usage record of a map, created on its first use.
+    std::shared_ptr<MapUsage> GetMapUsage(int mapId);
+
+    /// Memory of a loaded navmesh together with its search indexes.
+    MapMemoryUsage GetMapMemoryUsage(int mapId, const dtNavMesh* navMesh, int64_t now) const;
+
+    /// Unload the maps that were idle for longer than MapIdleTimeout, then the least recently used ones while
+    /// the loaded maps exceed MapMemoryBudget. The most recently used map always stays.
+    void SweepMaps();
+
+    /// Release the queries of clients that are not in a request whose navmesh got unloaded or replaced, they
+    /// would keep it in memory until their next request otherwise.
+    void ReleaseIdleQueries();
+
+    /// Get the search indexes of a map if they belong to the navmesh, nullptr otherwise. Requests look them up
+    /// once and pass them on to every snap.
+    std::shared_ptr<const MapIndexes> GetIndexes(int mapId, const dtNavMesh* navMesh) const;
+
+    /// Snap positions to the navmesh as search goals, positions off the mesh are skipped. goalIndices maps
+    /// every goal back to its position.
+    void GetSearchGoals(const dtNavMeshQuery* query, const dtQueryFilter* filter, const MapIndexes* indexes,
+                        const Vector3* positions, int count, std::vector<PolySearchGoal>& goals,
+                        std::vector<int>& goalIndices) const;
+
+    /// Search a new corridor for a path session.
+    bool PlanPathSession(AmeisenNavClient* client, dtNavMeshQuery* query, PathSession* session, int mapId,
+                         const Vector3& position, const Vector3& target, int searchFlags) noexcept;
+
+    /// Walk the flow field of the destination if it is hot, returns false if there is no field covering start.
+    bool FindPolyPathInFlowField(dtNavMeshQuery* query, dtQueryFilter* filter, const PolyPosition& start,
+                                 const PolyPosition& end, dtPolyRef* polyPathBuffer, int* polyPathCount,
+                                 int maxPolyPathCount, dtStatus* status) noexcept;
+
+    /// Find the poly corridor between two polys, using the search strategies requested in searchFlags
+    /// if their indexes are ready and dtNavMeshQuery::findPath otherwise. Searches confined to a region
+    /// always use PolySearch.
+    dtStatus FindPolyPath(dtNavMeshQuery* query, dtQueryFilter* filter, const PolyPosition& start,
+                          const PolyPosition& end, dtPolyRef* polyPathBuffer, int* polyPathCount,
+                          int maxPolyPathCount, PolySearch* search, const MapIndexes* indexes,
+                          int searchFlags, const PathRegion* region = nullptr) noexcept;
+
+    /// Poly corridor between two snapped positions, served from the flow fields or the corridor cache if
+    /// possible, searched with FindPolyPath otherwise. Region constrained corridors are never cached.
+    dtStatus CalculatePolyPath(dtNavMeshQuery* query, dtQueryFilter* filter, const PolyPosition& start,
+                               const PolyPosition& end, dtPolyRef* polyPathBuffer, int* polyPathCount,
+                               int maxPolyPathCount, PolySearch* search, const MapIndexes* indexes,
+                               int searchFlags, const PathRegion* region = nullptr) noexcept;
+
+    bool CalculateNormalPath(dtNavMeshQuery* query, dtQueryFilter* filter, const MapIndexes* indexes,
+                             dtPolyRef* polyPathBuffer, int maxPolyPathCount, const Vector3& startPosition,
+                             const Vector3& endPosition, Path& path, dtPolyRef* visited = nullptr,
+                             PolySearch* search = nullptr, int searchFlags = 0, const PathRegion* region = nullptr,
+                             bool* partial = nullptr) noexcept;
+
+    /// Area (navmesh coordinates) LockTiles loads for positions and origin, before rounding it to tiles.
+    static void GetLockBounds(const Vector3* positions, int count, const Vector3* origin, float margin,
+                              Vector3& bmin, Vector3& bmax) noexcept;
+
+    /// Margin of the tiles locked for a search on a streamed map, grows with the extent of the searched
+    /// positions on every attempt and stays below STREAMED_PATH_MAX_MARGIN unless margin is above it already.
+    static inline float GetStreamedPathMargin(float extent, float margin, int attempt) noexcept
+    {
+        const float growth = dtMax(extent, STREAMED_PATH_MIN_GROWTH) * static_cast<float>((2 << attempt) - 2);
+        return dtMin(margin + growth, dtMax(margin, STREAMED_PATH_MAX_MARGIN));
+    }
+
+    /// Run search with the tiles around positions and origin locked in tileLock, search returns whether its
+    /// result is partial. On a streamed map a partial search that ran into tiles that are not loaded is run
+    /// again with a larger margin, polySearch is the search it may use besides the query.
+    template <typename Search>
+    void SearchStreamed(int mapId, dtNavMeshQuery* query, PolySearch* polySearch, const Vector3* positions,
+                        int count, const Vector3* origin, float margin, NavTileLock& tileLock, Search&& search) const
+    {
+        const bool streamed = NavSource->StreamsTiles();
+        Vector3 bmin;
+        Vector3 bmax;
+        GetLockBounds(positions, count, origin, 0.0f, bmin, bmax);
+        const float extent = std::hypot(bmax.x - bmin.x, bmax.z - bmin.z);
+
+        for (int attempt = 0;; ++attempt)
+        {
+            const float attemptMargin = GetStreamedPathMargin(extent, margin, attempt);
+
+            if (tileLock)
+                tileLock.unlock();
+
+            tileLock = LockTiles(mapId, query, positions, count, origin, attemptMargin);
+
+            // only the nodes of this search may be left in the pools afterwards
+            if (streamed)
+            {
+                query->getNodePool()->clear();
 
-    bool CalculateNormalPath(dtNavMeshQuery* query, dtQueryFilter* filter, dtPolyRef* polyPathBuffer,
-                             int maxPolyPathCount, const Vector3& startPosition, const Vector3& endPosition, Path& path,
-                             dtPolyRef* visited = nullptr) noexcept;
+                if (polySearch)
+                    polySearch->ClearNodes();
+            }
+
+            const bool partial = search();
+
+            if (!partial || !streamed || attempt >= STREAMED_PATH_RETRIES
+                || attemptMargin >= STREAMED_PATH_MAX_MARGIN)
+            {
+                break;
+            }
+
+            const dtNavMesh* navMesh = query->getAttachedNavMesh();
+
+            if (!PolyGraph::HasMissingNeighbourTile(navMesh, query->getNodePool())
+                && (!polySearch || !polySearch->ReachedMissingTile(navMesh)))
+            {
+                break;
+            }
+        }
+    }
 };
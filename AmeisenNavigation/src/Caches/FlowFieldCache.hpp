@@ -0,0 +1,357 @@
+#pragma once
+
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <queue>
+#include <unordered_map>
+#include <unordered_set>
+#include <utility>
+#include <vector>
+
+#include "../../../recastnavigation/Detour/Include/DetourCommon.h"
+#include "../../../recastnavigation/Detour/Include/DetourNavMesh.h"
+#include "../../../recastnavigation/Detour/Include/DetourNavMeshQuery.h"
+
+#include "../Search/PolyGraph.hpp"
+
+/// <summary>
+/// Reverse Dijkstra cost field towards one destination poly. Every poly of the field knows its cost to the
+/// destination and the next poly on the cheapest route, so a corridor is found by walking the field from
+/// the start poly in O(path length).
+/// </summary>
+class FlowField
+{
+    struct Cell
+    {
+        float Cost;
+        dtPolyRef Next;
+    };
+
+    dtPolyRef Destination;
+    std::unordered_map<dtPolyRef, Cell> Cells;
+
+public:
+    FlowField(dtPolyRef destination) noexcept
+        : Destination(destination),
+        Cells()
+    {}
+
+    constexpr inline dtPolyRef GetDestination() const noexcept { return Destination; }
+    inline size_t GetPolyCount() const noexcept { return Cells.size(); }
+
+    /// Expand from the destination until maxPolys polys are settled, walking the links in reverse. Every poly
+    /// is placed at the midpoint of the portal towards its next poly and pays the distance to the next poly's
+    /// position times the area cost of the next poly. That is close to findPath but not the same, findPath
+    /// places a poly at the portal it was reached through first and charges the poly it leaves.
+    void Build(const dtNavMesh* nav, const float* destinationPos, const dtQueryFilter* filter, int maxPolys)
+    {
+        struct Node
+        {
+            float Cost;
+            dtPolyRef Next;
+            float Pos[3];
+            bool Closed;
+        };
+
+        using OpenEntry = std::pair<float, dtPolyRef>;
+        std::priority_queue<OpenEntry, std::vector<OpenEntry>, std::greater<OpenEntry>> open;
+        std::unordered_map<dtPolyRef, Node> nodes;
+        nodes.reserve(maxPolys);
+
+        // links are stored at the poly they leave, off-mesh connections are one way
+        std::unordered_map<dtPolyRef, std::vector<dtPolyRef>> incoming;
+        std::unordered_set<const dtMeshTile*> indexedTiles;
+
+        Node& destination = nodes[Destination];
+        destination = Node{ 0.0f, 0, { destinationPos[0], destinationPos[1], destinationPos[2] }, false };
+        open.emplace(0.0f, Destination);
+
+        int settled = 0;
+
+        while (!open.empty() && settled < maxPolys)
+        {
+            const auto [cost, ref] = open.top();
+            open.pop();
+
+            Node& node = nodes[ref];
+
+            if (node.Closed || cost > node.Cost)
+                continue;
+
+            node.Closed = true;
+            Cells.emplace(ref, Cell{ node.Cost, node.Next });
+            ++settled;
+
+            const dtMeshTile* tile = nullptr;
+            const dtPoly* poly = nullptr;
+            nav->getTileAndPolyByRefUnsafe(ref, &tile, &poly);
+
+            IndexIncomingLinks(nav, tile, incoming, indexedTiles);
+            const auto previousRefs = incoming.find(ref);
+
+            if (previousRefs == incoming.end())
+                continue;
+
+            for (const dtPolyRef previousRef : previousRefs->second)
+            {
+                const dtMeshTile* previousTile = nullptr;
+                const dtPoly* previousPoly = nullptr;
+                nav->getTileAndPolyByRefUnsafe(previousRef, &previousTile, &previousPoly);
+
+                if (!PolyGraph::PassFilter(filter, previousPoly))
+                    continue;
+
+                float mid[3];
+
+                if (!PolyGraph::GetEdgeMidPoint(previousRef, previousPoly, previousTile, ref, poly, tile, mid))
+                    continue;
+
+                // the segment from the portal to the next node lies in the current poly
+                const float previousCost = node.Cost + PolyGraph::GetCost(filter, mid, node.Pos, poly);
+                auto [it, inserted] = nodes.try_emplace(previousRef);
+
+                if (!inserted && (it->second.Closed || previousCost >= it->second.Cost))
+                    continue;
+
+                it->second = Node{ previousCost, ref, { mid[0], mid[1], mid[2] }, false };
+                open.emplace(previousCost, previousRef);
+            }
+        }
+    }
+
+    /// Write the corridor from start to the destination. Returns false if the start poly is not part of the
+    /// field, DT_BUFFER_TOO_SMALL is set in status if the corridor had to be truncated.
+    bool Walk(dtPolyRef start, dtPolyRef* path, int* pathCount, int maxPath, dtStatus* status) const noexcept
+    {
+        if (maxPath <= 0 || Cells.find(start) == Cells.end())
+            return false;
+
+        int count = 0;
+        *status = DT_SUCCESS;
+
+        for (dtPolyRef ref = start; ref; ref = Cells.find(ref)->second.Next)
+        {
+            if (count >= maxPath)
+            {
+                *status |= DT_BUFFER_TOO_SMALL;
+                break;
+            }
+
+            path[count++] = ref;
+        }
+
+        *pathCount = count;
+        return true;
+    }
+
+private:
+    /// Record the links of a tile and its neighbours at the poly they lead to. Links into a tile only come
+    /// from the tile itself, the tiles around it and the layers at its location, off-mesh connections
+    /// included.
+    static void IndexIncomingLinks(const dtNavMesh* nav, const dtMeshTile* tile,
+                                   std::unordered_map<dtPolyRef, std::vector<dtPolyRef>>& incoming,
+                                   std::unordered_set<const dtMeshTile*>& indexedTiles)
+    {
+        constexpr int MAX_LAYERS = 32;
+        const dtMeshTile* tiles[MAX_LAYERS];
+
+        for (int y = tile->header->y - 1; y <= tile->header->y + 1; ++y)
+        {
+            for (int x = tile->header->x - 1; x <= tile->header->x + 1; ++x)
+            {
+                const int tileCount = nav->getTilesAt(x, y, tiles, MAX_LAYERS);
+
+                for (int t = 0; t < tileCount; ++t)
+                {
+                    if (!indexedTiles.insert(tiles[t]).second)
+                        continue;
+
+                    const dtPolyRef base = nav->getPolyRefBase(tiles[t]);
+
+                    for (int p = 0; p < tiles[t]->header->polyCount; ++p)
+                    {
+                        const dtPoly* poly = &tiles[t]->polys[p];
+
+                        for (unsigned int i = poly->firstLink; i != DT_NULL_LINK; i = tiles[t]->links[i].next)
+                        {
+                            if (tiles[t]->links[i].ref)
+                                incoming[tiles[t]->links[i].ref].push_back(base | static_cast<dtPolyRef>(p));
+                        }
+                    }
+                }
+            }
+        }
+    }
+};
+
+/// Identifies a flow field, fields are only valid for the filter class they were built with.
+struct FlowFieldKey
+{
+    const dtNavMesh* NavMesh;
+    dtPolyRef Destination;
+    uint64_t Filter; // PolyGraph::GetFilterSignature
+
+    constexpr inline bool operator==(const FlowFieldKey& other) const noexcept
+    {
+        return NavMesh == other.NavMesh && Destination == other.Destination && Filter == other.Filter;
+    }
+};
+
+struct FlowFieldKeyHash
+{
+    inline size_t operator()(const FlowFieldKey& key) const noexcept
+    {
+        uint64_t hash = key.Filter;
+        hash = (hash ^ static_cast<uint64_t>(key.Destination)) * 0x9E3779B97F4A7C15ull;
+        hash = (hash ^ reinterpret_cast<uintptr_t>(key.NavMesh)) * 0x9E3779B97F4A7C15ull;
+        return static_cast<size_t>(hash ^ (hash >> 32));
+    }
+};
+
+struct FlowFieldStats
+{
+    uint64_t Hits;   // corridors answered by walking a field
+    uint64_t Fields; // fields alive right now
+};
+
+/// Number of destinations whose request counters are tracked, the counters are reset when exceeded.
+constexpr size_t FLOW_FIELD_MAX_TRACKED = 4096;
+
+/// <summary>
+/// Detects hot destinations and keeps flow fields for them.
+///
+/// Every path request counts towards its destination poly. Once a destination got hotThreshold requests
+/// within one TTL window, the request that crossed the threshold builds a flow field for it. Fields expire
+/// after the TTL and at most maxFields are kept, the oldest one is dropped first.
+/// </summary>
+class FlowFieldCache
+{
+    using Clock = std::chrono::steady_clock;
+
+    struct Counter
+    {
+        int Requests;
+        Clock::time_point WindowStart;
+    };
+
+    struct Entry
+    {
+        std::shared_ptr<const FlowField> Field; // nullptr while it is being built
+        Clock::time_point Created;
+    };
+
+    int HotThreshold;
+    Clock::duration Ttl;
+    size_t MaxFields;
+    std::mutex Mutex;
+    std::unordered_map<FlowFieldKey, Counter, FlowFieldKeyHash> Counters;
+    std::unordered_map<FlowFieldKey, Entry, FlowFieldKeyHash> Fields;
+    std::atomic<uint64_t> Hits;
+
+public:
+    FlowFieldCache(int hotThreshold, std::chrono::seconds ttl, size_t maxFields) noexcept
+        : HotThreshold(hotThreshold),
+        Ttl(ttl),
+        MaxFields(maxFields),
+        Mutex(),
+        Counters(),
+        Fields(),
+        Hits(0)
+    {}
+
+    FlowFieldCache(const FlowFieldCache&) = delete;
+    FlowFieldCache& operator=(const FlowFieldCache&) = delete;
+
+    FlowFieldStats GetStats() noexcept
+    {
+        std::lock_guard lock(Mutex);
+        return FlowFieldStats{ Hits.load(std::memory_order_relaxed), static_cast<uint64_t>(Fields.size()) };
+    }
+
+    /// Count a request and return the destination's field if there is one. If this request made the
+    /// destination hot, build() is called to create the field, it has to return nullptr on failure.
+    template <typename Fn>
+    std::shared_ptr<const FlowField> Acquire(const FlowFieldKey& key, Fn&& build)
+    {
+        const Clock::time_point now = Clock::now();
+
+        {
+            std::lock_guard lock(Mutex);
+
+            if (const auto it = Fields.find(key); it != Fields.end())
+            {
+                if (now - it->second.Created < Ttl)
+                {
+                    return it->second.Field;
+                }
+
+                Fields.erase(it);
+            }
+
+            if (Counters.size() >= FLOW_FIELD_MAX_TRACKED && Counters.find(key) == Counters.end())
+                Counters.clear();
+
+            Counter& counter = Counters.try_emplace(key, Counter{ 0, now }).first->second;
+
+            if (now - counter.WindowStart >= Ttl)
+                counter = Counter{ 0, now };
+
+            if (++counter.Requests < HotThreshold)
+                return nullptr;
+
+            Counters.erase(key);
+            EvictOldest(now);
+
+            // placeholder, keeps others from building the same field
+            Fields[key] = Entry{ nullptr, now };
+        }
+
+        std::shared_ptr<const FlowField> field;
+
+        try { field = build(); }
+        catch (...) {}
+
+        std::lock_guard lock(Mutex);
+
+        if (field)
+            Fields[key] = Entry{ field, Clock::now() };
+        else
+            Fields.erase(key);
+
+        return field;
+    }
+
+    /// Count a corridor that was answered by a field.
+    inline void AddHit() noexcept { Hits.fetch_add(1, std::memory_order_relaxed); }
+
+    /// Drop all fields of a navmesh, has to be called before it gets destroyed.
+    void Invalidate(const dtNavMesh* navMesh) noexcept
+    {
+        std::lock_guard lock(Mutex);
+        std::erase_if(Fields, [navMesh](const auto& entry) { return entry.first.NavMesh == navMesh; });
+        std::erase_if(Counters, [navMesh](const auto& entry) { return entry.first.NavMesh == navMesh; });
+    }
+
+private:
+    void EvictOldest(Clock::time_point now) noexcept
+    {
+        std::erase_if(Fields, [&](const auto& entry) { return now - entry.second.Created >= Ttl; });
+
+        while (Fields.size() >= MaxFields && !Fields.empty())
+        {
+            auto oldest = Fields.begin();
+
+            for (auto it = Fields.begin(); it != Fields.end(); ++it)
+            {
+                if (it->second.Created < oldest->second.Created)
+                    oldest = it;
+            }
+
+            Fields.erase(oldest);
+        }
+    }
+};
@@ -0,0 +1,198 @@
+#pragma once
+
+#include <atomic>
+#include <cstdint>
+#include <functional>
+#include <future>
+#include <list>
+#include <memory>
+#include <mutex>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+#include "../../../recastnavigation/Detour/Include/DetourNavMesh.h"
+#include "../../../recastnavigation/Detour/Include/DetourStatus.h"
+
+/// Everything that determines the poly corridor between two polys.
+struct PathCacheKey
+{
+    const dtNavMesh* NavMesh;
+    dtPolyRef Start;
+    dtPolyRef End;
+    uint64_t Filter; // PolyGraph::GetFilterSignature
+    int SearchFlags;
+
+    constexpr inline bool operator==(const PathCacheKey& other) const noexcept
+    {
+        return NavMesh == other.NavMesh && Start == other.Start && End == other.End && Filter == other.Filter
+            && SearchFlags == other.SearchFlags;
+    }
+};
+
+struct PathCacheKeyHash
+{
+    inline size_t operator()(const PathCacheKey& key) const noexcept
+    {
+        uint64_t hash = key.Filter;
+        hash = (hash ^ static_cast<uint64_t>(key.Start)) * 0x9E3779B97F4A7C15ull;
+        hash = (hash ^ static_cast<uint64_t>(key.End)) * 0x9E3779B97F4A7C15ull;
+        hash = (hash ^ reinterpret_cast<uintptr_t>(key.NavMesh)) * 0x9E3779B97F4A7C15ull;
+        hash ^= static_cast<uint64_t>(key.SearchFlags);
+        return static_cast<size_t>(hash ^ (hash >> 32));
+    }
+};
+
+/// Result of a poly search, the straight path is recomputed from it for the exact endpoints.
+struct CachedCorridor
+{
+    std::vector<dtPolyRef> Polys;
+    dtStatus Status;
+};
+
+struct PathCacheStats
+{
+    uint64_t Hits;      // served from the cache
+    uint64_t Misses;    // had to search
+    uint64_t Coalesced; // waited for an identical search that was already running
+    uint64_t Entries;
+
+    /// Share of requests that did not need their own search.
+    inline double GetHitRatio() const noexcept
+    {
+        const uint64_t total = Hits + Misses + Coalesced;
+        return total > 0 ? static_cast<double>(Hits + Coalesced) / static_cast<double>(total) : 0.0;
+    }
+};
+
+/// <summary>
+/// Bounded LRU cache of poly corridors shared by all clients.
+///
+/// Identical concurrent requests are collapsed (single flight): the first one runs the search, the others
+/// wait for its result instead of searching themselves. Failed searches are handed to the waiting requests
+/// but not cached.
+/// </summary>
+class PathCache
+{
+    using Value = std::shared_ptr<const CachedCorridor>;
+    using Entry = std::pair<PathCacheKey, Value>;
+
+    size_t Capacity;
+    std::mutex Mutex;
+    std::list<Entry> Entries; // most recently used first
+    std::unordered_map<PathCacheKey, std::list<Entry>::iterator, PathCacheKeyHash> Index;
+    std::unordered_map<PathCacheKey, std::shared_future<Value>, PathCacheKeyHash> InFlight;
+
+    std::atomic<uint64_t> Hits;
+    std::atomic<uint64_t> Misses;
+    std::atomic<uint64_t> Coalesced;
+
+public:
+    PathCache(size_t capacity) noexcept
+        : Capacity(capacity),
+        Mutex(),
+        Entries(),
+        Index(),
+        InFlight(),
+        Hits(0),
+        Misses(0),
+        Coalesced(0)
+    {}
+
+    PathCache(const PathCache&) = delete;
+    PathCache& operator=(const PathCache&) = delete;
+
+    /// Get the corridor for a key, compute() is called if it is neither cached nor being computed right now.
+    /// compute() has to return nullptr if the search failed.
+    template <typename Fn>
+    Value GetOrCompute(const PathCacheKey& key, Fn&& compute)
+    {
+        std::promise<Value> promise;
+        std::shared_future<Value> pending;
+
+        {
+            std::lock_guard lock(Mutex);
+
+            if (const auto it = Index.find(key); it != Index.end())
+            {
+                Entries.splice(Entries.begin(), Entries, it->second);
+                Hits.fetch_add(1, std::memory_order_relaxed);
+                return it->second->second;
+            }
+
+            if (const auto it = InFlight.find(key); it != InFlight.end())
+            {
+                pending = it->second;
+                Coalesced.fetch_add(1, std::memory_order_relaxed);
+            }
+            else
+            {
+                InFlight.emplace(key, promise.get_future().share());
+                Misses.fetch_add(1, std::memory_order_relaxed);
+            }
+        }
+
+        if (pending.valid())
+            return pending.get();
+
+        Value value;
+
+        // waiting requests have to be released no matter what happens
+        try { value = compute(); }
+        catch (...) {}
+
+        {
+            std::lock_guard lock(Mutex);
+
+            if (value)
+                Insert(key, value);
+
+            InFlight.erase(key);
+        }
+
+        promise.set_value(value);
+        return value;
+    }
+
+    /// Drop all cached corridors of a navmesh, has to be called before it gets destroyed.
+    void Invalidate(const dtNavMesh* navMesh) noexcept
+    {
+        std::lock_guard lock(Mutex);
+
+        for (auto it = Entries.begin(); it != Entries.end();)
+        {
+            if (it->first.NavMesh == navMesh)
+            {
+                Index.erase(it->first);
+                it = Entries.erase(it);
+            }
+            else
+            {
+                ++it;
+            }
+        }
+    }
+
+    PathCacheStats GetStats() noexcept
+    {
+        std::lock_guard lock(Mutex);
+        return PathCacheStats{ Hits.load(std::memory_order_relaxed), Misses.load(std::memory_order_relaxed),
+                               Coalesced.load(std::memory_order_relaxed), static_cast<uint64_t>(Entries.size()) };
+    }
+
+private:
+    void Insert(const PathCacheKey& key, const Value& value)
+    {
+        if (Capacity == 0 || Index.find(key) != Index.end())
+            return;
+
+        Entries.emplace_front(key, value);
+        Index.emplace(key, Entries.begin());
+
+        while (Entries.size() > Capacity)
+        {
+            Index.erase(Entries.back().first);
+            Entries.pop_back();
+        }
+    }
+};
@@ -1,13 +1,19 @@
 #pragma once
 
 #include <memory>
+#include <mutex>
 #include <shared_mutex>
 
 #include "../../../recastnavigation/Detour/Include/DetourCommon.h"
 #include "../../../recastnavigation/Detour/Include/DetourNavMeshQuery.h"
 
 #include "ClientState.hpp"
+#include "MovementHandle.hpp"
+#include "PathSession.hpp"
+#include "../NavSources/INavSource.hpp"
 #include "../NavSources/IQueryFilterProvider.hpp"
+#include "../Search/PolySearch.hpp"
+#include "../Utils/MapUsage.hpp"
 
 /// Custom deleter for dtNavMeshQuery allocated by Detour.
 struct NavMeshQueryDeleter
@@ -17,12 +23,19 @@ struct NavMeshQueryDeleter
 
 using NavMeshQueryPtr = std::unique_ptr<dtNavMeshQuery, NavMeshQueryDeleter>;
 
+/// Held while a request uses the queries of a client.
+using ClientRequestLock = std::unique_lock<std::mutex>;
+
 class AmeisenNavClient
 {
     size_t Id;
     ClientState State;
     IQueryFilterProvider* FilterProvider;
 
+    /// Held by the request that uses the client, the queries and the state derived from them are only changed
+    /// by other threads while it is free.
+    std::mutex RequestMutex;
+
     /// Protects CustomFilter, FilterCustomizations, and State from concurrent access.
     /// QueryFilter() (read path) takes shared lock; UpdateQueryFilter() (write path) takes exclusive lock.
     mutable std::shared_mutex FilterMutex;
@@ -31,13 +44,32 @@ class AmeisenNavClient
     std::unique_ptr<dtQueryFilter> CustomFilter;
     std::unordered_map<char, float> FilterCustomizations;
 
+    // Query of a map with a reference to the navmesh it was initialised with, so a reloaded map keeps its old
+    // navmesh until the query moved on. Generation is the nav source generation the navmesh was current at.
+    struct MapQuery
+    {
+        NavMeshQueryPtr Query;
+        NavMeshRef NavMesh;
+        uint64_t Generation = 0;
+        std::shared_ptr<MapUsage> Usage;
+    };
+
     // Holds a dtNavMeshQuery for every map
-    std::unordered_map<int, NavMeshQueryPtr> NavMeshQuery;
+    std::unordered_map<int, MapQuery> NavMeshQuery;
 
     // dtPolyRef buffer for path calculation
     int PolyPathBufferSize;
     std::unique_ptr<dtPolyRef[]> PolyPathBuffer;
 
+    // A* with custom heuristics, independent of the map so one is enough
+    std::unique_ptr<PolySearch> Search;
+
+    // corridor kept between path session updates
+    std::unique_ptr<PathSession> Session;
+
+    // poly of the last movement query
+    MovementHandle Movement;
+
 public:
     AmeisenNavClient(size_t id, ClientState state, IQueryFilterProvider* filterProvider, int polyPathBufferSize = 512) noexcept
         : Id(id),
@@ -47,7 +79,10 @@ public:
         FilterCustomizations(),
         NavMeshQuery(),
         PolyPathBufferSize(polyPathBufferSize),
-        PolyPathBuffer(nullptr)
+        PolyPathBuffer(nullptr),
+        Search(nullptr),
+        Session(nullptr),
+        Movement()
     {}
 
     ~AmeisenNavClient() = default;
@@ -64,8 +99,72 @@ public:
         return CustomFilter ? CustomFilter.get() : FilterProvider->Get(State);
     }
 
-    inline dtNavMeshQuery* GetNavmeshQuery(int mapId) noexcept { auto it = NavMeshQuery.find(mapId); return it != NavMeshQuery.end() ? it->second.get() : nullptr; }
-    inline void SetNavmeshQuery(int mapId, dtNavMeshQuery* query) { NavMeshQuery[mapId].reset(query); }
+    inline dtNavMeshQuery* GetNavmeshQuery(int mapId) noexcept { auto it = NavMeshQuery.find(mapId); return it != NavMeshQuery.end() ? it->second.Query.get() : nullptr; }
+
+    /// Query of a map if its navmesh was current at generation, nullptr otherwise. Marks the map as used.
+    inline dtNavMeshQuery* GetNavmeshQuery(int mapId, uint64_t generation) noexcept
+    {
+        auto it = NavMeshQuery.find(mapId);
+
+        if (it == NavMeshQuery.end() || it->second.Generation != generation)
+            return nullptr;
+
+        it->second.Usage->Touch();
+        return it->second.Query.get();
+    }
+
+    /// Use query, initialised with navMesh, for a map. The query may be the one the map had before. Movement
+    /// and session state of a navmesh that got replaced is dropped, its polys do not exist in the new one.
+    inline void SetNavmeshQuery(int mapId, dtNavMeshQuery* query, NavMeshRef navMesh, uint64_t generation,
+                                std::shared_ptr<MapUsage> usage)
+    {
+        auto& mapQuery = NavMeshQuery[mapId];
+
+        if (mapQuery.NavMesh && mapQuery.NavMesh != navMesh)
+            ForgetNavmesh(mapQuery.NavMesh.get());
+
+        if (mapQuery.Query.get() != query)
+            mapQuery.Query.reset(query);
+
+        mapQuery.NavMesh = std::move(navMesh);
+        mapQuery.Generation = generation;
+        mapQuery.Usage = std::move(usage);
+
+        if (mapQuery.Usage)
+            mapQuery.Usage->Touch();
+    }
+
+    /// Drop the queries for which isReleased(mapId, navMesh) is true, so the client no longer keeps their
+    /// navmesh alive after its map got unloaded or reloaded.
+    template<typename Fn>
+    inline void ReleaseNavmeshQueries(Fn&& isReleased)
+    {
+        std::erase_if(NavMeshQuery, [&](const auto& entry)
+        {
+            if (!isReleased(entry.first, entry.second.NavMesh.get()))
+                return false;
+
+            ForgetNavmesh(entry.second.NavMesh.get());
+            return true;
+        });
+    }
+
+    /// Wait until the client is not used by another request and keep it for the calling one.
+    inline ClientRequestLock LockRequest() { return ClientRequestLock(RequestMutex); }
+
+    /// ReleaseNavmeshQueries from outside of a request, e.g. for a client that has been idle since its maps were
+    /// unloaded. Returns false without releasing anything if a request is using the client.
+    template<typename Fn>
+    inline bool TryReleaseNavmeshQueries(Fn&& isReleased)
+    {
+        const ClientRequestLock lock(RequestMutex, std::try_to_lock);
+
+        if (!lock)
+            return false;
+
+        ReleaseNavmeshQueries(std::forward<Fn>(isReleased));
+        return true;
+    }
 
     constexpr inline int GetPolyPathBufferSize() const noexcept { return PolyPathBufferSize; }
 
@@ -75,6 +174,20 @@ public:
         return PolyPathBuffer.get();
     }
 
+    inline PolySearch* GetPolySearch(int maxNodes)
+    {
+        if (!Search) Search = std::make_unique<PolySearch>(maxNodes);
+        return Search.get();
+    }
+
+    constexpr inline MovementHandle& GetMovementHandle() noexcept { return Movement; }
+
+    inline PathSession* GetPathSession()
+    {
+        if (!Session) Session = std::make_unique<PathSession>(PolyPathBufferSize);
+        return Session.get();
+    }
+
     inline void ResetQueryFilter() noexcept
     {
         std::unique_lock lock(FilterMutex);
@@ -106,4 +219,14 @@ public:
             CustomFilter = std::move(newFilter);
         }
     }
+
+private:
+    /// Movement and session state refer to polys of a navmesh that is being released.
+    inline void ForgetNavmesh(const dtNavMesh* navMesh) noexcept
+    {
+        Movement = MovementHandle();
+
+        if (Session && Session->NavMesh == navMesh)
+            Session->NavMesh = nullptr;
+    }
 };
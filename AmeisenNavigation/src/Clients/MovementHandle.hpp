@@ -0,0 +1,92 @@
+#pragma once
+
+#include "../../../recastnavigation/Detour/Include/DetourCommon.h"
+#include "../../../recastnavigation/Detour/Include/DetourNavMesh.h"
+#include "../../../recastnavigation/Detour/Include/DetourNavMeshQuery.h"
+
+#include "../Search/PolyGraph.hpp"
+#include "../Utils/PolyPosition.hpp"
+
+/// <summary>
+/// Poly a client ended up on after its last movement query. Bots move by small steps, so the next query
+/// starts on the same poly or one of its neighbours and does not need a nearest poly search.
+/// </summary>
+class MovementHandle
+{
+    int MapId;
+    const dtNavMesh* NavMesh;
+    dtPolyRef Poly;
+
+public:
+    MovementHandle() noexcept
+        : MapId(-1),
+        NavMesh(nullptr),
+        Poly(0)
+    {}
+
+    inline void Set(int mapId, const dtNavMesh* navMesh, dtPolyRef poly) noexcept
+    {
+        MapId = mapId;
+        NavMesh = navMesh;
+        Poly = poly;
+    }
+
+    /// Find the poly below pos (navmesh coordinates) among the cached poly and its neighbours. The height of
+    /// pos may differ by maxHeightDiff from the surface. Fails if the client moved further, switched maps or
+    /// the tile of the cached poly got replaced.
+    bool TryLocate(int mapId, const dtNavMesh* navMesh, const dtQueryFilter* filter, const float* pos,
+                   float maxHeightDiff, PolyPosition& result) const noexcept
+    {
+        if (!Poly || mapId != MapId || navMesh != NavMesh || !navMesh->isValidPolyRef(Poly))
+            return false;
+
+        const dtMeshTile* tile = nullptr;
+        const dtPoly* poly = nullptr;
+        navMesh->getTileAndPolyByRefUnsafe(Poly, &tile, &poly);
+
+        if (IsAbove(navMesh, tile, poly, filter, pos, maxHeightDiff, result))
+        {
+            result.poly = Poly;
+            return true;
+        }
+
+        for (unsigned int i = poly->firstLink; i != DT_NULL_LINK; i = tile->links[i].next)
+        {
+            const dtPolyRef neighbourRef = tile->links[i].ref;
+
+            if (!neighbourRef)
+                continue;
+
+            const dtMeshTile* neighbourTile = nullptr;
+            const dtPoly* neighbourPoly = nullptr;
+            navMesh->getTileAndPolyByRefUnsafe(neighbourRef, &neighbourTile, &neighbourPoly);
+
+            if (IsAbove(navMesh, neighbourTile, neighbourPoly, filter, pos, maxHeightDiff, result))
+            {
+                result.poly = neighbourRef;
+                return true;
+            }
+        }
+
+        return false;
+    }
+
+private:
+    static inline bool IsAbove(const dtNavMesh* navMesh, const dtMeshTile* tile, const dtPoly* poly,
+                               const dtQueryFilter* filter, const float* pos, float maxHeightDiff,
+                               PolyPosition& result) noexcept
+    {
+        // off-mesh connections have no surface, getPolyHeight rejects them
+        float height;
+
+        if (!PolyGraph::PassFilter(filter, poly) || !navMesh->getPolyHeight(tile, poly, pos, &height)
+            || dtAbs(height - pos[1]) > maxHeightDiff)
+        {
+            return false;
+        }
+
+        dtVcopy(result.pos, pos);
+        result.pos[1] = height;
+        return true;
+    }
+};
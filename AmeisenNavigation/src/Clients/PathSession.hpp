@@ -0,0 +1,32 @@
+#pragma once
+
+#include <new>
+
+#include "../../../recastnavigation/Detour/Include/DetourNavMesh.h"
+#include "../../../recastnavigation/Detour/Include/DetourPathCorridor.h"
+
+/// <summary>
+/// Corridor a client follows between path session updates, see AmeisenNavigation::UpdatePathSession.
+/// </summary>
+struct PathSession
+{
+    int MapId;
+    const dtNavMesh* NavMesh; // nullptr until the first plan
+    int SearchFlags;
+    bool Partial;             // the corridor does not reach the target poly
+    float PlannedTarget[3];   // requested target of the last plan
+    dtPathCorridor Corridor;  // in navmesh coordinates
+
+    PathSession(int maxPath)
+        : MapId(-1),
+        NavMesh(nullptr),
+        SearchFlags(0),
+        Partial(false),
+        PlannedTarget{ 0.0f, 0.0f, 0.0f },
+        Corridor()
+    {
+        // setCorridor only accepts paths shorter than the corridor
+        if (!Corridor.init(maxPath + 1))
+            throw std::bad_alloc();
+    }
+};
@@ -0,0 +1,332 @@
+#pragma once
+
+#include <algorithm>
+#include <atomic>
+#include <cfloat>
+#include <cmath>
+#include <memory>
+#include <mutex>
+#include <vector>
+
+#include "../../../recastnavigation/Detour/Include/DetourCommon.h"
+#include "../../../recastnavigation/Detour/Include/DetourNavMesh.h"
+#include "../../../recastnavigation/Detour/Include/DetourNavMeshQuery.h"
+
+#include "../Search/PolyGraph.hpp"
+
+/// Maximum number of tile layers looked at per grid location.
+constexpr int HEIGHT_RASTER_MAX_TILE_LAYERS = 8;
+
+/// Upper bound of the sample points per tile side, limits the memory of a tile if the cell size is tiny.
+constexpr int HEIGHT_RASTER_MAX_SIDE = 1024;
+
+/// Height difference between neighbouring samples of the same surface, relative to the cell size. Covers
+/// the steepest walkable slopes across the diagonal of a cell.
+constexpr float HEIGHT_RASTER_SLOPE_TOLERANCE = 1.7f;
+
+/// <summary>
+/// Surface heights of the detail meshes sampled on a regular grid per tile. Every sample point stores one
+/// height per surface layer above it (floors of buildings, bridges), so height queries do not have to
+/// collect the polys of the whole vertical column like findNearestPoly with tall extents does.
+///
+/// Tiles are rasterized lazily on their first query, a raster is replaced once the salt of its tile changed
+/// and dropped by ReleaseStaleTiles once its tile got removed. A query picks the layer closest to the requested
+/// height at the nearest sample and interpolates it bilinearly with the matching layers of the other
+/// corners of its cell. Cells at the edge of the mesh or across steps fail and have to be answered by
+/// findNearestPoly.
+/// </summary>
+class HeightRaster
+{
+    struct Sample
+    {
+        unsigned short Height; // quantized between the tile bounds
+        unsigned short Flags;  // poly flags, for the query filter
+    };
+
+    struct TileRaster
+    {
+        dtTileRef Ref;
+        float Origin[3]; // tile bmin
+        float HeightScale;
+        int Width;  // sample points along x
+        int Height; // sample points along z
+        std::vector<unsigned int> Starts; // Width * Height + 1 offsets into Samples
+        std::vector<Sample> Samples;      // sorted by height per point
+    };
+
+    const dtNavMesh* NavMesh;
+    float CellSize;
+    // by tile index, queries keep the raster they read alive while its slot is replaced
+    std::unique_ptr<std::atomic<std::shared_ptr<const TileRaster>>[]> Tiles;
+
+    // slots are only written under the mutex, which also guards the size of the published rasters
+    mutable std::mutex Mutex;
+    size_t Bytes;
+
+public:
+    HeightRaster(const dtNavMesh* navMesh, float cellSize)
+        : NavMesh(navMesh),
+        CellSize(cellSize),
+        Tiles(std::make_unique<std::atomic<std::shared_ptr<const TileRaster>>[]>(navMesh->getMaxTiles())),
+        Mutex(),
+        Bytes(0)
+    {}
+
+    HeightRaster(const HeightRaster&) = delete;
+    HeightRaster& operator=(const HeightRaster&) = delete;
+
+    constexpr inline float GetCellSize() const noexcept { return CellSize; }
+
+    inline size_t GetMemoryUsage() const noexcept
+    {
+        std::lock_guard lock(Mutex);
+        return Bytes;
+    }
+
+    /// Drop the rasters of tiles that were removed from the navmesh or replaced and not queried since. The
+    /// caller has to lock the tiles of the navmesh against changes.
+    void ReleaseStaleTiles() noexcept
+    {
+        std::lock_guard lock(Mutex);
+
+        for (int i = 0; i < NavMesh->getMaxTiles(); ++i)
+        {
+            const std::shared_ptr<const TileRaster> raster = Tiles[i].load(std::memory_order_relaxed);
+
+            // removing a tile changes its salt, the ref of the slot no longer matches
+            if (raster && raster->Ref != NavMesh->getTileRef(NavMesh->getTile(i)))
+            {
+                Bytes -= GetRasterSize(*raster);
+                Tiles[i].store(nullptr, std::memory_order_release);
+            }
+        }
+    }
+
+    /// Surface height at pos (navmesh coordinates) on the layer closest to pos. Returns false if pos is not
+    /// surrounded by samples of one surface.
+    bool TryGetHeight(const dtQueryFilter* filter, const float* pos, float* height)
+    {
+        int tx = 0;
+        int ty = 0;
+        NavMesh->calcTileLoc(pos, &tx, &ty);
+
+        const dtMeshTile* layers[HEIGHT_RASTER_MAX_TILE_LAYERS];
+        const int layerCount = NavMesh->getTilesAt(tx, ty, layers, HEIGHT_RASTER_MAX_TILE_LAYERS);
+
+        bool found = false;
+        float bestDiff = FLT_MAX;
+
+        for (int l = 0; l < layerCount; ++l)
+        {
+            const std::shared_ptr<const TileRaster> raster = GetTileRaster(layers[l]);
+            float layerHeight;
+
+            if (raster && Interpolate(*raster, layers[l]->header->walkableClimb, filter, pos, &layerHeight)
+                && dtAbs(layerHeight - pos[1]) < bestDiff)
+            {
+                *height = layerHeight;
+                bestDiff = dtAbs(layerHeight - pos[1]);
+                found = true;
+            }
+        }
+
+        return found;
+    }
+
+private:
+    static inline size_t GetRasterSize(const TileRaster& raster) noexcept
+    {
+        return sizeof(TileRaster) + raster.Starts.size() * sizeof(unsigned int) + raster.Samples.size() * sizeof(Sample);
+    }
+
+    std::shared_ptr<const TileRaster> GetTileRaster(const dtMeshTile* tile)
+    {
+        const dtTileRef tileRef = NavMesh->getTileRef(tile);
+        std::atomic<std::shared_ptr<const TileRaster>>& slot = Tiles[NavMesh->decodePolyIdTile(tileRef)];
+        std::shared_ptr<const TileRaster> raster = slot.load(std::memory_order_acquire);
+
+        if (raster && raster->Ref == tileRef)
+            return raster;
+
+        std::shared_ptr<const TileRaster> built;
+
+        try { built = Rasterize(tile, tileRef); }
+        catch (...) { return nullptr; }
+
+        std::lock_guard lock(Mutex);
+        raster = slot.load(std::memory_order_acquire);
+
+        // someone else was faster
+        if (raster && raster->Ref == tileRef)
+            return raster;
+
+        // the tile got replaced, its previous raster is freed once the queries reading it are done
+        if (raster)
+            Bytes -= GetRasterSize(*raster);
+
+        Bytes += GetRasterSize(*built);
+        slot.store(built, std::memory_order_release);
+        return built;
+    }
+
+    bool Interpolate(const TileRaster& raster, float climb, const dtQueryFilter* filter, const float* pos,
+                     float* height) const noexcept
+    {
+        const float fx = (pos[0] - raster.Origin[0]) / CellSize;
+        const float fz = (pos[2] - raster.Origin[2]) / CellSize;
+
+        if (fx < 0.0f || fz < 0.0f || fx > raster.Width - 1 || fz > raster.Height - 1)
+            return false;
+
+        const int x = dtMin(static_cast<int>(fx), raster.Width - 2);
+        const int z = dtMin(static_cast<int>(fz), raster.Height - 2);
+        const float u = fx - x;
+        const float v = fz - z;
+
+        // the layer is decided at the nearest sample, the other corners have to continue its surface
+        float reference;
+
+        if (!FindLayer(raster, filter, x + (u > 0.5f), z + (v > 0.5f), pos[1], FLT_MAX, &reference))
+            return false;
+
+        const float tolerance = climb + HEIGHT_RASTER_SLOPE_TOLERANCE * CellSize;
+        float corners[4];
+
+        for (int i = 0; i < 4; ++i)
+        {
+            const int cx = x + (i & 1);
+            const int cz = z + (i >> 1);
+            float closest;
+
+            // another layer that is closer to pos crosses the cell (edge of a bridge or a floor), the
+            // surface below pos is ambiguous
+            if (!FindLayer(raster, filter, cx, cz, reference, tolerance, &corners[i])
+                || !FindLayer(raster, filter, cx, cz, pos[1], FLT_MAX, &closest)
+                || dtAbs(closest - pos[1]) + tolerance < dtAbs(corners[i] - pos[1]))
+            {
+                return false;
+            }
+        }
+
+        const float rowNear = corners[0] + (corners[1] - corners[0]) * u;
+        const float rowFar = corners[2] + (corners[3] - corners[2]) * u;
+        *height = rowNear + (rowFar - rowNear) * v;
+        return true;
+    }
+
+    /// Height of the layer at a sample point that is closest to y and passes the filter.
+    inline bool FindLayer(const TileRaster& raster, const dtQueryFilter* filter, int x, int z, float y,
+                          float maxDiff, float* height) const noexcept
+    {
+        const int point = z * raster.Width + x;
+        bool found = false;
+
+        for (unsigned int i = raster.Starts[point]; i < raster.Starts[point + 1]; ++i)
+        {
+            const Sample& sample = raster.Samples[i];
+
+            if (!(sample.Flags & filter->getIncludeFlags()) || (sample.Flags & filter->getExcludeFlags()))
+                continue;
+
+            const float sampleHeight = raster.Origin[1] + sample.Height * raster.HeightScale;
+            const float diff = dtAbs(sampleHeight - y);
+
+            if (diff <= maxDiff)
+            {
+                *height = sampleHeight;
+                maxDiff = diff;
+                found = true;
+            }
+        }
+
+        return found;
+    }
+
+    std::unique_ptr<TileRaster> Rasterize(const dtMeshTile* tile, dtTileRef tileRef) const
+    {
+        const dtMeshHeader* header = tile->header;
+        auto raster = std::make_unique<TileRaster>();
+        raster->Ref = tileRef;
+        dtVcopy(raster->Origin, header->bmin);
+        raster->HeightScale = dtMax(header->bmax[1] - header->bmin[1], 0.001f) / 65535.0f;
+        raster->Width = std::clamp(static_cast<int>(std::ceil((header->bmax[0] - header->bmin[0]) / CellSize)) + 1,
+                                   2, HEIGHT_RASTER_MAX_SIDE);
+        raster->Height = std::clamp(static_cast<int>(std::ceil((header->bmax[2] - header->bmin[2]) / CellSize)) + 1,
+                                    2, HEIGHT_RASTER_MAX_SIDE);
+
+        struct PointSample
+        {
+            unsigned int Point;
+            Sample Value;
+        };
+
+        std::vector<PointSample> samples;
+        samples.reserve(static_cast<size_t>(raster->Width) * raster->Height);
+
+        for (int i = 0; i < header->polyCount; ++i)
+        {
+            const dtPoly* poly = &tile->polys[i];
+
+            if (poly->getType() == DT_POLYTYPE_OFFMESH_CONNECTION)
+                continue;
+
+            float min[3];
+            float max[3];
+            dtVcopy(min, &tile->verts[poly->verts[0] * 3]);
+            dtVcopy(max, min);
+
+            for (int v = 1; v < poly->vertCount; ++v)
+            {
+                dtVmin(min, &tile->verts[poly->verts[v] * 3]);
+                dtVmax(max, &tile->verts[poly->verts[v] * 3]);
+            }
+
+            const int x0 = dtMax(0, static_cast<int>(std::ceil((min[0] - raster->Origin[0]) / CellSize)));
+            const int x1 = dtMin(raster->Width - 1, static_cast<int>(std::floor((max[0] - raster->Origin[0]) / CellSize)));
+            const int z0 = dtMax(0, static_cast<int>(std::ceil((min[2] - raster->Origin[2]) / CellSize)));
+            const int z1 = dtMin(raster->Height - 1, static_cast<int>(std::floor((max[2] - raster->Origin[2]) / CellSize)));
+
+            for (int z = z0; z <= z1; ++z)
+            {
+                for (int x = x0; x <= x1; ++x)
+                {
+                    const float point[3] = { raster->Origin[0] + x * CellSize, 0.0f, raster->Origin[2] + z * CellSize };
+                    float height;
+
+                    if (!NavMesh->getPolyHeight(tile, poly, point, &height))
+                        continue;
+
+                    const float quantized = std::round((height - raster->Origin[1]) / raster->HeightScale);
+                    samples.push_back(PointSample{ static_cast<unsigned int>(z * raster->Width + x),
+                                                   Sample{ static_cast<unsigned short>(std::clamp(quantized, 0.0f, 65535.0f)),
+                                                           poly->flags } });
+                }
+            }
+        }
+
+        std::sort(samples.begin(), samples.end(), [](const PointSample& a, const PointSample& b)
+        {
+            return a.Point != b.Point ? a.Point < b.Point : a.Value.Height < b.Value.Height;
+        });
+
+        // points on shared poly edges are sampled by every poly of the edge
+        samples.erase(std::unique(samples.begin(), samples.end(), [](const PointSample& a, const PointSample& b)
+        {
+            return a.Point == b.Point && a.Value.Flags == b.Value.Flags && b.Value.Height - a.Value.Height <= 1;
+        }), samples.end());
+
+        raster->Starts.assign(static_cast<size_t>(raster->Width) * raster->Height + 1, 0);
+        raster->Samples.reserve(samples.size());
+
+        for (const PointSample& sample : samples)
+        {
+            ++raster->Starts[sample.Point + 1];
+            raster->Samples.push_back(sample.Value);
+        }
+
+        for (size_t i = 1; i < raster->Starts.size(); ++i)
+            raster->Starts[i] += raster->Starts[i - 1];
+
+        return raster;
+    }
+};
@@ -0,0 +1,425 @@
+#pragma once
+
+#include <atomic>
+#include <functional>
+#include <limits>
+#include <queue>
+#include <stop_token>
+#include <utility>
+#include <vector>
+
+#include "../../../recastnavigation/Detour/Include/DetourCommon.h"
+#include "../../../recastnavigation/Detour/Include/DetourNavMesh.h"
+
+#include "../Search/PolyGraph.hpp"
+#include "../Search/PolySearch.hpp"
+
+/// Marker for polys that are not reachable from a landmark.
+constexpr unsigned short LANDMARK_UNREACHABLE = std::numeric_limits<unsigned short>::max();
+
+/// <summary>
+/// Per map landmark table for the ALT (A*, Landmarks, Triangle inequality) heuristic.
+///
+/// The search places every node at the midpoint of the portal it was first reached through and pays the
+/// distance between two node positions times the area cost for every step. The graph the distances are
+/// measured on has an edge per poly link, weighted with the shortest distance between any position the
+/// two polys can have, so a graph distance times the lowest area cost of the filter never exceeds the
+/// search cost. Links are one way, the table keeps the distances from every landmark (forward graph) and
+/// to every landmark (reverse graph), the triangle inequality gives two lower bounds for d(n, goal):
+/// d(L, goal) - d(L, n) and d(n, L) - d(goal, L).
+///
+/// Distances are quantized to 16 bit per landmark (rounded down, so the bounds hold) to keep continents
+/// at a few megabytes. Landmarks are picked by farthest point selection inside the largest connected
+/// component, distances are measured without any filter so they are valid for every client state.
+/// </summary>
+class LandmarkTable
+{
+    const dtNavMesh* NavMesh;
+    int LandmarkCount;
+    PolyGraph::PolyIndexer Indexer;
+    std::vector<dtPolyRef> Landmarks;
+    std::vector<float> Quanta; // [landmark] from the landmark, [LandmarkCount + landmark] to it
+    std::vector<unsigned short> Distances; // [polyIndex * LandmarkCount * 2 + the index of Quanta]
+    std::atomic<bool> Ready;
+
+public:
+    LandmarkTable(const dtNavMesh* navMesh, int landmarkCount) noexcept
+        : NavMesh(navMesh),
+        LandmarkCount(landmarkCount),
+        Indexer(),
+        Landmarks(),
+        Quanta(),
+        Distances(),
+        Ready(false)
+    {}
+
+    LandmarkTable(const LandmarkTable&) = delete;
+    LandmarkTable& operator=(const LandmarkTable&) = delete;
+
+    constexpr inline const dtNavMesh* GetNavMesh() const noexcept { return NavMesh; }
+    inline bool IsReady() const noexcept { return Ready.load(std::memory_order_acquire); }
+    inline int GetLandmarkCount() const noexcept { return static_cast<int>(Landmarks.size()); }
+    inline size_t GetMemoryUsage() const noexcept { return Distances.size() * sizeof(unsigned short); }
+
+    /// Compute the table, runs two Dijkstras over the whole mesh per landmark. Returns false if the
+    /// navmesh is empty or the build was cancelled via the stop token.
+    bool Build(std::stop_token stopToken)
+    {
+        Indexer.Build(NavMesh);
+        const int polyCount = Indexer.GetPolyCount();
+
+        if (polyCount == 0 || LandmarkCount <= 0)
+            return false;
+
+        const BuildData data = BuildGraph(polyCount);
+        std::vector<float> dist(polyCount);
+        std::vector<float> minDist(polyCount, std::numeric_limits<float>::max());
+
+        // seed inside the largest component, tiny islands would make useless landmarks
+        const int seed = FindLargestComponentPoly(polyCount, data);
+
+        if (seed < 0 || !Dijkstra(seed, data.Out, dist, stopToken))
+            return false;
+
+        const int stride = LandmarkCount * 2;
+        Distances.assign(static_cast<size_t>(polyCount) * stride, LANDMARK_UNREACHABLE);
+        Quanta.assign(stride, 0.0f);
+        int next = Farthest(dist);
+
+        for (int l = 0; l < LandmarkCount && next >= 0; ++l)
+        {
+            if (!Dijkstra(next, data.In, dist, stopToken))
+                return false;
+
+            Quantize(dist, LandmarkCount + l);
+
+            if (!Dijkstra(next, data.Out, dist, stopToken))
+                return false;
+
+            Quantize(dist, l);
+            Landmarks.push_back(data.Refs[next]);
+
+            for (int i = 0; i < polyCount; ++i)
+            {
+                minDist[i] = dtMin(minDist[i], dist[i]);
+            }
+
+            next = Farthest(minDist);
+
+            if (next >= 0 && minDist[next] <= 0.0f)
+                break;
+        }
+
+        // shrink rows if fewer landmarks than requested could be placed
+        if (static_cast<int>(Landmarks.size()) < LandmarkCount)
+        {
+            const int count = static_cast<int>(Landmarks.size());
+
+            for (int i = 0; i < polyCount; ++i)
+            {
+                for (int l = 0; l < count; ++l)
+                {
+                    Distances[static_cast<size_t>(i) * count * 2 + l] = Distances[static_cast<size_t>(i) * stride + l];
+                    Distances[static_cast<size_t>(i) * count * 2 + count + l] =
+                        Distances[static_cast<size_t>(i) * stride + LandmarkCount + l];
+                }
+            }
+
+            std::copy(Quanta.begin() + LandmarkCount, Quanta.begin() + LandmarkCount + count, Quanta.begin() + count);
+            Quanta.resize(static_cast<size_t>(count) * 2);
+            Distances.resize(static_cast<size_t>(polyCount) * count * 2);
+            LandmarkCount = count;
+        }
+
+        Ready.store(!Landmarks.empty(), std::memory_order_release);
+        return IsReady();
+    }
+
+    /// Row of quantized distances for a poly, nullptr if the poly is unknown to the table.
+    inline const unsigned short* GetRow(dtPolyRef ref) const noexcept
+    {
+        const int index = Indexer.Get(ref);
+        return index >= 0 && index < Indexer.GetPolyCount()
+            ? &Distances[static_cast<size_t>(index) * LandmarkCount * 2]
+            : nullptr;
+    }
+
+    /// Lower bound of the graph distance from a poly to the goal, goalRow must be the goal's GetRow().
+    inline float Estimate(const unsigned short* goalRow, dtPolyRef ref) const noexcept
+    {
+        const unsigned short* row = GetRow(ref);
+
+        if (!goalRow || !row)
+            return 0.0f;
+
+        float best = 0.0f;
+
+        // both values are rounded down, so each difference may be one quantum too large
+        for (int l = 0; l < LandmarkCount; ++l)
+        {
+            if (row[l] != LANDMARK_UNREACHABLE && goalRow[l] != LANDMARK_UNREACHABLE && goalRow[l] > row[l] + 1)
+                best = dtMax(best, static_cast<float>(goalRow[l] - row[l] - 1) * Quanta[l]);
+
+            const int to = LandmarkCount + l;
+
+            if (row[to] != LANDMARK_UNREACHABLE && goalRow[to] != LANDMARK_UNREACHABLE && row[to] > goalRow[to] + 1)
+                best = dtMax(best, static_cast<float>(row[to] - goalRow[to] - 1) * Quanta[to]);
+        }
+
+        return best;
+    }
+
+private:
+    /// Links of every poly in compressed rows, weighted with the shortest way through the poly they leave.
+    struct Adjacency
+    {
+        std::vector<int> Starts; // polyCount + 1 offsets into Targets and Weights
+        std::vector<int> Targets;
+        std::vector<float> Weights;
+    };
+
+    /// Scratch data only needed while building.
+    struct BuildData
+    {
+        std::vector<dtPolyRef> Refs;
+        Adjacency Out; // poly -> linked polys
+        Adjacency In;  // poly -> polys linking to it, with the weights of those links
+    };
+
+    BuildData BuildGraph(int polyCount) const
+    {
+        BuildData data{ Indexer.BuildRefs(), {}, {} };
+
+        struct Link
+        {
+            int From;
+            int To;
+            float Exit[3]; // node position the search gives To if it reaches To from From first
+            bool HasExit;
+            bool CrossesTile;
+        };
+
+        std::vector<Link> links;
+        std::vector<int> entryCounts(polyCount, 0);
+
+        for (int i = 0; i < polyCount; ++i)
+        {
+            const dtMeshTile* tile = nullptr;
+            const dtPoly* poly = nullptr;
+            NavMesh->getTileAndPolyByRefUnsafe(data.Refs[i], &tile, &poly);
+
+            for (unsigned int k = poly->firstLink; k != DT_NULL_LINK; k = tile->links[k].next)
+            {
+                const dtPolyRef ref = tile->links[k].ref;
+                const int neighbour = ref ? Indexer.Get(ref) : -1;
+
+                if (neighbour < 0)
+                    continue;
+
+                const dtMeshTile* neighbourTile = nullptr;
+                const dtPoly* neighbourPoly = nullptr;
+                NavMesh->getTileAndPolyByRefUnsafe(ref, &neighbourTile, &neighbourPoly);
+
+                Link& link = links.emplace_back(Link{ i, neighbour, {}, false, tile->links[k].side != 0xff });
+                link.HasExit = PolyGraph::GetEdgeMidPoint(data.Refs[i], poly, tile, ref, neighbourPoly,
+                                                          neighbourTile, link.Exit);
+                ++entryCounts[neighbour];
+            }
+        }
+
+        // links are ordered by From, which makes them the compressed rows of Out
+        data.Out.Starts.assign(polyCount + 1, 0);
+        data.In.Starts.assign(polyCount + 1, 0);
+
+        for (const Link& link : links)
+        {
+            ++data.Out.Starts[link.From + 1];
+            ++data.In.Starts[link.To + 1];
+        }
+
+        for (int i = 0; i < polyCount; ++i)
+        {
+            data.Out.Starts[i + 1] += data.Out.Starts[i];
+            data.In.Starts[i + 1] += data.In.Starts[i];
+        }
+
+        // the search enters a poly at the midpoint of the portal it first reached it through
+        std::vector<int> entries(links.size());
+        std::vector<int> fill(data.In.Starts.begin(), data.In.Starts.end() - 1);
+
+        for (int k = 0; k < static_cast<int>(links.size()); ++k)
+            entries[fill[links[k].To]++] = k;
+
+        data.Out.Targets.resize(links.size());
+        data.Out.Weights.resize(links.size());
+        data.In.Targets.resize(links.size());
+        data.In.Weights.resize(links.size());
+        fill.assign(data.In.Starts.begin(), data.In.Starts.end() - 1);
+
+        for (int k = 0; k < static_cast<int>(links.size()); ++k)
+        {
+            const Link& link = links[k];
+            float weight = std::numeric_limits<float>::max();
+
+            // the step costs the distance between the positions of both polys, each is the portal midpoint
+            // of whichever link reached the poly first. Both can not be reached from each other first, but
+            // polys of other tiles get one node per border side and can.
+            for (int e = data.In.Starts[link.From]; e < data.In.Starts[link.From + 1] && weight > 0.0f; ++e)
+            {
+                const Link& fromEntry = links[entries[e]];
+
+                for (int t = data.In.Starts[link.To]; t < data.In.Starts[link.To + 1] && weight > 0.0f; ++t)
+                {
+                    const Link& toEntry = links[entries[t]];
+
+                    if (!fromEntry.HasExit || !toEntry.HasExit)
+                        weight = 0.0f;
+                    else if (fromEntry.From != link.To || toEntry.From != link.From || link.CrossesTile)
+                        weight = dtMin(weight, dtVdist(fromEntry.Exit, toEntry.Exit));
+                }
+            }
+
+            // polys nothing links to are only ever the start, whose position can be anywhere
+            if (weight == std::numeric_limits<float>::max())
+                weight = 0.0f;
+
+            data.Out.Targets[k] = link.To;
+            data.Out.Weights[k] = weight;
+            data.In.Targets[fill[link.To]] = link.From;
+            data.In.Weights[fill[link.To]++] = weight;
+        }
+
+        return data;
+    }
+
+    bool Dijkstra(int source, const Adjacency& graph, std::vector<float>& dist, std::stop_token stopToken) const
+    {
+        using Entry = std::pair<float, int>;
+        std::priority_queue<Entry, std::vector<Entry>, std::greater<Entry>> open;
+
+        std::fill(dist.begin(), dist.end(), std::numeric_limits<float>::max());
+        dist[source] = 0.0f;
+        open.emplace(0.0f, source);
+
+        for (int popped = 0; !open.empty(); ++popped)
+        {
+            const auto [d, index] = open.top();
+            open.pop();
+
+            if (d > dist[index])
+                continue;
+
+            if ((popped & 0xFFF) == 0 && stopToken.stop_requested())
+                return false;
+
+            for (int k = graph.Starts[index]; k < graph.Starts[index + 1]; ++k)
+            {
+                const int neighbour = graph.Targets[k];
+
+                if (d + graph.Weights[k] < dist[neighbour])
+                {
+                    dist[neighbour] = d + graph.Weights[k];
+                    open.emplace(dist[neighbour], neighbour);
+                }
+            }
+        }
+
+        return true;
+    }
+
+    /// Reachable poly with the largest distance, -1 if nothing is reachable.
+    static int Farthest(const std::vector<float>& dist) noexcept
+    {
+        int best = -1;
+
+        for (int i = 0; i < static_cast<int>(dist.size()); ++i)
+        {
+            if (dist[i] != std::numeric_limits<float>::max() && (best < 0 || dist[i] > dist[best]))
+                best = i;
+        }
+
+        return best;
+    }
+
+    void Quantize(const std::vector<float>& dist, int column)
+    {
+        float maxDist = 0.0f;
+
+        for (float d : dist)
+        {
+            if (d != std::numeric_limits<float>::max())
+                maxDist = dtMax(maxDist, d);
+        }
+
+        const float quantum = dtMax(maxDist / static_cast<float>(LANDMARK_UNREACHABLE - 1), 1e-3f);
+        const size_t stride = static_cast<size_t>(LandmarkCount) * 2;
+        Quanta[column] = quantum;
+
+        for (size_t i = 0; i < dist.size(); ++i)
+        {
+            if (dist[i] != std::numeric_limits<float>::max())
+                Distances[i * stride + column] = static_cast<unsigned short>(dist[i] / quantum);
+        }
+    }
+
+    int FindLargestComponentPoly(int polyCount, const BuildData& data) const
+    {
+        std::vector<int> component(polyCount, -1);
+        std::vector<int> stack;
+        int bestPoly = -1;
+        int bestSize = 0;
+
+        for (int i = 0, c = 0; i < polyCount; ++i)
+        {
+            if (component[i] >= 0)
+                continue;
+
+            int size = 0;
+            component[i] = c;
+            stack.push_back(i);
+
+            while (!stack.empty())
+            {
+                const int index = stack.back();
+                stack.pop_back();
+                ++size;
+
+                for (int k = data.Out.Starts[index]; k < data.Out.Starts[index + 1]; ++k)
+                {
+                    const int neighbour = data.Out.Targets[k];
+
+                    if (component[neighbour] < 0)
+                    {
+                        component[neighbour] = c;
+                        stack.push_back(neighbour);
+                    }
+                }
+            }
+
+            if (size > bestSize)
+            {
+                bestSize = size;
+                bestPoly = i;
+            }
+
+            ++c;
+        }
+
+        return bestPoly;
+    }
+};
+
+/// ALT heuristic for PolySearch::FindPath, falls back to the euclidean estimate where it is larger. Both are
+/// lower bounds of the distance the corridor still has to cover, the lowest area cost makes them costs.
+struct LandmarkHeuristic
+{
+    const LandmarkTable* Table;
+    const unsigned short* GoalRow;
+    const float* EndPos;
+    float CostScale; // lowest area cost of the filter
+
+    inline float operator()(dtPolyRef ref, const float* pos) const noexcept
+    {
+        return dtMax(dtVdist(pos, EndPos) * POLY_SEARCH_H_SCALE, Table->Estimate(GoalRow, ref)) * CostScale;
+    }
+};
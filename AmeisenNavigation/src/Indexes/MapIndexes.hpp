@@ -0,0 +1,28 @@
+#pragma once
+
+#include <atomic>
+#include <memory>
+
+#include "../../../recastnavigation/Detour/Include/DetourNavMesh.h"
+
+#include "../NavSources/INavSource.hpp"
+
+#include "HeightRaster.hpp"
+#include "LandmarkTable.hpp"
+#include "NearestPolyGrid.hpp"
+#include "RandomPointTable.hpp"
+#include "TileGraph.hpp"
+
+/// Search indexes derived from the navmesh of a map. They are built in the background and are only valid
+/// for the navmesh they were built from, check IsReady() of each index before using it.
+struct MapIndexes
+{
+    const dtNavMesh* NavMesh;
+    NavMeshRef NavMeshOwner; // keeps a reloaded navmesh alive while its indexes are still built or used
+    std::unique_ptr<TileGraph> Tiles;
+    std::unique_ptr<LandmarkTable> Landmarks; // nullptr if landmarks are disabled
+    std::unique_ptr<NearestPolyGrid> NearestPolys;
+    std::unique_ptr<RandomPointTable> RandomPoints;
+    std::unique_ptr<HeightRaster> Heights; // nullptr if the height raster is disabled, tiles are built on demand
+    std::atomic<bool> Built{ false };      // set once the background build is done, indexes that failed stay unready
+};
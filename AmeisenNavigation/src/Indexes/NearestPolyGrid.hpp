@@ -0,0 +1,238 @@
+#pragma once
+
+#include <algorithm>
+#include <atomic>
+#include <cmath>
+#include <vector>
+
+#include "../../../recastnavigation/Detour/Include/DetourCommon.h"
+#include "../../../recastnavigation/Detour/Include/DetourNavMesh.h"
+#include "../../../recastnavigation/Detour/Include/DetourNavMeshQuery.h"
+
+#include "../Search/PolyGraph.hpp"
+
+/// Upper bound of the cells per tile side, tiles get about one cell per poly.
+constexpr int NEAREST_POLY_GRID_MAX_SIDE = 128;
+
+/// Maximum number of tile layers looked at per grid location.
+constexpr int NEAREST_POLY_GRID_MAX_LAYERS = 8;
+
+/// <summary>
+/// 2D grid over every tile that lists the polys overlapping each cell, sorted from the highest to the
+/// lowest. Snapping a position that stands on the mesh becomes a cell lookup plus a point in polygon and
+/// detail height test of the few polys in the cell.
+///
+/// Only answers the case that decides dtNavMeshQuery::findNearestPoly without comparing distances: the
+/// position is above a poly and no further than the walkable climb height away from its surface. Everything
+/// else is left to findNearestPoly.
+/// </summary>
+class NearestPolyGrid
+{
+    struct TileCells
+    {
+        dtTileRef Ref; // tile the cells were built for, 0 if it has none
+        float Origin[2]; // bmin x and z
+        float InverseCellSize[2];
+        int Width;
+        int Height;
+        std::vector<unsigned int> CellStarts; // Width * Height + 1 offsets into Polys
+        std::vector<unsigned short> Polys;    // poly indices in the tile
+    };
+
+    const dtNavMesh* NavMesh;
+    std::vector<TileCells> Tiles; // by tile index
+    std::atomic<bool> Ready;
+
+public:
+    NearestPolyGrid(const dtNavMesh* navMesh) noexcept
+        : NavMesh(navMesh),
+        Tiles(),
+        Ready(false)
+    {}
+
+    NearestPolyGrid(const NearestPolyGrid&) = delete;
+    NearestPolyGrid& operator=(const NearestPolyGrid&) = delete;
+
+    inline bool IsReady() const noexcept { return Ready.load(std::memory_order_acquire); }
+
+    inline size_t GetMemoryUsage() const noexcept
+    {
+        size_t size = Tiles.size() * sizeof(TileCells);
+
+        for (const TileCells& cells : Tiles)
+            size += cells.CellStarts.size() * sizeof(unsigned int) + cells.Polys.size() * sizeof(unsigned short);
+
+        return size;
+    }
+
+    /// Number of tiles that got a grid.
+    inline int GetTileCount() const noexcept
+    {
+        return static_cast<int>(std::count_if(Tiles.begin(), Tiles.end(), [](const auto& t) { return t.Ref != 0; }));
+    }
+
+    bool Build()
+    {
+        const int maxTiles = NavMesh->getMaxTiles();
+        Tiles.resize(maxTiles);
+
+        for (int i = 0; i < maxTiles; ++i)
+        {
+            const dtMeshTile* tile = NavMesh->getTile(i);
+
+            // poly indices are stored as 16 bit
+            if (tile && tile->header && tile->header->polyCount > 0 && tile->header->polyCount <= 0xFFFF)
+                BuildTile(tile, Tiles[i]);
+        }
+
+        Ready.store(GetTileCount() > 0, std::memory_order_release);
+        return IsReady();
+    }
+
+    /// Find the poly pos (navmesh coordinates) stands on. Fails if pos is not above a poly within climb height
+    /// and maxHeightDiff, or if one of the tiles at pos has no grid, findNearestPoly has to decide then.
+    bool FindPolyBelow(const dtQueryFilter* filter, const float* pos, float maxHeightDiff, dtPolyRef* polyRef,
+                       float* nearest) const noexcept
+    {
+        int tx = 0;
+        int ty = 0;
+        NavMesh->calcTileLoc(pos, &tx, &ty);
+
+        const dtMeshTile* layers[NEAREST_POLY_GRID_MAX_LAYERS];
+        const int layerCount = NavMesh->getTilesAt(tx, ty, layers, NEAREST_POLY_GRID_MAX_LAYERS);
+
+        dtPolyRef bestRef = 0;
+        float bestHeight = 0.0f;
+        float bestDiff = FLT_MAX;
+
+        for (int l = 0; l < layerCount; ++l)
+        {
+            const dtMeshTile* tile = layers[l];
+            const dtTileRef tileRef = NavMesh->getTileRef(tile);
+            const TileCells& cells = Tiles[NavMesh->decodePolyIdTile(tileRef)];
+
+            // added or replaced after the build
+            if (cells.Ref != tileRef)
+                return false;
+
+            const int cx = static_cast<int>((pos[0] - cells.Origin[0]) * cells.InverseCellSize[0]);
+            const int cz = static_cast<int>((pos[2] - cells.Origin[1]) * cells.InverseCellSize[1]);
+
+            if (cx < 0 || cz < 0 || cx >= cells.Width || cz >= cells.Height)
+                continue;
+
+            const float maxDiff = dtMin(tile->header->walkableClimb, maxHeightDiff);
+            const int cell = cz * cells.Width + cx;
+
+            for (unsigned int i = cells.CellStarts[cell]; i < cells.CellStarts[cell + 1]; ++i)
+            {
+                const dtPoly* poly = &tile->polys[cells.Polys[i]];
+                const dtPolyRef ref = tileRef | static_cast<dtPolyRef>(cells.Polys[i]);
+                float height;
+
+                if (!PolyGraph::PassFilter(filter, poly) || !NavMesh->getPolyHeight(tile, poly, pos, &height))
+                    continue;
+
+                const float diff = dtAbs(height - pos[1]);
+
+                if (diff <= maxDiff && diff < bestDiff)
+                {
+                    bestRef = ref;
+                    bestHeight = height;
+                    bestDiff = diff;
+                }
+            }
+        }
+
+        if (!bestRef)
+            return false;
+
+        *polyRef = bestRef;
+        dtVset(nearest, pos[0], bestHeight, pos[2]);
+        return true;
+    }
+
+private:
+    void BuildTile(const dtMeshTile* tile, TileCells& cells) const
+    {
+        const dtMeshHeader* header = tile->header;
+        const int polyCount = header->polyCount;
+        const int side = std::clamp(static_cast<int>(std::ceil(std::sqrt(static_cast<float>(polyCount)))), 1,
+                                    NEAREST_POLY_GRID_MAX_SIDE);
+
+        cells.Origin[0] = header->bmin[0];
+        cells.Origin[1] = header->bmin[2];
+        cells.Width = side;
+        cells.Height = side;
+        cells.InverseCellSize[0] = side / dtMax(header->bmax[0] - header->bmin[0], 0.001f);
+        cells.InverseCellSize[1] = side / dtMax(header->bmax[2] - header->bmin[2], 0.001f);
+
+        struct Bounds
+        {
+            int MinX, MinZ, MaxX, MaxZ;
+            float Top;
+        };
+
+        std::vector<Bounds> bounds(polyCount);
+        std::vector<unsigned short> order;
+        order.reserve(polyCount);
+
+        for (int i = 0; i < polyCount; ++i)
+        {
+            const dtPoly* poly = &tile->polys[i];
+
+            if (poly->getType() == DT_POLYTYPE_OFFMESH_CONNECTION)
+                continue;
+
+            float min[3];
+            float max[3];
+            dtVcopy(min, &tile->verts[poly->verts[0] * 3]);
+            dtVcopy(max, min);
+
+            for (int v = 1; v < poly->vertCount; ++v)
+            {
+                dtVmin(min, &tile->verts[poly->verts[v] * 3]);
+                dtVmax(max, &tile->verts[poly->verts[v] * 3]);
+            }
+
+            bounds[i] = Bounds{ ToCell(min[0], cells.Origin[0], cells.InverseCellSize[0], side),
+                                ToCell(min[2], cells.Origin[1], cells.InverseCellSize[1], side),
+                                ToCell(max[0], cells.Origin[0], cells.InverseCellSize[0], side),
+                                ToCell(max[2], cells.Origin[1], cells.InverseCellSize[1], side),
+                                max[1] };
+            order.push_back(static_cast<unsigned short>(i));
+        }
+
+        // upper layers first, the cells keep this order
+        std::sort(order.begin(), order.end(), [&](unsigned short a, unsigned short b) { return bounds[a].Top > bounds[b].Top; });
+
+        cells.CellStarts.assign(static_cast<size_t>(side) * side + 1, 0);
+
+        for (const unsigned short i : order)
+        {
+            for (int z = bounds[i].MinZ; z <= bounds[i].MaxZ; ++z)
+                for (int x = bounds[i].MinX; x <= bounds[i].MaxX; ++x)
+                    ++cells.CellStarts[z * side + x + 1];
+        }
+
+        for (size_t c = 1; c < cells.CellStarts.size(); ++c)
+            cells.CellStarts[c] += cells.CellStarts[c - 1];
+
+        cells.Polys.resize(cells.CellStarts.back());
+        std::vector<unsigned int> fill(cells.CellStarts.begin(), cells.CellStarts.end() - 1);
+
+        for (const unsigned short i : order)
+        {
+            for (int z = bounds[i].MinZ; z <= bounds[i].MaxZ; ++z)
+                for (int x = bounds[i].MinX; x <= bounds[i].MaxX; ++x)
+                    cells.Polys[fill[z * side + x]++] = i;
+        }
+
+        cells.Ref = NavMesh->getTileRef(tile);
+    }
+
+    static inline int ToCell(float value, float origin, float inverseCellSize, int side) noexcept
+    {
+        return std::clamp(static_cast<int>((value - origin) * inverseCellSize), 0, side - 1);
+    }
+};
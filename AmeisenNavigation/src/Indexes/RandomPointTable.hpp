@@ -0,0 +1,666 @@
+#pragma once
+
+#include <algorithm>
+#include <atomic>
+#include <cmath>
+#include <memory>
+#include <mutex>
+#include <unordered_map>
+#include <vector>
+
+#include "../../../recastnavigation/Detour/Include/DetourCommon.h"
+#include "../../../recastnavigation/Detour/Include/DetourNavMesh.h"
+#include "../../../recastnavigation/Detour/Include/DetourNavMeshQuery.h"
+
+#include "../Search/PolyGraph.hpp"
+
+/// Side length of the cells the polys are bucketed into, in navmesh units.
+constexpr float RANDOM_POINT_CELL_SIZE = 32.0f;
+
+/// Vertices of a poly clipped to a cell, each side of the cell can add one.
+constexpr int RANDOM_POINT_MAX_CLIP_VERTS = DT_VERTS_PER_POLYGON + 4;
+
+/// Number of rejected samples before a query gives up and findRandomPoint* has to answer it.
+constexpr int RANDOM_POINT_MAX_ATTEMPTS = 64;
+
+/// Circles covering more cells than this are left to findRandomPointAroundCircle.
+constexpr int RANDOM_POINT_MAX_CIRCLE_CELLS = 4096;
+
+/// Circles smaller than this are left to findRandomPointAroundCircle, most samples would miss them and its
+/// search stays small anyway.
+constexpr float RANDOM_POINT_MIN_CIRCLE_RADIUS = RANDOM_POINT_CELL_SIZE * 0.5f;
+
+/// Circles whose reachable part has more polys than this are left to findRandomPointAroundCircle.
+constexpr int RANDOM_POINT_MAX_CIRCLE_POLYS = 4096;
+
+/// Number of flag sets whose tables are kept, the tables are reset when more show up.
+constexpr size_t RANDOM_POINT_MAX_FLAG_SETS = 16;
+
+/// <summary>
+/// Area weighted random point sampling without scanning the navmesh.
+///
+/// The polys are clipped to a 2D grid of cells, every cell lists the polys overlapping it with the area of
+/// the overlap. For every set of include and exclude flags, alias tables are built on first use: one over
+/// the cells, weighted by the area of the polys in them that pass the flags, and one per cell over its
+/// polys. A sample draws a cell, a poly of the cell and a point in the part of the poly inside of the cell,
+/// so the points are uniformly distributed over the mesh surface.
+///
+/// Samples around a circle first collect the polys findRandomPointAroundCircle would visit: the ones reached
+/// from the start poly through portals that touch the circle. They draw from the cells the circle overlaps
+/// and reject points outside of the circle or on polys that were not reached.
+/// </summary>
+class RandomPointTable
+{
+    struct AliasSlot
+    {
+        float Probability;
+        unsigned int Alias;
+    };
+
+    /// Alias tables for one set of flags.
+    struct FlagTable
+    {
+        std::vector<AliasSlot> Cells;     // one per cell
+        std::vector<AliasSlot> CellPolys; // parallel to CellPolys of the index, indices local to the cell
+        std::vector<float> CellAreas;     // area of the polys in the cell that pass the flags
+        std::vector<bool> Passes;         // by dense poly index, whether the poly passes the flags
+        double TotalArea = 0.0;
+    };
+
+    const dtNavMesh* NavMesh;
+    PolyGraph::PolyIndexer Indexer;
+    std::vector<dtPolyRef> Refs; // by dense index
+    std::vector<float> Areas;    // by dense index, 0 for off-mesh connections
+    float Origin[2];             // min x and z of all tiles
+    int Width;
+    int Height;
+    std::vector<unsigned int> CellStarts; // Width * Height + 1 offsets into CellPolys
+    std::vector<int> CellPolys;           // dense indices of the polys overlapping each cell
+    std::vector<float> CellPolyAreas;     // area of the poly inside of the cell, parallel to CellPolys
+    std::atomic<bool> Ready;
+
+    mutable std::mutex TableMutex;
+    mutable std::unordered_map<uint32_t, std::shared_ptr<const FlagTable>> Tables;
+
+public:
+    RandomPointTable(const dtNavMesh* navMesh) noexcept
+        : NavMesh(navMesh),
+        Indexer(),
+        Refs(),
+        Areas(),
+        Origin{ 0.0f, 0.0f },
+        Width(0),
+        Height(0),
+        CellStarts(),
+        CellPolys(),
+        CellPolyAreas(),
+        Ready(false),
+        TableMutex(),
+        Tables()
+    {}
+
+    RandomPointTable(const RandomPointTable&) = delete;
+    RandomPointTable& operator=(const RandomPointTable&) = delete;
+
+    inline bool IsReady() const noexcept { return Ready.load(std::memory_order_acquire); }
+    inline int GetCellCount() const noexcept { return Width * Height; }
+
+    inline size_t GetMemoryUsage() const noexcept
+    {
+        size_t size = Refs.size() * sizeof(dtPolyRef) + Areas.size() * sizeof(float)
+            + CellStarts.size() * sizeof(unsigned int) + CellPolys.size() * (sizeof(int) + sizeof(float));
+
+        std::lock_guard lock(TableMutex);
+
+        for (const auto& [flags, table] : Tables)
+        {
+            size += table->Cells.size() * sizeof(AliasSlot) + table->CellPolys.size() * sizeof(AliasSlot)
+                + table->CellAreas.size() * sizeof(float) + table->Passes.size() / 8;
+        }
+
+        return size;
+    }
+
+    /// Build the flag independent part: poly areas and the cell grid.
+    bool Build()
+    {
+        Indexer.Build(NavMesh);
+        const int polyCount = Indexer.GetPolyCount();
+
+        if (polyCount == 0)
+            return false;
+
+        Refs = Indexer.BuildRefs();
+        Areas.assign(polyCount, 0.0f);
+
+        std::vector<float> bounds(static_cast<size_t>(polyCount) * 4);
+        float min[2] = { FLT_MAX, FLT_MAX };
+        float max[2] = { -FLT_MAX, -FLT_MAX };
+
+        for (int i = 0; i < polyCount; ++i)
+        {
+            const dtMeshTile* tile = nullptr;
+            const dtPoly* poly = nullptr;
+            NavMesh->getTileAndPolyByRefUnsafe(Refs[i], &tile, &poly);
+
+            if (poly->getType() == DT_POLYTYPE_OFFMESH_CONNECTION)
+                continue;
+
+            float* polyBounds = &bounds[i * 4];
+            polyBounds[0] = polyBounds[1] = FLT_MAX;
+            polyBounds[2] = polyBounds[3] = -FLT_MAX;
+
+            float verts[DT_VERTS_PER_POLYGON * 3];
+
+            for (int v = 0; v < poly->vertCount; ++v)
+            {
+                const float* vert = &tile->verts[poly->verts[v] * 3];
+                dtVcopy(&verts[v * 3], vert);
+                polyBounds[0] = dtMin(polyBounds[0], vert[0]);
+                polyBounds[1] = dtMin(polyBounds[1], vert[2]);
+                polyBounds[2] = dtMax(polyBounds[2], vert[0]);
+                polyBounds[3] = dtMax(polyBounds[3], vert[2]);
+            }
+
+            Areas[i] = GetPolyArea(verts, poly->vertCount);
+
+            min[0] = dtMin(min[0], polyBounds[0]);
+            min[1] = dtMin(min[1], polyBounds[1]);
+            max[0] = dtMax(max[0], polyBounds[2]);
+            max[1] = dtMax(max[1], polyBounds[3]);
+        }
+
+        if (min[0] > max[0])
+            return false;
+
+        Origin[0] = min[0];
+        Origin[1] = min[1];
+        Width = static_cast<int>((max[0] - min[0]) / RANDOM_POINT_CELL_SIZE) + 1;
+        Height = static_cast<int>((max[1] - min[1]) / RANDOM_POINT_CELL_SIZE) + 1;
+        // clip every poly to the cells its bounds overlap, polys that only touch a cell with their bounds
+        // are left out
+        std::vector<std::vector<std::pair<int, float>>> cells(static_cast<size_t>(Width) * Height);
+
+        for (int i = 0; i < polyCount; ++i)
+        {
+            if (Areas[i] <= 0.0f)
+                continue;
+
+            const dtMeshTile* tile = nullptr;
+            const dtPoly* poly = nullptr;
+            NavMesh->getTileAndPolyByRefUnsafe(Refs[i], &tile, &poly);
+
+            float verts[DT_VERTS_PER_POLYGON * 3];
+            float clipped[RANDOM_POINT_MAX_CLIP_VERTS * 3];
+
+            for (int v = 0; v < poly->vertCount; ++v)
+                dtVcopy(&verts[v * 3], &tile->verts[poly->verts[v] * 3]);
+
+            const float* polyBounds = &bounds[i * 4];
+
+            for (int z = ToCell(polyBounds[1], Origin[1], Height); z <= ToCell(polyBounds[3], Origin[1], Height); ++z)
+            {
+                for (int x = ToCell(polyBounds[0], Origin[0], Width); x <= ToCell(polyBounds[2], Origin[0], Width); ++x)
+                {
+                    const int clippedCount = ClipToCell(verts, poly->vertCount, z * Width + x, clipped);
+                    const float area = GetPolyArea(clipped, clippedCount);
+
+                    if (area > 0.0f)
+                        cells[z * Width + x].emplace_back(i, area);
+                }
+            }
+        }
+
+        CellStarts.assign(cells.size() + 1, 0);
+
+        for (size_t c = 0; c < cells.size(); ++c)
+        {
+            CellStarts[c + 1] = CellStarts[c] + static_cast<unsigned int>(cells[c].size());
+
+            for (const auto& [polyIndex, area] : cells[c])
+            {
+                CellPolys.push_back(polyIndex);
+                CellPolyAreas.push_back(area);
+            }
+        }
+
+        Ready.store(true, std::memory_order_release);
+        return true;
+    }
+
+    /// Random point on the polys passing the flags of the filter, uniformly distributed over their area.
+    /// Fails if the flags match nothing or the tiles got replaced since Build().
+    bool GetRandomPoint(const dtQueryFilter* filter, float (*frand)(), dtPolyRef* randomRef, float* randomPt) const
+    {
+        const std::shared_ptr<const FlagTable> table = GetFlagTable(filter);
+
+        if (table->TotalArea <= 0.0)
+            return false;
+
+        for (int attempt = 0; attempt < RANDOM_POINT_MAX_ATTEMPTS; ++attempt)
+        {
+            const int cell = Sample(table->Cells.data(), GetCellCount(), frand);
+
+            if (table->CellAreas[cell] > 0.0f
+                && SampleCell(*table, cell, [](int) { return true; }, frand, randomRef, randomPt))
+            {
+                return true;
+            }
+        }
+
+        return false;
+    }
+
+    /// Random point on the polys findRandomPointAroundCircle would pick from, the ones reached from startRef
+    /// through portals within radius (2D) of center. Unlike findRandomPointAroundCircle the point always lies
+    /// inside of the circle and is uniformly distributed over the reached area inside of it. Fails for
+    /// circles that are too small or too large for the grid or reach too many polys, or if no sample hit the
+    /// reached part of the circle.
+    bool GetRandomPointAroundCircle(dtPolyRef startRef, const float* center, float radius,
+                                    const dtQueryFilter* filter, float (*frand)(), dtPolyRef* randomRef,
+                                    float* randomPt) const
+    {
+        if (radius < RANDOM_POINT_MIN_CIRCLE_RADIUS)
+            return false;
+
+        const int x0 = ToCell(center[0] - radius, Origin[0], Width);
+        const int x1 = ToCell(center[0] + radius, Origin[0], Width);
+        const int z0 = ToCell(center[2] - radius, Origin[1], Height);
+        const int z1 = ToCell(center[2] + radius, Origin[1], Height);
+
+        if ((x1 - x0 + 1) * (z1 - z0 + 1) > RANDOM_POINT_MAX_CIRCLE_CELLS)
+            return false;
+
+        const int start = Indexer.Get(startRef);
+        const std::shared_ptr<const FlagTable> table = GetFlagTable(filter);
+
+        if (start < 0 || start >= static_cast<int>(table->Passes.size()) || !table->Passes[start]
+            || Refs[start] != startRef)
+        {
+            return false;
+        }
+
+        // stamped with the visit of the current call, so they need no clearing between calls
+        thread_local std::vector<uint32_t> reached;
+        thread_local uint32_t visit = 0;
+
+        if (!CollectCirclePolys(*table, start, center, radius, reached, visit))
+            return false;
+
+        const auto isReached = [](int polyIndex) { return reached[polyIndex] == visit; };
+
+        // cells in the bounds of the circle, drawn by a cumulative distribution
+        thread_local std::vector<std::pair<float, int>> cells;
+        cells.clear();
+        float total = 0.0f;
+
+        for (int z = z0; z <= z1; ++z)
+        {
+            for (int x = x0; x <= x1; ++x)
+            {
+                const int cell = z * Width + x;
+
+                if (table->CellAreas[cell] > 0.0f)
+                {
+                    total += table->CellAreas[cell];
+                    cells.emplace_back(total, cell);
+                }
+            }
+        }
+
+        if (cells.empty())
+            return false;
+
+        for (int attempt = 0; attempt < RANDOM_POINT_MAX_ATTEMPTS; ++attempt)
+        {
+            const float value = frand() * total;
+            const auto it = std::upper_bound(cells.begin(), cells.end(), value,
+                                             [](float v, const std::pair<float, int>& c) { return v < c.first; });
+            const int cell = it != cells.end() ? it->second : cells.back().second;
+
+            if (SampleCell(*table, cell, isReached, frand, randomRef, randomPt)
+                && dtVdist2DSqr(center, randomPt) <= dtSqr(radius))
+            {
+                return true;
+            }
+        }
+
+        return false;
+    }
+
+private:
+    static inline int ToCell(float value, float origin, int side) noexcept
+    {
+        return std::clamp(static_cast<int>(std::floor((value - origin) / RANDOM_POINT_CELL_SIZE)), 0, side - 1);
+    }
+
+    /// Area of a convex poly in x/z, the same triangle fan as findRandomPoint uses.
+    static inline float GetPolyArea(const float* verts, int count) noexcept
+    {
+        float area = 0.0f;
+
+        for (int v = 2; v < count; ++v)
+            area += dtTriArea2D(verts, &verts[(v - 1) * 3], &verts[v * 3]);
+
+        return area;
+    }
+
+    /// Clip a convex poly to the x/z bounds of a cell, out needs room for RANDOM_POINT_MAX_CLIP_VERTS.
+    int ClipToCell(const float* verts, int count, int cell, float* out) const noexcept
+    {
+        const float minX = Origin[0] + (cell % Width) * RANDOM_POINT_CELL_SIZE;
+        const float minZ = Origin[1] + (cell / Width) * RANDOM_POINT_CELL_SIZE;
+        float buffer[RANDOM_POINT_MAX_CLIP_VERTS * 3];
+
+        count = ClipAxis(verts, count, buffer, 0, minX, 1.0f);
+        count = ClipAxis(buffer, count, out, 0, minX + RANDOM_POINT_CELL_SIZE, -1.0f);
+        count = ClipAxis(out, count, buffer, 2, minZ, 1.0f);
+        count = ClipAxis(buffer, count, out, 2, minZ + RANDOM_POINT_CELL_SIZE, -1.0f);
+        return count;
+    }
+
+    /// One Sutherland-Hodgman step, keeps the part where (v[axis] - value) * side >= 0.
+    static inline int ClipAxis(const float* in, int count, float* out, int axis, float value, float side) noexcept
+    {
+        int result = 0;
+
+        for (int i = 0, j = count - 1; i < count; j = i++)
+        {
+            const float* a = &in[j * 3];
+            const float* b = &in[i * 3];
+            const float da = (a[axis] - value) * side;
+            const float db = (b[axis] - value) * side;
+
+            if ((da >= 0.0f) != (db >= 0.0f))
+                dtVlerp(&out[result++ * 3], a, b, da / (da - db));
+
+            if (db >= 0.0f)
+                dtVcopy(&out[result++ * 3], b);
+        }
+
+        return result;
+    }
+
+    static inline int Sample(const AliasSlot* slots, int count, float (*frand)()) noexcept
+    {
+        const int i = dtMin(static_cast<int>(frand() * count), count - 1);
+        return frand() < slots[i].Probability ? i : static_cast<int>(slots[i].Alias);
+    }
+
+    /// Mark the polys reachable from start through portals within radius (2D) of center in reached, the
+    /// same expansion findRandomPointAroundCircle does. False if there are more than
+    /// RANDOM_POINT_MAX_CIRCLE_POLYS of them.
+    bool CollectCirclePolys(const FlagTable& table, int start, const float* center, float radius,
+                            std::vector<uint32_t>& reached, uint32_t& visit) const
+    {
+        const int polyCount = static_cast<int>(table.Passes.size());
+
+        if (static_cast<int>(reached.size()) < polyCount)
+            reached.resize(polyCount, 0);
+
+        // once the counter wraps around, stamps of earlier calls could match again
+        if (++visit == 0)
+        {
+            std::fill(reached.begin(), reached.end(), 0);
+            visit = 1;
+        }
+
+        thread_local std::vector<int> stack;
+        stack.clear();
+        stack.push_back(start);
+        reached[start] = visit;
+        int reachedCount = 1;
+
+        const float radiusSqr = dtSqr(radius);
+
+        while (!stack.empty())
+        {
+            const int current = stack.back();
+            stack.pop_back();
+
+            const dtMeshTile* tile = nullptr;
+            const dtPoly* poly = nullptr;
+
+            if (dtStatusFailed(NavMesh->getTileAndPolyByRef(Refs[current], &tile, &poly)))
+                continue;
+
+            for (unsigned int l = poly->firstLink; l != DT_NULL_LINK; l = tile->links[l].next)
+            {
+                const dtLink& link = tile->links[l];
+                const int neighbour = link.ref ? Indexer.Get(link.ref) : -1;
+
+                if (neighbour < 0 || neighbour >= polyCount || !table.Passes[neighbour]
+                    || reached[neighbour] == visit)
+                {
+                    continue;
+                }
+
+                float portalA[3];
+                float portalB[3];
+                float t = 0.0f;
+
+                if (!GetPortal(tile, poly, link, Refs[current], portalA, portalB)
+                    || dtDistancePtSegSqr2D(center, portalA, portalB, t) > radiusSqr)
+                {
+                    continue;
+                }
+
+                if (++reachedCount > RANDOM_POINT_MAX_CIRCLE_POLYS)
+                    return false;
+
+                reached[neighbour] = visit;
+                stack.push_back(neighbour);
+            }
+        }
+
+        return true;
+    }
+
+    /// Edge of a poly a link leaves through, the connection point for off-mesh connections.
+    bool GetPortal(const dtMeshTile* tile, const dtPoly* poly, const dtLink& link, dtPolyRef ref, float* a,
+                   float* b) const noexcept
+    {
+        if (poly->getType() == DT_POLYTYPE_OFFMESH_CONNECTION)
+        {
+            // the edge of an off-mesh connection is the index of the vertex the link is attached to
+            if (link.edge >= poly->vertCount)
+                return false;
+
+            dtVcopy(a, &tile->verts[poly->verts[link.edge] * 3]);
+            dtVcopy(b, a);
+            return true;
+        }
+
+        if (link.edge < poly->vertCount)
+        {
+            dtVcopy(a, &tile->verts[poly->verts[link.edge] * 3]);
+            dtVcopy(b, &tile->verts[poly->verts[(link.edge + 1) % poly->vertCount] * 3]);
+            return true;
+        }
+
+        // links into an off-mesh connection carry no edge, its vertex that links back to the poly is the portal
+        const dtMeshTile* connectionTile = nullptr;
+        const dtPoly* connection = nullptr;
+
+        if (dtStatusFailed(NavMesh->getTileAndPolyByRef(link.ref, &connectionTile, &connection)))
+            return false;
+
+        for (unsigned int l = connection->firstLink; l != DT_NULL_LINK; l = connectionTile->links[l].next)
+        {
+            const dtLink& back = connectionTile->links[l];
+
+            if (back.ref == ref && back.edge < connection->vertCount)
+            {
+                dtVcopy(a, &connectionTile->verts[connection->verts[back.edge] * 3]);
+                dtVcopy(b, a);
+                return true;
+            }
+        }
+
+        return false;
+    }
+
+    /// Draw a poly of the cell and a point in the part of it inside of the cell. Fails if accept rejects the
+    /// dense index of the poly or if its tile got replaced.
+    template<typename Accept>
+    bool SampleCell(const FlagTable& table, int cell, Accept&& accept, float (*frand)(), dtPolyRef* randomRef,
+                    float* randomPt) const noexcept
+    {
+        const unsigned int first = CellStarts[cell];
+        const int count = static_cast<int>(CellStarts[cell + 1] - first);
+        const int polyIndex = CellPolys[first + Sample(&table.CellPolys[first], count, frand)];
+
+        // filtered polys only come up through rounding errors of the alias table
+        if (!table.Passes[polyIndex] || !accept(polyIndex))
+            return false;
+
+        const dtMeshTile* tile = nullptr;
+        const dtPoly* poly = nullptr;
+
+        if (dtStatusFailed(NavMesh->getTileAndPolyByRef(Refs[polyIndex], &tile, &poly)))
+            return false;
+
+        float verts[DT_VERTS_PER_POLYGON * 3];
+        float clipped[RANDOM_POINT_MAX_CLIP_VERTS * 3];
+        float areas[RANDOM_POINT_MAX_CLIP_VERTS];
+
+        for (int v = 0; v < poly->vertCount; ++v)
+            dtVcopy(&verts[v * 3], &tile->verts[poly->verts[v] * 3]);
+
+        const int clippedCount = ClipToCell(verts, poly->vertCount, cell, clipped);
+
+        if (clippedCount < 3)
+            return false;
+
+        const float s = frand();
+        const float t = frand();
+        float pt[3];
+        dtRandomPointInConvexPoly(clipped, clippedCount, areas, s, t, pt);
+
+        float height = pt[1];
+        NavMesh->getPolyHeight(tile, poly, pt, &height);
+        pt[1] = height;
+
+        dtVcopy(randomPt, pt);
+        *randomRef = Refs[polyIndex];
+        return true;
+    }
+
+    /// Tables of the flags of a filter, built on first use.
+    std::shared_ptr<const FlagTable> GetFlagTable(const dtQueryFilter* filter) const
+    {
+        const uint32_t flags = static_cast<uint32_t>(filter->getIncludeFlags())
+            | static_cast<uint32_t>(filter->getExcludeFlags()) << 16;
+
+        {
+            std::lock_guard lock(TableMutex);
+            auto it = Tables.find(flags);
+
+            if (it != Tables.end())
+                return it->second;
+        }
+
+        std::shared_ptr<const FlagTable> table = BuildFlagTable(filter);
+        std::lock_guard lock(TableMutex);
+
+        // queries still holding a table keep it alive until they are done
+        if (Tables.size() >= RANDOM_POINT_MAX_FLAG_SETS)
+            Tables.clear();
+
+        // another query may have been faster
+        return Tables.emplace(flags, std::move(table)).first->second;
+    }
+
+    std::shared_ptr<const FlagTable> BuildFlagTable(const dtQueryFilter* filter) const
+    {
+        const int polyCount = Indexer.GetPolyCount();
+        auto table = std::make_shared<FlagTable>();
+        table->Passes.assign(polyCount, false);
+
+        for (int i = 0; i < polyCount; ++i)
+        {
+            const dtMeshTile* tile = nullptr;
+            const dtPoly* poly = nullptr;
+
+            // tiles replaced since Build() are left out
+            if (dtStatusSucceed(NavMesh->getTileAndPolyByRef(Refs[i], &tile, &poly)) && PolyGraph::PassFilter(filter, poly))
+                table->Passes[i] = true;
+        }
+
+        const int cellCount = GetCellCount();
+        table->CellAreas.assign(cellCount, 0.0f);
+        table->CellPolys.resize(CellPolys.size());
+
+        std::vector<float> cellWeights;
+
+        for (int c = 0; c < cellCount; ++c)
+        {
+            const unsigned int first = CellStarts[c];
+            const int count = static_cast<int>(CellStarts[c + 1] - first);
+            cellWeights.resize(count);
+
+            for (int i = 0; i < count; ++i)
+            {
+                cellWeights[i] = table->Passes[CellPolys[first + i]] ? CellPolyAreas[first + i] : 0.0f;
+                table->CellAreas[c] += cellWeights[i];
+            }
+
+            BuildAlias(cellWeights.data(), count, &table->CellPolys[first]);
+            table->TotalArea += table->CellAreas[c];
+        }
+
+        table->Cells.resize(cellCount);
+        BuildAlias(table->CellAreas.data(), cellCount, table->Cells.data());
+        return table;
+    }
+
+    /// Vose's alias method, slots with zero weight are never drawn.
+    static void BuildAlias(const float* weights, int count, AliasSlot* slots)
+    {
+        double total = 0.0;
+
+        for (int i = 0; i < count; ++i)
+            total += weights[i];
+
+        if (total <= 0.0)
+        {
+            for (int i = 0; i < count; ++i)
+                slots[i] = AliasSlot{ 1.0f, static_cast<unsigned int>(i) };
+
+            return;
+        }
+
+        std::vector<double> scaled(count);
+        std::vector<int> small;
+        std::vector<int> large;
+
+        for (int i = 0; i < count; ++i)
+        {
+            scaled[i] = weights[i] * count / total;
+            (scaled[i] < 1.0 ? small : large).push_back(i);
+        }
+
+        while (!small.empty() && !large.empty())
+        {
+            const int s = small.back();
+            const int l = large.back();
+            small.pop_back();
+
+            slots[s] = AliasSlot{ static_cast<float>(scaled[s]), static_cast<unsigned int>(l) };
+            scaled[l] -= 1.0 - scaled[s];
+
+            if (scaled[l] < 1.0)
+            {
+                large.pop_back();
+                small.push_back(l);
+            }
+        }
+
+        // leftovers are 1 up to rounding errors
+        for (const int i : large)
+            slots[i] = AliasSlot{ 1.0f, static_cast<unsigned int>(i) };
+
+        for (const int i : small)
+            slots[i] = AliasSlot{ weights[i] > 0.0f ? 1.0f : 0.0f, static_cast<unsigned int>(i) };
+    }
+};
@@ -0,0 +1,660 @@
+#pragma once
+
+#include <algorithm>
+#include <atomic>
+#include <cstdint>
+#include <cstdlib>
+#include <functional>
+#include <limits>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <queue>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+#include "../../../recastnavigation/Detour/Include/DetourCommon.h"
+#include "../../../recastnavigation/Detour/Include/DetourNavMesh.h"
+#include "../../../recastnavigation/Detour/Include/DetourNavMeshQuery.h"
+
+#include "../Search/PolyGraph.hpp"
+#include "../Search/PolySearch.hpp"
+
+/// Routes whose start and end tile are closer than this (in tiles) are searched directly, the abstract
+/// search would not save anything there.
+constexpr int TILE_GRAPH_MIN_TILE_DISTANCE = 3;
+
+/// Tiles around the abstract route that are added to the corridor, gives the poly search room to cut corners.
+constexpr int TILE_GRAPH_CORRIDOR_MARGIN = 1;
+
+/// Number of filter classes whose intra tile costs are cached, the cache is reset when more show up.
+constexpr size_t TILE_GRAPH_MAX_FILTER_CLASSES = 16;
+
+/// <summary>
+/// Abstract graph for hierarchical (two level) pathfinding.
+///
+/// Every tile is split into portal clusters: the polys of a tile that are connected inside of the tile and
+/// link into the same neighbour tile form one node. Nodes of neighbouring tiles that share links are
+/// connected by cross edges, nodes of the same tile by intra edges carrying the cost of the cheapest route
+/// through the tile. Intra costs depend on the area costs, they are computed lazily per tile and cached per
+/// filter class (see PolyGraph::GetFilterSignature).
+///
+/// A route is planned on this graph first, the tiles it passes form a corridor that the poly level search
+/// is restricted to.
+/// </summary>
+class TileGraph
+{
+    struct Node
+    {
+        int Tile;       // tile index in the navmesh
+        int Neighbour;  // tile index the portals lead into
+        float Pos[3];   // average of the portal midpoints
+        int FirstPoly;  // range in NodePolys
+        int PolyCount;
+        int FirstCross; // range in CrossEdges
+        int CrossCount;
+    };
+
+    struct CrossEdge
+    {
+        int To;
+        float Distance;
+    };
+
+    /// Costs between the nodes of one tile for one filter class, [from * nodeCount + to].
+    using TileCosts = std::vector<float>;
+
+    /// Intra edge costs of every tile for one filter class. Tiles are published once and never replaced, so
+    /// readers only need an atomic load while they hold a reference to the class.
+    struct FilterCosts
+    {
+        std::unique_ptr<std::atomic<const TileCosts*>[]> Tiles;
+        std::mutex Mutex;
+        std::vector<std::unique_ptr<const TileCosts>> Owned;
+
+        FilterCosts(int maxTiles)
+            : Tiles(std::make_unique<std::atomic<const TileCosts*>[]>(maxTiles)),
+            Mutex(),
+            Owned()
+        {}
+    };
+    struct Visit
+    {
+        float Cost = 0.0f;
+        int Parent = -1;
+        unsigned int Stamp = 0;
+        bool Closed = false;
+    };
+
+    using OpenEntry = std::pair<float, int>;
+    using OpenQueue = std::priority_queue<OpenEntry, std::vector<OpenEntry>, std::greater<OpenEntry>>;
+
+    const dtNavMesh* NavMesh;
+    PolyGraph::PolyIndexer Indexer;
+    std::vector<float> Centers;        // poly centers by dense index
+    std::vector<Node> Nodes;
+    std::vector<int> TileNodes;        // first node of every tile, TileNodes[tile + 1] is the end
+    std::vector<int> NodePolys;        // dense indices of the polys that belong to a node
+    std::vector<CrossEdge> CrossEdges;
+    std::atomic<bool> Ready;
+
+    mutable std::mutex CostMutex;
+    mutable std::unordered_map<uint64_t, std::shared_ptr<FilterCosts>> Costs;
+
+public:
+    TileGraph(const dtNavMesh* navMesh) noexcept
+        : NavMesh(navMesh),
+        Indexer(),
+        Centers(),
+        Nodes(),
+        TileNodes(),
+        NodePolys(),
+        CrossEdges(),
+        Ready(false),
+        CostMutex(),
+        Costs()
+    {}
+
+    TileGraph(const TileGraph&) = delete;
+    TileGraph& operator=(const TileGraph&) = delete;
+
+    constexpr inline const dtNavMesh* GetNavMesh() const noexcept { return NavMesh; }
+    inline bool IsReady() const noexcept { return Ready.load(std::memory_order_acquire); }
+    inline int GetNodeCount() const noexcept { return static_cast<int>(Nodes.size()); }
+
+    inline size_t GetMemoryUsage() const noexcept
+    {
+        return Centers.size() * sizeof(float) + Nodes.size() * sizeof(Node) + TileNodes.size() * sizeof(int)
+            + NodePolys.size() * sizeof(int) + CrossEdges.size() * sizeof(CrossEdge);
+    }
+
+    /// Distance between the tiles of two polys in tiles (chebyshev), used to decide whether a route is long
+    /// enough for the abstract search.
+    inline int GetTileDistance(dtPolyRef a, dtPolyRef b) const noexcept
+    {
+        const dtMeshTile* tileA = NavMesh->getTileByRef(a);
+        const dtMeshTile* tileB = NavMesh->getTileByRef(b);
+
+        if (!tileA || !tileB || !tileA->header || !tileB->header)
+            return 0;
+
+        return dtMax(std::abs(tileA->header->x - tileB->header->x), std::abs(tileA->header->y - tileB->header->y));
+    }
+
+    /// Build the filter independent part of the graph: nodes and cross edges.
+    bool Build()
+    {
+        Indexer.Build(NavMesh);
+        const int polyCount = Indexer.GetPolyCount();
+
+        if (polyCount == 0)
+            return false;
+
+        const int maxTiles = NavMesh->getMaxTiles();
+        const std::vector<dtPolyRef> refs = Indexer.BuildRefs();
+        Centers.resize(static_cast<size_t>(polyCount) * 3);
+
+        for (int i = 0; i < polyCount; ++i)
+        {
+            const dtMeshTile* tile = nullptr;
+            const dtPoly* poly = nullptr;
+            NavMesh->getTileAndPolyByRefUnsafe(refs[i], &tile, &poly);
+            PolyGraph::GetPolyCenter(tile, poly, &Centers[i * 3]);
+        }
+
+        // (dense poly index, neighbour tile) -> node, used to connect the nodes of neighbouring tiles
+        std::unordered_map<uint64_t, int> polyNodes;
+        std::vector<std::vector<int>> members;
+        std::vector<int> component;
+        std::vector<int> stack;
+
+        TileNodes.assign(maxTiles + 1, 0);
+
+        for (int t = 0; t < maxTiles; ++t)
+        {
+            TileNodes[t] = static_cast<int>(Nodes.size());
+            const dtMeshTile* tile = NavMesh->getTile(t);
+
+            if (!tile || !tile->header)
+                continue;
+
+            const int offset = Indexer.GetTileOffset(t);
+            const int count = tile->header->polyCount;
+            LabelComponents(tile, static_cast<unsigned int>(t), component, stack);
+            std::map<std::pair<int, int>, int> nodeOf; // (neighbour tile, component) -> node
+            members.clear();
+
+            for (int p = 0; p < count; ++p)
+            {
+                const dtPoly* poly = &tile->polys[p];
+
+                for (unsigned int i = poly->firstLink; i != DT_NULL_LINK; i = tile->links[i].next)
+                {
+                    const dtPolyRef ref = tile->links[i].ref;
+                    const int neighbourTile = ref ? static_cast<int>(NavMesh->decodePolyIdTile(ref)) : t;
+
+                    if (neighbourTile == t)
+                        continue;
+
+                    auto [it, inserted] = nodeOf.try_emplace({ neighbourTile, component[p] },
+                                                             static_cast<int>(Nodes.size()));
+
+                    if (inserted)
+                    {
+                        Nodes.push_back(Node{ t, neighbourTile, { 0.0f, 0.0f, 0.0f }, 0, 0, 0, 0 });
+                        members.emplace_back();
+                    }
+
+                    Node& node = Nodes[it->second];
+                    std::vector<int>& nodeMembers = members[it->second - TileNodes[t]];
+
+                    if (nodeMembers.empty() || nodeMembers.back() != offset + p)
+                    {
+                        nodeMembers.push_back(offset + p);
+                        polyNodes[Key(offset + p, neighbourTile, maxTiles)] = it->second;
+                    }
+
+                    const dtMeshTile* neighbourTilePtr = nullptr;
+                    const dtPoly* neighbourPoly = nullptr;
+                    NavMesh->getTileAndPolyByRefUnsafe(ref, &neighbourTilePtr, &neighbourPoly);
+
+                    float mid[3];
+
+                    if (PolyGraph::GetEdgeMidPoint(refs[offset + p], poly, tile, ref, neighbourPoly, neighbourTilePtr, mid))
+                    {
+                        // summed up here, averaged below
+                        dtVadd(node.Pos, node.Pos, mid);
+                        ++node.CrossCount;
+                    }
+                }
+            }
+
+            for (int n = TileNodes[t]; n < static_cast<int>(Nodes.size()); ++n)
+            {
+                Node& node = Nodes[n];
+                const std::vector<int>& nodeMembers = members[n - TileNodes[t]];
+
+                if (node.CrossCount > 0)
+                    dtVscale(node.Pos, node.Pos, 1.0f / static_cast<float>(node.CrossCount));
+                else
+                    dtVcopy(node.Pos, &Centers[nodeMembers.front() * 3]);
+
+                node.CrossCount = 0;
+                node.FirstPoly = static_cast<int>(NodePolys.size());
+                node.PolyCount = static_cast<int>(nodeMembers.size());
+                NodePolys.insert(NodePolys.end(), nodeMembers.begin(), nodeMembers.end());
+            }
+        }
+
+        TileNodes[maxTiles] = static_cast<int>(Nodes.size());
+
+        for (int n = 0; n < static_cast<int>(Nodes.size()); ++n)
+        {
+            Node& node = Nodes[n];
+            node.FirstCross = static_cast<int>(CrossEdges.size());
+
+            for (int m = node.FirstPoly; m < node.FirstPoly + node.PolyCount; ++m)
+            {
+                const dtMeshTile* tile = nullptr;
+                const dtPoly* poly = nullptr;
+                NavMesh->getTileAndPolyByRefUnsafe(refs[NodePolys[m]], &tile, &poly);
+
+                for (unsigned int i = poly->firstLink; i != DT_NULL_LINK; i = tile->links[i].next)
+                {
+                    const dtPolyRef ref = tile->links[i].ref;
+
+                    if (!ref || static_cast<int>(NavMesh->decodePolyIdTile(ref)) != node.Neighbour)
+                        continue;
+
+                    const int neighbourIndex = Indexer.Get(ref);
+                    const auto it = neighbourIndex >= 0 ? polyNodes.find(Key(neighbourIndex, node.Tile, maxTiles))
+                                                        : polyNodes.end();
+
+                    if (it == polyNodes.end())
+                        continue;
+
+                    const auto begin = CrossEdges.begin() + node.FirstCross;
+                    const int to = it->second;
+
+                    if (std::find_if(begin, CrossEdges.end(), [to](const CrossEdge& e) { return e.To == to; }) == CrossEdges.end())
+                        CrossEdges.push_back(CrossEdge{ to, dtVdist(node.Pos, Nodes[to].Pos) });
+                }
+            }
+
+            node.CrossCount = static_cast<int>(CrossEdges.size()) - node.FirstCross;
+        }
+
+        Ready.store(true, std::memory_order_release);
+        return true;
+    }
+
+    /// Plan a route on the abstract graph and return the sorted indices of the tiles it passes. Returns
+    /// false if no route exists, in that case the poly level search should run unrestricted.
+    bool FindCorridorTiles(dtPolyRef startRef, dtPolyRef endRef, const float* startPos, const float* endPos,
+                           const dtQueryFilter* filter, std::vector<unsigned int>& tiles, int* expandedNodes) const
+    {
+        tiles.clear();
+
+        if (expandedNodes)
+            *expandedNodes = 0;
+
+        const int startTile = static_cast<int>(NavMesh->decodePolyIdTile(startRef));
+        const int endTile = static_cast<int>(NavMesh->decodePolyIdTile(endRef));
+
+        if (!IsReady() || Indexer.GetTileOffset(startTile) < 0 || Indexer.GetTileOffset(endTile) < 0)
+            return false;
+
+        const std::shared_ptr<FilterCosts> filterCosts = GetFilterCosts(PolyGraph::GetFilterSignature(filter));
+        const float minCost = PolyGraph::GetMinAreaCost(filter);
+
+        // costs from the start and to the end point to the nodes of their tiles
+        std::vector<float> startCosts;
+        std::vector<float> endCosts;
+        GetPointCosts(startTile, startRef, startPos, filter, startCosts);
+        GetPointCosts(endTile, endRef, endPos, filter, endCosts);
+
+        const int startId = static_cast<int>(Nodes.size());
+        const int endId = startId + 1;
+
+        // per thread scratch, entries are valid if their stamp matches the current search
+        thread_local std::vector<Visit> visits;
+        thread_local unsigned int generation = 0;
+
+        if (visits.size() < Nodes.size() + 2)
+            visits.resize(Nodes.size() + 2);
+
+        if (++generation == 0)
+        {
+            std::fill(visits.begin(), visits.end(), Visit{});
+            generation = 1;
+        }
+
+        OpenQueue open;
+
+        const auto heuristic = [&](int id) noexcept
+        {
+            const float* pos = id == startId ? startPos : id == endId ? endPos : Nodes[id].Pos;
+            return dtVdist(pos, endPos) * minCost * POLY_SEARCH_H_SCALE;
+        };
+
+        const auto relax = [&](int from, float fromCost, int to, float edgeCost)
+        {
+            if (edgeCost == std::numeric_limits<float>::max())
+                return;
+
+            const float cost = fromCost + edgeCost;
+            Visit& visit = visits[to];
+
+            if (visit.Stamp == generation && (visit.Closed || cost >= visit.Cost))
+                return;
+
+            visit = Visit{ cost, from, generation, false };
+            open.emplace(cost + heuristic(to), to);
+        };
+
+        visits[startId] = Visit{ 0.0f, -1, generation, false };
+        open.emplace(heuristic(startId), startId);
+        bool found = false;
+
+        while (!open.empty())
+        {
+            const int id = open.top().second;
+            open.pop();
+
+            if (visits[id].Closed)
+                continue;
+
+            visits[id].Closed = true;
+            const float cost = visits[id].Cost;
+
+            if (expandedNodes)
+                ++*expandedNodes;
+
+            if (id == endId)
+            {
+                found = true;
+                break;
+            }
+
+            if (id == startId)
+            {
+                for (int i = 0; i < static_cast<int>(startCosts.size()); ++i)
+                {
+                    relax(id, cost, TileNodes[startTile] + i, startCosts[i]);
+                }
+
+                continue;
+            }
+
+            const Node& node = Nodes[id];
+            const int first = TileNodes[node.Tile];
+            const int count = TileNodes[node.Tile + 1] - first;
+            const int local = id - first;
+            const TileCosts* tileCosts = GetTileCosts(*filterCosts, node.Tile, filter);
+
+            for (int j = 0; j < count; ++j)
+            {
+                if (j != local)
+                    relax(id, cost, first + j, (*tileCosts)[local * count + j]);
+            }
+
+            for (int e = node.FirstCross; e < node.FirstCross + node.CrossCount; ++e)
+            {
+                relax(id, cost, CrossEdges[e].To, CrossEdges[e].Distance * minCost);
+            }
+
+            if (node.Tile == endTile)
+            {
+                relax(id, cost, endId, endCosts[local]);
+            }
+        }
+
+        if (!found)
+            return false;
+
+        tiles.push_back(static_cast<unsigned int>(startTile));
+        tiles.push_back(static_cast<unsigned int>(endTile));
+
+        for (int id = visits[endId].Parent; id >= 0 && id != startId; id = visits[id].Parent)
+        {
+            tiles.push_back(static_cast<unsigned int>(Nodes[id].Tile));
+        }
+
+        const size_t routeTiles = tiles.size();
+
+        for (size_t i = 0; i < routeTiles; ++i)
+        {
+            const dtMeshHeader* header = NavMesh->getTile(tiles[i])->header;
+
+            for (int y = header->y - TILE_GRAPH_CORRIDOR_MARGIN; y <= header->y + TILE_GRAPH_CORRIDOR_MARGIN; ++y)
+            {
+                for (int x = header->x - TILE_GRAPH_CORRIDOR_MARGIN; x <= header->x + TILE_GRAPH_CORRIDOR_MARGIN; ++x)
+                {
+                    const dtMeshTile* neighbours[4];
+                    const int count = NavMesh->getTilesAt(x, y, neighbours, 4);
+
+                    for (int n = 0; n < count; ++n)
+                    {
+                        tiles.push_back(NavMesh->decodePolyIdTile(NavMesh->getTileRef(neighbours[n])));
+                    }
+                }
+            }
+        }
+
+        std::sort(tiles.begin(), tiles.end());
+        tiles.erase(std::unique(tiles.begin(), tiles.end()), tiles.end());
+        return true;
+    }
+
+private:
+    static constexpr inline uint64_t Key(int polyIndex, int tile, int maxTiles) noexcept
+    {
+        return static_cast<uint64_t>(polyIndex) * static_cast<uint64_t>(maxTiles) + static_cast<uint64_t>(tile);
+    }
+
+    /// Label the polys of a tile by the component they belong to when only links inside of the tile are used.
+    void LabelComponents(const dtMeshTile* tile, unsigned int tileIndex, std::vector<int>& component,
+                        std::vector<int>& stack) const
+    {
+        const int count = tile->header->polyCount;
+        component.assign(count, -1);
+        int componentCount = 0;
+
+        for (int p = 0; p < count; ++p)
+        {
+            if (component[p] >= 0)
+                continue;
+
+            component[p] = componentCount;
+            stack.push_back(p);
+
+            while (!stack.empty())
+            {
+                const dtPoly* poly = &tile->polys[stack.back()];
+                stack.pop_back();
+
+                for (unsigned int i = poly->firstLink; i != DT_NULL_LINK; i = tile->links[i].next)
+                {
+                    const dtPolyRef ref = tile->links[i].ref;
+
+                    if (!ref || NavMesh->decodePolyIdTile(ref) != tileIndex)
+                        continue;
+
+                    const int neighbour = static_cast<int>(NavMesh->decodePolyIdPoly(ref));
+
+                    if (component[neighbour] < 0)
+                    {
+                        component[neighbour] = componentCount;
+                        stack.push_back(neighbour);
+                    }
+                }
+            }
+
+            ++componentCount;
+        }
+    }
+
+    /// Dijkstra restricted to one tile, dist is indexed by the poly index inside of the tile and has to be
+    /// seeded together with the open queue. Costs are measured between poly centers.
+    void TileDijkstra(int tileIndex, const dtQueryFilter* filter, std::vector<float>& dist, OpenQueue& open) const
+    {
+        const dtMeshTile* tile = NavMesh->getTile(tileIndex);
+        const int offset = Indexer.GetTileOffset(tileIndex);
+
+        while (!open.empty())
+        {
+            const auto [d, p] = open.top();
+            open.pop();
+
+            if (d > dist[p])
+                continue;
+
+            const dtPoly* poly = &tile->polys[p];
+            const float areaCost = filter->getAreaCost(poly->getArea());
+
+            for (unsigned int i = poly->firstLink; i != DT_NULL_LINK; i = tile->links[i].next)
+            {
+                const dtPolyRef ref = tile->links[i].ref;
+
+                if (!ref || static_cast<int>(NavMesh->decodePolyIdTile(ref)) != tileIndex)
+                    continue;
+
+                const int q = static_cast<int>(NavMesh->decodePolyIdPoly(ref));
+
+                if (!PolyGraph::PassFilter(filter, &tile->polys[q]))
+                    continue;
+
+                const float cost = d + dtVdist(&Centers[(offset + p) * 3], &Centers[(offset + q) * 3]) * areaCost;
+
+                if (cost < dist[q])
+                {
+                    dist[q] = cost;
+                    open.emplace(cost, q);
+                }
+            }
+        }
+    }
+
+    /// Cheapest cost to reach a node from the result of TileDijkstra.
+    inline float GetNodeCost(const dtMeshTile* tile, int offset, const Node& node, const dtQueryFilter* filter,
+                             const std::vector<float>& dist) const noexcept
+    {
+        float best = std::numeric_limits<float>::max();
+
+        for (int m = node.FirstPoly; m < node.FirstPoly + node.PolyCount; ++m)
+        {
+            const int p = NodePolys[m] - offset;
+
+            if (dist[p] == std::numeric_limits<float>::max())
+                continue;
+
+            const float areaCost = filter->getAreaCost(tile->polys[p].getArea());
+            best = dtMin(best, dist[p] + dtVdist(&Centers[NodePolys[m] * 3], node.Pos) * areaCost);
+        }
+
+        return best;
+    }
+
+    /// Cost between a point on the mesh and every node of its tile.
+    void GetPointCosts(int tileIndex, dtPolyRef ref, const float* pos, const dtQueryFilter* filter,
+                       std::vector<float>& costs) const
+    {
+        const dtMeshTile* tile = NavMesh->getTile(tileIndex);
+        const int offset = Indexer.GetTileOffset(tileIndex);
+        const int p = static_cast<int>(NavMesh->decodePolyIdPoly(ref));
+
+        std::vector<float> dist(tile->header->polyCount, std::numeric_limits<float>::max());
+        OpenQueue open;
+
+        dist[p] = dtVdist(pos, &Centers[(offset + p) * 3]) * filter->getAreaCost(tile->polys[p].getArea());
+        open.emplace(dist[p], p);
+        TileDijkstra(tileIndex, filter, dist, open);
+
+        costs.resize(TileNodes[tileIndex + 1] - TileNodes[tileIndex]);
+
+        for (int n = TileNodes[tileIndex]; n < TileNodes[tileIndex + 1]; ++n)
+        {
+            costs[n - TileNodes[tileIndex]] = GetNodeCost(tile, offset, Nodes[n], filter, dist);
+        }
+    }
+
+    /// Cost cache of a filter class, resets the cache if there are too many classes.
+    std::shared_ptr<FilterCosts> GetFilterCosts(uint64_t signature) const
+    {
+        std::lock_guard lock(CostMutex);
+        auto it = Costs.find(signature);
+
+        if (it != Costs.end())
+            return it->second;
+
+        // searches still holding a class keep it alive until they are done
+        if (Costs.size() >= TILE_GRAPH_MAX_FILTER_CLASSES)
+            Costs.clear();
+
+        return Costs.emplace(signature, std::make_shared<FilterCosts>(NavMesh->getMaxTiles())).first->second;
+    }
+
+    /// Intra edge costs of a tile for a filter class, computed on first use.
+    const TileCosts* GetTileCosts(FilterCosts& filterCosts, int tileIndex, const dtQueryFilter* filter) const
+    {
+        if (const TileCosts* cached = filterCosts.Tiles[tileIndex].load(std::memory_order_acquire))
+            return cached;
+
+        const dtMeshTile* tile = NavMesh->getTile(tileIndex);
+        const int offset = Indexer.GetTileOffset(tileIndex);
+        const int first = TileNodes[tileIndex];
+        const int count = TileNodes[tileIndex + 1] - first;
+
+        auto costs = std::make_unique<TileCosts>(static_cast<size_t>(count) * count, std::numeric_limits<float>::max());
+        std::vector<float> dist(tile->header->polyCount);
+        OpenQueue open;
+
+        for (int i = 0; i < count; ++i)
+        {
+            const Node& from = Nodes[first + i];
+            std::fill(dist.begin(), dist.end(), std::numeric_limits<float>::max());
+
+            for (int m = from.FirstPoly; m < from.FirstPoly + from.PolyCount; ++m)
+            {
+                const int p = NodePolys[m] - offset;
+
+                if (!PolyGraph::PassFilter(filter, &tile->polys[p]))
+                    continue;
+
+                dist[p] = dtVdist(from.Pos, &Centers[NodePolys[m] * 3]) * filter->getAreaCost(tile->polys[p].getArea());
+                open.emplace(dist[p], p);
+            }
+
+            TileDijkstra(tileIndex, filter, dist, open);
+
+            for (int j = 0; j < count; ++j)
+            {
+                if (j != i)
+                    (*costs)[i * count + j] = GetNodeCost(tile, offset, Nodes[first + j], filter, dist);
+            }
+        }
+
+        std::lock_guard lock(filterCosts.Mutex);
+
+        // another search may have been faster
+        if (const TileCosts* cached = filterCosts.Tiles[tileIndex].load(std::memory_order_acquire))
+            return cached;
+
+        filterCosts.Tiles[tileIndex].store(costs.get(), std::memory_order_release);
+        filterCosts.Owned.push_back(std::move(costs));
+        return filterCosts.Owned.back().get();
+    }
+};
+
+/// PolySearch constraint that only accepts polys of a sorted set of tiles, see TileGraph::FindCorridorTiles.
+struct TileSetConstraint
+{
+    const dtNavMesh* NavMesh;
+    const std::vector<unsigned int>* Tiles;
+
+    inline bool operator()(dtPolyRef ref) const noexcept
+    {
+        return std::binary_search(Tiles->begin(), Tiles->end(), NavMesh->decodePolyIdTile(ref));
+    }
+};
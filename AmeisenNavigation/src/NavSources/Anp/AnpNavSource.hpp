@@ -12,7 +12,7 @@
 class AnpNavSource : public INavSource
 {
     const std::filesystem::path MmapFolder;
-    std::unordered_map<size_t, std::unique_ptr<Anp>> NavMeshMap;
+    std::unordered_map<size_t, NavMeshRef> NavMeshMap;
     mutable std::shared_mutex MapMutex;
 
 public:
@@ -20,7 +20,7 @@ public:
 
     ~AnpNavSource() = default;
 
-    virtual dtNavMesh* Get(size_t mapId) noexcept override
+    virtual NavMeshRef Get(size_t mapId) noexcept override
     {
         try
         {
@@ -29,7 +29,7 @@ public:
                 std::shared_lock readLock(MapMutex);
                 auto it = NavMeshMap.find(mapId);
                 if (it != NavMeshMap.end() && it->second)
-                    return it->second->GetNavmesh();
+                    return it->second;
             }
 
             // Slow path: exclusive lock for loading
@@ -38,26 +38,95 @@ public:
             // Double-check after acquiring exclusive lock
             auto it = NavMeshMap.find(mapId);
             if (it != NavMeshMap.end() && it->second)
-                return it->second->GetNavmesh();
+                return it->second;
 
             // Check for nullptr sentinel (already tried and failed)
             if (it != NavMeshMap.end())
                 return nullptr;
 
-            std::filesystem::path anpPath = MmapFolder;
-            anpPath.append(std::format("{:03}.anp", mapId));
+            // Insert nullptr sentinel so we don't retry missing files
+            auto& navMesh = NavMeshMap[mapId];
+            navMesh = Load(mapId);
+            return navMesh;
+        }
+        catch (...) { return nullptr; }
+    }
 
-            if (std::filesystem::exists(anpPath))
+    virtual NavMeshRef GetIfLoaded(size_t mapId) noexcept override
+    {
+        std::shared_lock readLock(MapMutex);
+        auto it = NavMeshMap.find(mapId);
+        return it != NavMeshMap.end() ? it->second : nullptr;
+    }
+
+    virtual NavMeshRef Unload(size_t mapId) noexcept override
+    {
+        NavMeshRef navMesh;
+
+        {
+            std::unique_lock writeLock(MapMutex);
+            auto it = NavMeshMap.find(mapId);
+
+            // missing maps keep their sentinel
+            if (it == NavMeshMap.end() || !it->second)
+                return nullptr;
+
+            navMesh = std::move(it->second);
+            NavMeshMap.erase(it);
+        }
+
+        Generation.fetch_add(1, std::memory_order_acq_rel);
+        return navMesh;
+    }
+
+    virtual NavMeshRef Reload(size_t mapId) noexcept override
+    {
+        try
+        {
             {
-                NavMeshMap[mapId] = std::make_unique<Anp>(anpPath.string().c_str());
-                auto& anp = NavMeshMap[mapId];
-                return anp ? anp->GetNavmesh() : nullptr;
+                std::shared_lock readLock(MapMutex);
+                auto it = NavMeshMap.find(mapId);
+                if (it == NavMeshMap.end() || !it->second)
+                    return nullptr;
             }
 
-            // Insert nullptr sentinel so we don't retry missing files
-            NavMeshMap[mapId] = nullptr;
-            return nullptr;
+            // built without holding the lock, queries keep using the current navmesh meanwhile
+            NavMeshRef navMesh = Load(mapId);
+
+            if (!navMesh)
+            {
+                LogE("Failed to reload map '", mapId, "', keeping the current navmesh");
+                return nullptr;
+            }
+
+            {
+                std::unique_lock writeLock(MapMutex);
+                std::swap(NavMeshMap[mapId], navMesh);
+            }
+
+            Generation.fetch_add(1, std::memory_order_acq_rel);
+            LogI("Reloaded map '", mapId, "'");
+            return navMesh;
         }
         catch (...) { return nullptr; }
     }
+
+private:
+    NavMeshRef Load(size_t mapId)
+    {
+        // the uncompressed container is mapped instead of extracted, prefer it if both exist
+        std::filesystem::path anpPath = MmapFolder;
+        anpPath.append(std::format("{:03}.anp2", mapId));
+
+        if (!std::filesystem::exists(anpPath))
+            anpPath.replace_extension(".anp");
+
+        if (!std::filesystem::exists(anpPath))
+            return nullptr;
+
+        // the map id is only set once the navmesh could be initialised from the file
+        auto anp = std::make_shared<Anp>(anpPath.string().c_str());
+        dtNavMesh* navMesh = anp->GetNavmesh();
+        return navMesh && anp->GetMapId() >= 0 ? MakeNavMeshRef(navMesh, std::move(anp)) : nullptr;
+    }
 };
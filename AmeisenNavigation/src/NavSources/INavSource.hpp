@@ -1,11 +1,82 @@
 #pragma once
 
+#include <atomic>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <shared_mutex>
+
 #include "../../../recastnavigation/Detour/Include/DetourNavMesh.h"
 
+/// Shared lock a query holds on the tiles of a map while it reads the navmesh.
+using NavTileLock = std::shared_lock<std::shared_mutex>;
+
+/// Reference to a published navmesh. A reloaded map only frees its previous navmesh once the last reference,
+/// usually held by a query that was initialised with it, is gone.
+using NavMeshRef = std::shared_ptr<dtNavMesh>;
+
 class INavSource
 {
+    std::mutex RetireMutex;
+    std::function<void(const dtNavMesh*)> RetireCallback;
+
+protected:
+    std::atomic<uint64_t> Generation{ 0 }; // incremented whenever a navmesh got replaced
+
 public:
     virtual ~INavSource() noexcept {}
 
-    virtual dtNavMesh* Get(size_t mapId) noexcept = 0;
+    virtual NavMeshRef Get(size_t mapId) noexcept = 0;
+
+    /// Current navmesh of a map, nullptr instead of loading it if it is not loaded.
+    virtual NavMeshRef GetIfLoaded(size_t mapId) noexcept = 0;
+
+    /// Remove a map, the next Get loads it again. Its navmesh is freed once the returned reference and all
+    /// others are gone. Returns nullptr if the map was not loaded.
+    virtual NavMeshRef Unload(size_t mapId) noexcept = 0;
+
+    /// Build the navmesh of a loaded map again from its files and publish it in place of the current one.
+    /// Queries running on the current navmesh finish on it. Returns the replaced navmesh, nullptr if the map
+    /// is not loaded or the new navmesh could not be built, the current one stays in use then.
+    virtual NavMeshRef Reload(size_t /*mapId*/) noexcept { return nullptr; }
+
+    /// Changes whenever Reload or Unload replaced a navmesh. Callers that saw the same generation before can keep using
+    /// what they got from Get without asking again.
+    inline uint64_t GetGeneration() const noexcept { return Generation.load(std::memory_order_acquire); }
+
+    /// Set the function that is called with every navmesh right before it is freed, to drop whatever was
+    /// derived from it. Passing nullptr removes it and waits for a running call to return.
+    inline void SetRetireCallback(std::function<void(const dtNavMesh*)> callback)
+    {
+        const std::lock_guard lock(RetireMutex);
+        RetireCallback = std::move(callback);
+    }
+
+    /// Whether tiles are added to and removed from loaded navmeshes. Indexes and caches that assume a fixed
+    /// tile set can not be used then.
+    virtual bool StreamsTiles() const noexcept { return false; }
+
+    /// Make sure the tiles overlapping bmin/bmax (navmesh coordinates, nullptr for none) are loaded and lock
+    /// the tiles of the map against removal. navMesh is the one the caller queries, it is left alone if it got
+    /// replaced in the meantime. Sources that never change a loaded navmesh return an empty lock.
+    virtual NavTileLock LockTiles(size_t /*mapId*/, const dtNavMesh* /*navMesh*/, const float* /*bmin*/,
+                                  const float* /*bmax*/) noexcept
+    {
+        return {};
+    }
+
+protected:
+    /// Reference to navMesh for publishing, owner is what frees the navmesh and is released with the last
+    /// reference.
+    template<typename T>
+    inline NavMeshRef MakeNavMeshRef(dtNavMesh* navMesh, std::shared_ptr<T> owner)
+    {
+        return NavMeshRef(navMesh, [this, owner = std::move(owner)](dtNavMesh* retired)
+        {
+            const std::lock_guard lock(RetireMutex);
+
+            if (RetireCallback)
+                RetireCallback(retired);
+        });
+    }
 };
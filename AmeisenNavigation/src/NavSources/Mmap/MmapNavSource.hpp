@@ -1,22 +1,123 @@
 #pragma once
 
+#include <algorithm>
+#include <atomic>
+#include <cmath>
 #include <filesystem>
 #include <fstream>
 #include <map>
+#include <memory>
 #include <mutex>
+#include <shared_mutex>
 #include <unordered_map>
+#include <unordered_set>
+#include <vector>
 
 #include "../INavSource.hpp"
 #include "../../Utils/Logger.hpp"
+#include "../../Utils/MappedFile.hpp"
+#include "../../Utils/TileArena.hpp"
 #include "MmapFormat.hpp"
 #include "MmapTileHeader.hpp"
 
+/// Tiles loaded around the requested bounds when streaming, so queries near the edge of the bounds do not
+/// hit a missing neighbour.
+constexpr int MMAP_STREAM_PREFETCH_RING = 1;
+
 class MmapNavSource : public INavSource
 {
+	/// Tile file of a map, only kept when streaming.
+	struct TileFile
+	{
+		std::filesystem::path File;
+		unsigned int Size;
+		int X;
+		int Y;
+		dtTileRef Ref; // 0 while not loaded
+		std::unique_ptr<MappedFile> Mapping; // backs the tile data if the file is mapped
+	};
+
+	/// Data of a tile, either read into a malloc'ed buffer that the navmesh frees, read into the arena of
+	/// its map or pointing into a mapping of the tile file that has to outlive the tile.
+	struct TileData
+	{
+		unsigned char* Data = nullptr;
+		unsigned int Size = 0;
+		std::unique_ptr<MappedFile> Mapping;
+		bool InArena = false;
+
+		inline int GetTileFlags() const noexcept { return Mapping || InArena ? 0 : DT_TILE_FREE_DATA; }
+
+		/// Discard data that did not make it into the navmesh.
+		inline void Release() noexcept
+		{
+			if (!Mapping && !InArena)
+				free(Data);
+
+			Data = nullptr;
+			Mapping.reset();
+		}
+	};
+
+	struct TileRect
+	{
+		int MinX, MinY, MaxX, MaxY;
+
+		constexpr inline TileRect Intersect(const TileRect& other) const noexcept
+		{
+			return { std::max(MinX, other.MinX), std::max(MinY, other.MinY),
+					 std::min(MaxX, other.MaxX), std::min(MaxY, other.MaxY) };
+		}
+
+		constexpr inline bool Contains(int x, int y) const noexcept
+		{
+			return x >= MinX && x <= MaxX && y >= MinY && y <= MaxY;
+		}
+	};
+
+	/// Navmesh of a map with everything it needs, published as a whole and replaced as a whole by Reload.
+	struct MapEntry
+	{
+		dtNavMesh* NavMesh = nullptr;
+
+		// streaming only, Ref and ResidentBytes are modified under an exclusive lock of TileMutex
+		std::shared_mutex TileMutex;
+		std::vector<TileFile> Tiles;
+		std::unordered_map<uint64_t, std::vector<int>> TilesAt; // tile location -> indices into Tiles
+		std::unique_ptr<std::atomic<uint64_t>[]> LastUsed;      // by index into Tiles
+		TileRect Bounds{ 0, 0, -1, -1 };                        // locations of the tiles
+		size_t ResidentBytes = 0;
+
+		// mapped tile files, or the read tiles, of a map that is loaded as a whole
+		std::vector<std::unique_ptr<MappedFile>> Mappings;
+		std::unique_ptr<TileArena> Arena;
+
+		MapEntry() = default;
+
+		// the mappings are released after the navmesh that points into them
+		~MapEntry()
+		{
+			if (NavMesh)
+			{
+				dtFreeNavMesh(NavMesh);
+			}
+		}
+	};
+
+	struct MapSlot
+	{
+		std::mutex LoadMutex; // serialises loading and reloading, queries never take it
+		std::shared_ptr<MapEntry> Entry; // Entry and NavMesh are replaced together under MapInsertMutex
+		NavMeshRef NavMesh;
+	};
+
 	std::filesystem::path MmapFolder;
 	MmapFormat Format;
-	std::mutex MapInsertMutex; // protects NavMeshMap structural modifications (insert/find)
-	std::unordered_map<size_t, std::pair<std::mutex, dtNavMesh*>> NavMeshMap;
+	size_t TileBudget; // bytes, 0 loads whole maps
+	bool MapTileFiles;
+	std::atomic<uint64_t> Clock; // orders tile uses for the eviction
+	std::mutex MapInsertMutex; // protects NavMeshMap structural modifications (insert/find) and publishing
+	std::unordered_map<size_t, MapSlot> NavMeshMap;
 
 	std::map<MmapFormat, std::pair<std::string_view, std::string_view>> MmapFormatPatterns
 	{
@@ -25,9 +126,18 @@ class MmapNavSource : public INavSource
 	};
 
 public:
-	MmapNavSource(const char* mmapFolder, MmapFormat format = MmapFormat::UNKNOWN)
+	/// With a tileBudget (bytes) maps start empty and their tiles are streamed in by LockTiles, the least
+	/// recently used tiles are removed once the loaded tiles of a map exceed the budget.
+	///
+	/// With mapTileFiles the navmesh uses the tile files mapped copy-on-write instead of copies of them. Only
+	/// the pages Detour writes its links to become private, the rest stays shared with other processes.
+	MmapNavSource(const char* mmapFolder, MmapFormat format = MmapFormat::UNKNOWN, size_t tileBudget = 0,
+				  bool mapTileFiles = false)
 		: MmapFolder(mmapFolder),
 		Format(format),
+		TileBudget(tileBudget),
+		MapTileFiles(mapTileFiles),
+		Clock(0),
 		NavMeshMap{}
 	{
 		if (format == MmapFormat::UNKNOWN)
@@ -36,60 +146,236 @@ public:
 		}
 	}
 
-	~MmapNavSource()
+	constexpr inline MmapFormat GetFormat() const noexcept { return Format; }
+
+	virtual NavMeshRef Get(size_t mapId) noexcept override
 	{
-		for (auto& [id, mtxNavMesh] : NavMeshMap)
+		try
 		{
-			const std::lock_guard lock(mtxNavMesh.first);
-
-			if (mtxNavMesh.second)
 			{
-				dtFreeNavMesh(mtxNavMesh.second);
+				const std::lock_guard<std::mutex> insertLock(MapInsertMutex);
+				auto it = NavMeshMap.find(mapId);
+
+				if (it != NavMeshMap.end() && it->second.NavMesh)
+					return it->second.NavMesh;
 			}
+
+			LoadMmaps(mapId);
+			const std::lock_guard<std::mutex> insertLock(MapInsertMutex);
+			auto it = NavMeshMap.find(mapId);
+			return it != NavMeshMap.end() ? it->second.NavMesh : nullptr;
 		}
+		catch (...) { return nullptr; }
 	}
 
-	constexpr inline MmapFormat GetFormat() const noexcept { return Format; }
+	virtual NavMeshRef GetIfLoaded(size_t mapId) noexcept override
+	{
+		const std::lock_guard<std::mutex> insertLock(MapInsertMutex);
+		auto it = NavMeshMap.find(mapId);
+		return it != NavMeshMap.end() ? it->second.NavMesh : nullptr;
+	}
 
-	virtual dtNavMesh* Get(size_t mapId) noexcept override
+	virtual NavMeshRef Unload(size_t mapId) noexcept override
 	{
-		try
+		MapSlot* slot = nullptr;
+
 		{
-			LoadMmaps(mapId);
 			const std::lock_guard<std::mutex> insertLock(MapInsertMutex);
 			auto it = NavMeshMap.find(mapId);
-			return it != NavMeshMap.end() ? it->second.second : nullptr;
+
+			if (it == NavMeshMap.end() || !it->second.NavMesh)
+				return nullptr;
+
+			slot = &it->second;
+		}
+
+		// the slot stays, a concurrent Get may already wait for its LoadMutex
+		const std::lock_guard<std::mutex> lock(slot->LoadMutex);
+		NavMeshRef navMesh;
+
+		{
+			const std::lock_guard<std::mutex> insertLock(MapInsertMutex);
+			slot->Entry.reset();
+			std::swap(slot->NavMesh, navMesh);
+		}
+
+		if (navMesh)
+			Generation.fetch_add(1, std::memory_order_acq_rel);
+
+		return navMesh;
+	}
+
+	virtual NavMeshRef Reload(size_t mapId) noexcept override
+	{
+		try
+		{
+			MapSlot* slot = nullptr;
+
+			{
+				const std::lock_guard<std::mutex> insertLock(MapInsertMutex);
+				auto it = NavMeshMap.find(mapId);
+
+				if (it == NavMeshMap.end() || !it->second.NavMesh)
+					return nullptr;
+
+				slot = &it->second;
+			}
+
+			const std::lock_guard<std::mutex> lock(slot->LoadMutex);
+
+			// built next to the current entry, queries keep using it meanwhile
+			std::shared_ptr<MapEntry> entry = LoadMap(static_cast<int>(mapId));
+
+			if (!entry)
+			{
+				LogE("Failed to reload map '", mapId, "', keeping the current navmesh");
+				return nullptr;
+			}
+
+			NavMeshRef previous = Publish(*slot, std::move(entry));
+			Generation.fetch_add(1, std::memory_order_acq_rel);
+			LogI("Reloaded map '", mapId, "'");
+			return previous;
 		}
 		catch (...) { return nullptr; }
 	}
 
+	virtual bool StreamsTiles() const noexcept override { return TileBudget > 0; }
+
+	virtual NavTileLock LockTiles(size_t mapId, const dtNavMesh* navMesh, const float* bmin,
+								  const float* bmax) noexcept override
+	{
+		if (!TileBudget)
+			return {};
+
+		// the caller holds a reference to its navmesh, which keeps the entry alive while the lock is held
+		MapEntry* entry = nullptr;
+
+		{
+			const std::lock_guard<std::mutex> insertLock(MapInsertMutex);
+			auto it = NavMeshMap.find(mapId);
+
+			if (it == NavMeshMap.end() || !it->second.Entry)
+				return {};
+
+			entry = it->second.Entry.get();
+		}
+
+		// a replaced navmesh no longer gets tiles added or removed
+		if (entry->NavMesh != navMesh)
+			return {};
+
+		try
+		{
+			if (!bmin || !bmax)
+				return NavTileLock(entry->TileMutex);
+
+			// like dtNavMesh::calcTileLoc, but bounds far outside of the map must not overflow
+			const dtNavMeshParams* params = entry->NavMesh->getParams();
+			const auto tileLoc = [](float pos, float origin, float size, int ring) noexcept
+			{
+				return static_cast<int>(std::clamp(std::floor((pos - origin) / size) + ring, -65536.0f, 65536.0f));
+			};
+
+			const TileRect rect = entry->Bounds.Intersect({
+				tileLoc(bmin[0], params->orig[0], params->tileWidth, -MMAP_STREAM_PREFETCH_RING),
+				tileLoc(bmin[2], params->orig[2], params->tileHeight, -MMAP_STREAM_PREFETCH_RING),
+				tileLoc(bmax[0], params->orig[0], params->tileWidth, MMAP_STREAM_PREFETCH_RING),
+				tileLoc(bmax[2], params->orig[2], params->tileHeight, MMAP_STREAM_PREFETCH_RING)
+			});
+
+			// another query may evict the tiles between loading and locking them, check again
+			for (int attempt = 0; attempt < 2; ++attempt)
+			{
+				std::vector<int> missing;
+
+				{
+					NavTileLock lock(entry->TileMutex);
+					const uint64_t now = ++Clock;
+
+					ForEachTile(*entry, rect, [&](int i)
+					{
+						if (entry->Tiles[i].Ref)
+							entry->LastUsed[i].store(now, std::memory_order_relaxed);
+						else
+							missing.push_back(i);
+					});
+
+					// over the budget after a query that needed more tiles, evict them now
+					if (missing.empty() && entry->ResidentBytes <= TileBudget)
+						return lock;
+				}
+
+				LoadTiles(*entry, missing, rect);
+			}
+
+			return NavTileLock(entry->TileMutex);
+		}
+		catch (const std::exception& e)
+		{
+			LogE("LockTiles failed: ", e.what());
+			return NavTileLock(entry->TileMutex);
+		}
+	}
+
 private:
 	bool LoadMmaps(size_t mapId) noexcept
 	{
 		try {
 		// Ensure the map entry exists under the insert mutex before locking the per-map mutex.
+		MapSlot* slot = nullptr;
+
 		{
 			const std::lock_guard<std::mutex> insertLock(MapInsertMutex);
-			NavMeshMap[mapId]; // default-constructs entry if absent
+			slot = &NavMeshMap[mapId]; // default-constructs slot if absent
 		}
 
-		const std::lock_guard<std::mutex> lock(NavMeshMap[mapId].first);
+		const std::lock_guard<std::mutex> lock(slot->LoadMutex);
 
-		if (NavMeshMap[mapId].second) { return true; }
+		{
+			const std::lock_guard<std::mutex> insertLock(MapInsertMutex);
+			if (slot->NavMesh) { return true; }
+		}
 
-		if (!MmapFormatPatterns.contains(Format))
+		std::shared_ptr<MapEntry> entry = LoadMap(static_cast<int>(mapId));
+
+		if (!entry)
+		{
 			return false;
+		}
+
+		Publish(*slot, std::move(entry));
+		return true;
+		} catch (const std::exception& e) { LogE("LoadMmaps failed: ", e.what()); return false; }
+		  catch (...) { LogE("LoadMmaps failed: unknown exception"); return false; }
+	}
+
+	/// Make entry the navmesh of slot, returns the previous one. It has to be released outside of
+	/// MapInsertMutex, the retire callback may run when it is the last reference.
+	NavMeshRef Publish(MapSlot& slot, std::shared_ptr<MapEntry> entry)
+	{
+		NavMeshRef navMesh = MakeNavMeshRef(entry->NavMesh, entry);
+		const std::lock_guard<std::mutex> insertLock(MapInsertMutex);
+		slot.Entry = std::move(entry);
+		std::swap(slot.NavMesh, navMesh);
+		return navMesh;
+	}
+
+	/// Build a new entry for a map from its files, nullptr if there is no valid .mmap file.
+	std::shared_ptr<MapEntry> LoadMap(int mapId)
+	{
+		if (!MmapFormatPatterns.contains(Format))
+			return nullptr;
 
 		const auto& filenameFormat = MmapFormatPatterns.at(Format);
 
 		std::filesystem::path mmapFile(MmapFolder);
-		const int mid = static_cast<int>(mapId);
-		std::string filename = std::vformat(filenameFormat.first, std::make_format_args(mid));
+		std::string filename = std::vformat(filenameFormat.first, std::make_format_args(mapId));
 		mmapFile.append(filename);
 
 		if (!std::filesystem::exists(mmapFile))
 		{
-			return false;
+			return nullptr;
 		}
 
 		std::ifstream mmapStream;
@@ -99,83 +385,339 @@ private:
 		mmapStream.read(reinterpret_cast<char*>(&params), sizeof(dtNavMeshParams));
 		mmapStream.close();
 
-		NavMeshMap[mapId].second = dtAllocNavMesh();
+		auto entry = std::make_shared<MapEntry>();
+		entry->NavMesh = dtAllocNavMesh();
 
-		if (!NavMeshMap[mapId].second)
+		if (!entry->NavMesh)
 		{
-			return false;
+			return nullptr;
 		}
 
-		dtStatus initStatus = NavMeshMap[mapId].second->init(&params);
+		dtStatus initStatus = entry->NavMesh->init(&params);
 
 		if (dtStatusFailed(initStatus))
 		{
-			dtFreeNavMesh(NavMeshMap[mapId].second);
-			return false;
+			return nullptr;
 		}
 
-        constexpr int TILE_GRID_SIZE = 64;
+		const std::vector<std::filesystem::path> tileFiles = FindTileFiles(filenameFormat.second, mapId);
 
-#pragma omp parallel for schedule(dynamic)
-		for (int i = 0; i < TILE_GRID_SIZE * TILE_GRID_SIZE; ++i)
+		if (TileBudget)
 		{
-			const auto x = i / TILE_GRID_SIZE;
-			const auto y = i % TILE_GRID_SIZE;
+			IndexTiles(*entry, tileFiles);
+			LogI("Indexed ", entry->Tiles.size(), " tiles of map '", mapId, "' for streaming");
+			return entry;
+		}
 
-			std::filesystem::path mmapTileFile(MmapFolder);
-			mmapTileFile.append(std::vformat(filenameFormat.second, std::make_format_args(mid, x, y)));
+		dtNavMesh* navMesh = entry->NavMesh;
 
-			if (!std::filesystem::exists(mmapTileFile))
+		// read tiles go into one block, in the order of the files
+		std::vector<size_t> tileSizes;
+
+		if (!MapTileFiles)
+		{
+			tileSizes.reserve(tileFiles.size());
+
+			for (const auto& file : tileFiles)
 			{
-				continue;
+				std::error_code error;
+				const uintmax_t fileSize = std::filesystem::file_size(file, error);
+				tileSizes.push_back(!error && fileSize > sizeof(MmapTileHeader) ? fileSize - sizeof(MmapTileHeader) : 0);
 			}
 
+			entry->Arena = std::make_unique<TileArena>(tileSizes);
 
-			std::ifstream mmapTileStream;
-			mmapTileStream.open(mmapTileFile, std::ifstream::binary);
-
-			MmapTileHeader mmapTileHeader{};
-			mmapTileStream.read(reinterpret_cast<char*>(&mmapTileHeader), sizeof(MmapTileHeader));
-
-			if (mmapTileHeader.mmapMagic != MMAP_MAGIC)
+			if (!entry->Arena->IsAllocated())
 			{
-				continue;
+				LogW("Failed to allocate the tiles of map '", mapId, "' in one block, allocating them one by one");
+				entry->Arena.reset();
 			}
+		}
 
-			if (mmapTileHeader.mmapVersion < MMAP_VERSION)
+		const TileArena* arena = entry->Arena.get();
+
+#pragma omp parallel for schedule(dynamic)
+		for (int i = 0; i < static_cast<int>(tileFiles.size()); ++i)
+		{
+			TileData tile;
+
+			if (arena)
 			{
-				continue;
+				tile.Data = arena->GetTile(i);
+				tile.Size = static_cast<unsigned int>(tileSizes[i]);
+				tile.InArena = true;
 			}
 
-			void* mmapTileData = malloc(mmapTileHeader.size);
-			if (!mmapTileData)
+			if (!ReadTile(tileFiles[i], tile))
 			{
 				continue;
 			}
-			mmapTileStream.read(static_cast<char*>(mmapTileData), mmapTileHeader.size);
-			mmapTileStream.close();
 
 #pragma omp critical(addMmapTile)
 			{
-				dtStatus addTileStatus = NavMeshMap[mapId].second->addTile
+				dtStatus addTileStatus = navMesh->addTile
 				(
-					static_cast<unsigned char*>(mmapTileData),
-					mmapTileHeader.size,
-					DT_TILE_FREE_DATA,
+					tile.Data,
+					tile.Size,
+					tile.GetTileFlags(),
 					0,
 					nullptr
 				);
 
 				if (dtStatusFailed(addTileStatus))
 				{
-					free(mmapTileData);
+					tile.Release();
+				}
+				else if (tile.Mapping)
+				{
+					entry->Mappings.push_back(std::move(tile.Mapping));
+				}
+			}
+		}
+
+		return entry;
+	}
+
+	/// Tile files of a map, matched against one listing of the folder instead of probing every name. They
+	/// are ordered along a Z-order curve, so neighbouring tiles end up close to each other in the arena.
+	std::vector<std::filesystem::path> FindTileFiles(std::string_view pattern, int mapId) const
+	{
+		constexpr int TILE_GRID_SIZE = 64;
+
+		std::unordered_set<std::string> existing;
+		std::error_code error;
+
+		for (const auto& file : std::filesystem::directory_iterator(MmapFolder, error))
+		{
+			existing.insert(file.path().filename().string());
+		}
+
+		std::vector<std::pair<uint32_t, std::filesystem::path>> orderedFiles;
+
+		for (int x = 0; x < TILE_GRID_SIZE; ++x)
+		{
+			for (int y = 0; y < TILE_GRID_SIZE; ++y)
+			{
+				std::string name = std::vformat(pattern, std::make_format_args(mapId, x, y));
+
+				if (existing.contains(name))
+				{
+					orderedFiles.emplace_back(GetTileOrder(x, y), MmapFolder / name);
 				}
 			}
 		}
 
+		std::sort(orderedFiles.begin(), orderedFiles.end());
+
+		std::vector<std::filesystem::path> tileFiles;
+		tileFiles.reserve(orderedFiles.size());
+
+		for (auto& [order, file] : orderedFiles)
+		{
+			tileFiles.push_back(std::move(file));
+		}
+
+		return tileFiles;
+	}
+
+	/// Read or map the data of a tile file, false if the file is invalid or outdated. A tile that is InArena
+	/// is read into the slot of Size bytes Data points to.
+	bool ReadTile(const std::filesystem::path& file, TileData& tile) const
+	{
+		if (MapTileFiles)
+		{
+			auto mapping = std::make_unique<MappedFile>(file);
+
+			if (!mapping->IsOpen() || mapping->GetSize() < sizeof(MmapTileHeader))
+			{
+				return false;
+			}
+
+			const auto* mmapTileHeader = reinterpret_cast<const MmapTileHeader*>(mapping->GetData());
+
+			if (mmapTileHeader->mmapMagic != MMAP_MAGIC || mmapTileHeader->mmapVersion < MMAP_VERSION
+				|| mmapTileHeader->size > mapping->GetSize() - sizeof(MmapTileHeader))
+			{
+				return false;
+			}
+
+			tile.Data = mapping->GetData() + sizeof(MmapTileHeader);
+			tile.Size = mmapTileHeader->size;
+			tile.Mapping = std::move(mapping);
+			return true;
+		}
+
+		std::ifstream mmapTileStream;
+		mmapTileStream.open(file, std::ifstream::binary);
+
+		MmapTileHeader mmapTileHeader{};
+		mmapTileStream.read(reinterpret_cast<char*>(&mmapTileHeader), sizeof(MmapTileHeader));
+
+		if (!mmapTileStream || mmapTileHeader.mmapMagic != MMAP_MAGIC || mmapTileHeader.mmapVersion < MMAP_VERSION)
+		{
+			return false;
+		}
+
+		if (tile.InArena)
+		{
+			// the slot was sized from the file, a header claiming more would write past it
+			if (mmapTileHeader.size > tile.Size
+				|| !mmapTileStream.read(reinterpret_cast<char*>(tile.Data), mmapTileHeader.size))
+			{
+				return false;
+			}
+
+			tile.Size = mmapTileHeader.size;
+			return true;
+		}
+
+		void* mmapTileData = malloc(mmapTileHeader.size);
+
+		if (!mmapTileData)
+		{
+			return false;
+		}
+
+		mmapTileStream.read(static_cast<char*>(mmapTileData), mmapTileHeader.size);
+
+		if (!mmapTileStream)
+		{
+			free(mmapTileData);
+			return false;
+		}
+
+		tile.Data = static_cast<unsigned char*>(mmapTileData);
+		tile.Size = mmapTileHeader.size;
 		return true;
-		} catch (const std::exception& e) { LogE("LoadMmaps failed: ", e.what()); return false; }
-		  catch (...) { LogE("LoadMmaps failed: unknown exception"); return false; }
+	}
+
+	static constexpr inline uint64_t TileKey(int x, int y) noexcept
+	{
+		return static_cast<uint64_t>(static_cast<uint32_t>(x)) << 32 | static_cast<uint32_t>(y);
+	}
+
+	template<typename Fn>
+	static inline void ForEachTile(const MapEntry& entry, const TileRect& rect, Fn&& callback)
+	{
+		for (int y = rect.MinY; y <= rect.MaxY; ++y)
+		{
+			for (int x = rect.MinX; x <= rect.MaxX; ++x)
+			{
+				auto it = entry.TilesAt.find(TileKey(x, y));
+
+				if (it != entry.TilesAt.end())
+				{
+					for (const int i : it->second)
+						callback(i);
+				}
+			}
+		}
+	}
+
+	/// Read the location of every tile from its header, the data is loaded on demand.
+	static void IndexTiles(MapEntry& entry, const std::vector<std::filesystem::path>& tileFiles)
+	{
+		for (const auto& file : tileFiles)
+		{
+			std::ifstream mmapTileStream;
+			mmapTileStream.open(file, std::ifstream::binary);
+
+			MmapTileHeader mmapTileHeader{};
+			dtMeshHeader meshHeader{};
+			mmapTileStream.read(reinterpret_cast<char*>(&mmapTileHeader), sizeof(MmapTileHeader));
+			mmapTileStream.read(reinterpret_cast<char*>(&meshHeader), sizeof(dtMeshHeader));
+
+			if (!mmapTileStream || mmapTileHeader.mmapMagic != MMAP_MAGIC || mmapTileHeader.mmapVersion < MMAP_VERSION
+				|| meshHeader.magic != DT_NAVMESH_MAGIC)
+			{
+				continue;
+			}
+
+			if (entry.Tiles.empty())
+			{
+				entry.Bounds = { meshHeader.x, meshHeader.y, meshHeader.x, meshHeader.y };
+			}
+			else
+			{
+				entry.Bounds.MinX = std::min(entry.Bounds.MinX, meshHeader.x);
+				entry.Bounds.MinY = std::min(entry.Bounds.MinY, meshHeader.y);
+				entry.Bounds.MaxX = std::max(entry.Bounds.MaxX, meshHeader.x);
+				entry.Bounds.MaxY = std::max(entry.Bounds.MaxY, meshHeader.y);
+			}
+
+			entry.TilesAt[TileKey(meshHeader.x, meshHeader.y)].push_back(static_cast<int>(entry.Tiles.size()));
+			entry.Tiles.push_back(TileFile{ file, mmapTileHeader.size, meshHeader.x, meshHeader.y, 0, nullptr });
+		}
+
+		entry.LastUsed = std::make_unique<std::atomic<uint64_t>[]>(entry.Tiles.size());
+	}
+
+	/// Read the missing tiles outside of the lock, then add them and evict the least recently used tiles
+	/// outside of rect while the map is over the budget.
+	void LoadTiles(MapEntry& entry, const std::vector<int>& missing, const TileRect& rect)
+	{
+		std::vector<std::pair<int, TileData>> loaded;
+		loaded.reserve(missing.size());
+
+		for (const int i : missing)
+		{
+			if (TileData data; ReadTile(entry.Tiles[i].File, data))
+			{
+				loaded.emplace_back(i, std::move(data));
+			}
+		}
+
+		const std::unique_lock lock(entry.TileMutex);
+
+		for (auto& [i, data] : loaded)
+		{
+			TileFile& tile = entry.Tiles[i];
+
+			// another query was faster
+			if (tile.Ref)
+			{
+				data.Release();
+				continue;
+			}
+
+			if (dtStatusFailed(entry.NavMesh->addTile(data.Data, data.Size, data.GetTileFlags(), 0, &tile.Ref)))
+			{
+				data.Release();
+				tile.Ref = 0;
+				continue;
+			}
+
+			tile.Mapping = std::move(data.Mapping);
+			entry.ResidentBytes += tile.Size;
+			entry.LastUsed[i].store(++Clock, std::memory_order_relaxed);
+		}
+
+		if (entry.ResidentBytes <= TileBudget)
+			return;
+
+		std::vector<std::pair<uint64_t, int>> candidates;
+
+		for (int i = 0; i < static_cast<int>(entry.Tiles.size()); ++i)
+		{
+			if (entry.Tiles[i].Ref && !rect.Contains(entry.Tiles[i].X, entry.Tiles[i].Y))
+				candidates.emplace_back(entry.LastUsed[i].load(std::memory_order_relaxed), i);
+		}
+
+		std::sort(candidates.begin(), candidates.end());
+
+		for (const auto& [lastUsed, i] : candidates)
+		{
+			if (entry.ResidentBytes <= TileBudget)
+				break;
+
+			// the navmesh frees read tiles (DT_TILE_FREE_DATA), mapped ones are unmapped here
+			if (dtStatusSucceed(entry.NavMesh->removeTile(entry.Tiles[i].Ref, nullptr, nullptr)))
+			{
+				entry.ResidentBytes -= entry.Tiles[i].Size;
+				entry.Tiles[i].Ref = 0;
+				entry.Tiles[i].Mapping.reset();
+			}
+		}
 	}
 
 	inline MmapFormat TryDetectMmapFormat() noexcept
@@ -0,0 +1,108 @@
+#pragma once
+
+#include <vector>
+
+#include "../../../recastnavigation/Detour/Include/DetourCommon.h"
+#include "../../../recastnavigation/Detour/Include/DetourNavMesh.h"
+
+#include "../Helpers/Polygon.hpp"
+#include "../Utils/Vector3.hpp"
+#include "PolyGraph.hpp"
+
+/// <summary>
+/// 2D area in wow coordinates (x, y) a path search is confined to, either an axis aligned box or a polygon.
+/// </summary>
+class PathRegion
+{
+    std::vector<Vector3> Vertices; // empty for a box
+    float Min[2];
+    float Max[2];
+
+public:
+    PathRegion(float minX, float minY, float maxX, float maxY) noexcept
+        : Vertices(),
+        Min{ dtMin(minX, maxX), dtMin(minY, maxY) },
+        Max{ dtMax(minX, maxX), dtMax(minY, maxY) }
+    {}
+
+    PathRegion(const Vector3* vertices, int vertexCount)
+        : Vertices(vertices, vertices + vertexCount),
+        Min{ vertices[0].x, vertices[0].y },
+        Max{ vertices[0].x, vertices[0].y }
+    {
+        for (const Vector3& vertex : Vertices)
+        {
+            Min[0] = dtMin(Min[0], vertex.x);
+            Min[1] = dtMin(Min[1], vertex.y);
+            Max[0] = dtMax(Max[0], vertex.x);
+            Max[1] = dtMax(Max[1], vertex.y);
+        }
+    }
+
+    inline bool IsBox() const noexcept { return Vertices.empty(); }
+
+    inline bool Contains(float x, float y) const noexcept
+    {
+        if (x < Min[0] || x > Max[0] || y < Min[1] || y > Max[1])
+            return false;
+
+        return IsBox() || PolygonMath::IsInside2D(Vertices.data(), static_cast<int>(Vertices.size()), Vector3(x, y, 0.0f));
+    }
+
+    /// 1 if the rectangle is completely inside, -1 if it does not touch the region, 0 if it has to be tested
+    /// per point. Polygons only report the outside case.
+    inline int Classify(float minX, float minY, float maxX, float maxY) const noexcept
+    {
+        if (maxX < Min[0] || minX > Max[0] || maxY < Min[1] || minY > Max[1])
+            return -1;
+
+        if (IsBox() && minX >= Min[0] && maxX <= Max[0] && minY >= Min[1] && maxY <= Max[1])
+            return 1;
+
+        return 0;
+    }
+};
+
+/// PolySearch constraint that rejects polys outside of a region. Whole tiles are decided by their bounds,
+/// polys of tiles on the border by their centroid.
+struct RegionConstraint
+{
+    const dtNavMesh* NavMesh;
+    const PathRegion* Region;
+
+    // neighbours are mostly in the same tile, remember the last classification
+    mutable const dtMeshTile* LastTile = nullptr;
+    mutable int LastTileClass = 0;
+
+    inline bool operator()(dtPolyRef ref) const noexcept
+    {
+        const dtMeshTile* tile = nullptr;
+        const dtPoly* poly = nullptr;
+        NavMesh->getTileAndPolyByRefUnsafe(ref, &tile, &poly);
+
+        if (tile != LastTile)
+        {
+            // navmesh (x, y, z) is wow (y, z, x)
+            const dtMeshHeader* header = tile->header;
+            LastTileClass = Region->Classify(header->bmin[2], header->bmin[0], header->bmax[2], header->bmax[0]);
+            LastTile = tile;
+        }
+
+        if (LastTileClass != 0)
+            return LastTileClass > 0;
+
+        float center[3];
+        PolyGraph::GetPolyCenter(tile, poly, center);
+        return Region->Contains(center[2], center[0]);
+    }
+};
+
+/// Combination of two PolySearch constraints, both have to accept a poly.
+template <typename First, typename Second>
+struct BothConstraints
+{
+    First A;
+    Second B;
+
+    inline bool operator()(dtPolyRef ref) const noexcept { return A(ref) && B(ref); }
+};
@@ -0,0 +1,9 @@
+#pragma once
+
+/// Opt-in search strategies for the path queries. Combine with bitwise OR.
+enum class PathSearchFlags : int
+{
+    NONE = 0,
+    LANDMARKS = 1 << 0,     // A* using the landmark (ALT) heuristic, falls back to findPath until the table is built
+    HIERARCHICAL = 1 << 1,  // Plan on the tile graph first and restrict the poly search to the tiles of that route
+};
@@ -0,0 +1,276 @@
+#pragma once
+
+#include <cstdint>
+#include <cstring>
+#include <vector>
+
+#include "../../../recastnavigation/Detour/Include/DetourCommon.h"
+#include "../../../recastnavigation/Detour/Include/DetourNavMesh.h"
+#include "../../../recastnavigation/Detour/Include/DetourNavMeshQuery.h"
+#include "../../../recastnavigation/Detour/Include/DetourNode.h"
+
+/// Low level helpers to walk the dtPolyRef graph of a dtNavMesh directly, used by the custom searches
+/// that dtNavMeshQuery cannot express (custom heuristics, multiple goals, cost bounds, ...).
+namespace PolyGraph
+{
+    /// Get the portal between two linked polys. Mirrors the private dtNavMeshQuery::getPortalPoints.
+    inline bool GetPortalPoints(dtPolyRef from, const dtPoly* fromPoly, const dtMeshTile* fromTile, dtPolyRef to,
+                                const dtPoly* toPoly, const dtMeshTile* toTile, float* left, float* right) noexcept
+    {
+        const dtLink* link = nullptr;
+
+        for (unsigned int i = fromPoly->firstLink; i != DT_NULL_LINK; i = fromTile->links[i].next)
+        {
+            if (fromTile->links[i].ref == to)
+            {
+                link = &fromTile->links[i];
+                break;
+            }
+        }
+
+        if (!link)
+            return false;
+
+        // off-mesh connections have a single point as portal
+        if (fromPoly->getType() == DT_POLYTYPE_OFFMESH_CONNECTION)
+        {
+            dtVcopy(left, &fromTile->verts[fromPoly->verts[link->edge] * 3]);
+            dtVcopy(right, left);
+            return true;
+        }
+
+        if (toPoly->getType() == DT_POLYTYPE_OFFMESH_CONNECTION)
+        {
+            for (unsigned int i = toPoly->firstLink; i != DT_NULL_LINK; i = toTile->links[i].next)
+            {
+                if (toTile->links[i].ref == from)
+                {
+                    dtVcopy(left, &toTile->verts[toPoly->verts[toTile->links[i].edge] * 3]);
+                    dtVcopy(right, left);
+                    return true;
+                }
+            }
+
+            return false;
+        }
+
+        const float* v0 = &fromTile->verts[fromPoly->verts[link->edge] * 3];
+        const float* v1 = &fromTile->verts[fromPoly->verts[(link->edge + 1) % fromPoly->vertCount] * 3];
+
+        // tile border links may only cover a part of the edge
+        if (link->side != 0xff && (link->bmin != 0 || link->bmax != 255))
+        {
+            constexpr float s = 1.0f / 255.0f;
+            dtVlerp(left, v0, v1, link->bmin * s);
+            dtVlerp(right, v0, v1, link->bmax * s);
+        }
+        else
+        {
+            dtVcopy(left, v0);
+            dtVcopy(right, v1);
+        }
+
+        return true;
+    }
+
+    /// Get the midpoint of the portal between two linked polys, used as search node position.
+    inline bool GetEdgeMidPoint(dtPolyRef from, const dtPoly* fromPoly, const dtMeshTile* fromTile, dtPolyRef to,
+                                const dtPoly* toPoly, const dtMeshTile* toTile, float* mid) noexcept
+    {
+        float left[3];
+        float right[3];
+
+        if (!GetPortalPoints(from, fromPoly, fromTile, to, toPoly, toTile, left, right))
+            return false;
+
+        dtVlerp(mid, left, right, 0.5f);
+        return true;
+    }
+
+    /// Get the centroid of a poly's vertices.
+    inline void GetPolyCenter(const dtMeshTile* tile, const dtPoly* poly, float* center) noexcept
+    {
+        center[0] = 0.0f;
+        center[1] = 0.0f;
+        center[2] = 0.0f;
+
+        for (int i = 0; i < poly->vertCount; ++i)
+        {
+            dtVadd(center, center, &tile->verts[poly->verts[i] * 3]);
+        }
+
+        dtVscale(center, center, 1.0f / static_cast<float>(poly->vertCount));
+    }
+
+    /// Whether a poly has a link to another one. Links are not symmetric, off-mesh connections without
+    /// DT_OFFMESH_CON_BIDIR are only linked in walking direction.
+    inline bool HasLink(const dtMeshTile* tile, const dtPoly* poly, dtPolyRef to) noexcept
+    {
+        for (unsigned int i = poly->firstLink; i != DT_NULL_LINK; i = tile->links[i].next)
+        {
+            if (tile->links[i].ref == to)
+                return true;
+        }
+
+        return false;
+    }
+
+    /// Whether a poly of the pool has a tile border edge without links, the neighbour tile is not loaded then.
+    inline bool HasMissingNeighbourTile(const dtNavMesh* nav, const dtNodePool* pool) noexcept
+    {
+        for (int n = 1; n <= pool->getNodeCount(); ++n)
+        {
+            const dtNode* node = pool->getNodeAtIdx(n);
+            const dtMeshTile* tile = nullptr;
+            const dtPoly* poly = nullptr;
+
+            if (!node->flags || dtStatusFailed(nav->getTileAndPolyByRef(node->id, &tile, &poly))
+                || poly->getType() != DT_POLYTYPE_GROUND)
+            {
+                continue;
+            }
+
+            for (unsigned char edge = 0; edge < poly->vertCount; ++edge)
+            {
+                if (!(poly->neis[edge] & DT_EXT_LINK))
+                    continue;
+
+                bool linked = false;
+
+                for (unsigned int i = poly->firstLink; i != DT_NULL_LINK && !linked; i = tile->links[i].next)
+                {
+                    linked = tile->links[i].edge == edge;
+                }
+
+                if (!linked)
+                    return true;
+            }
+        }
+
+        return false;
+    }
+
+    /// Same as dtQueryFilter::passFilter, which is only defined inline inside DetourNavMeshQuery.cpp
+    /// and therefore not callable from outside of Detour.
+    inline bool PassFilter(const dtQueryFilter* filter, const dtPoly* poly) noexcept
+    {
+        return (poly->flags & filter->getIncludeFlags()) != 0 && (poly->flags & filter->getExcludeFlags()) == 0;
+    }
+
+    /// Same as dtQueryFilter::getCost, cost to move from pa to pb inside of curPoly.
+    inline float GetCost(const dtQueryFilter* filter, const float* pa, const float* pb, const dtPoly* curPoly) noexcept
+    {
+        return dtVdist(pa, pb) * filter->getAreaCost(curPoly->getArea());
+    }
+
+    /// Lowest area cost of a filter, scales distance based heuristics so they stay a lower bound.
+    inline float GetMinAreaCost(const dtQueryFilter* filter) noexcept
+    {
+        float minCost = filter->getAreaCost(0);
+
+        for (int i = 1; i < DT_MAX_AREAS; ++i)
+        {
+            minCost = dtMin(minCost, filter->getAreaCost(i));
+        }
+
+        return dtMax(minCost, 0.0f);
+    }
+
+    /// Hash of everything that influences the costs of a filter, filters with the same signature produce the same
+    /// search results and can share cached costs.
+    inline uint64_t GetFilterSignature(const dtQueryFilter* filter) noexcept
+    {
+        uint64_t hash = 14695981039346656037ull;
+
+        const auto mix = [&hash](uint32_t value) noexcept
+        {
+            hash ^= value;
+            hash *= 1099511628211ull;
+        };
+
+        mix(filter->getIncludeFlags());
+        mix(filter->getExcludeFlags());
+
+        for (int i = 0; i < DT_MAX_AREAS; ++i)
+        {
+            const float cost = filter->getAreaCost(i);
+            uint32_t bits;
+            std::memcpy(&bits, &cost, sizeof(bits));
+            mix(bits);
+        }
+
+        return hash;
+    }
+
+    /// Maps the dtPolyRef's of a navmesh to a dense [0, PolyCount) index range, so per poly data can be
+    /// stored in flat arrays. Only valid for the tile set the navmesh had when Build() was called.
+    class PolyIndexer
+    {
+        const dtNavMesh* NavMesh;
+        int PolyCount;
+        std::vector<int> TileOffsets;
+
+    public:
+        PolyIndexer() noexcept : NavMesh(nullptr), PolyCount(0), TileOffsets() {}
+
+        void Build(const dtNavMesh* navMesh)
+        {
+            NavMesh = navMesh;
+            PolyCount = 0;
+            TileOffsets.assign(navMesh->getMaxTiles(), -1);
+
+            for (int i = 0; i < navMesh->getMaxTiles(); ++i)
+            {
+                const dtMeshTile* tile = navMesh->getTile(i);
+
+                if (tile && tile->header)
+                {
+                    TileOffsets[i] = PolyCount;
+                    PolyCount += tile->header->polyCount;
+                }
+            }
+        }
+
+        constexpr inline const dtNavMesh* GetNavMesh() const noexcept { return NavMesh; }
+        constexpr inline int GetPolyCount() const noexcept { return PolyCount; }
+
+        /// Dense index of a poly, -1 if the poly belongs to a tile that was not present on Build().
+        inline int Get(dtPolyRef ref) const noexcept
+        {
+            const unsigned int it = NavMesh->decodePolyIdTile(ref);
+
+            if (it >= TileOffsets.size() || TileOffsets[it] < 0)
+                return -1;
+
+            return TileOffsets[it] + static_cast<int>(NavMesh->decodePolyIdPoly(ref));
+        }
+
+        /// dtPolyRef for every dense index, the inverse of Get().
+        std::vector<dtPolyRef> BuildRefs() const
+        {
+            std::vector<dtPolyRef> refs(PolyCount);
+
+            for (int i = 0; i < NavMesh->getMaxTiles(); ++i)
+            {
+                if (TileOffsets[i] < 0)
+                    continue;
+
+                const dtMeshTile* tile = NavMesh->getTile(i);
+                const dtPolyRef base = NavMesh->getPolyRefBase(tile);
+
+                for (int p = 0; p < tile->header->polyCount; ++p)
+                {
+                    refs[TileOffsets[i] + p] = base | static_cast<dtPolyRef>(p);
+                }
+            }
+
+            return refs;
+        }
+
+        /// Dense index of the first poly of a tile, -1 if the tile was not present on Build().
+        inline int GetTileOffset(int tileIndex) const noexcept
+        {
+            return tileIndex >= 0 && tileIndex < static_cast<int>(TileOffsets.size()) ? TileOffsets[tileIndex] : -1;
+        }
+    };
+}
@@ -0,0 +1,510 @@
+#pragma once
+
+#include <limits>
+#include <memory>
+
+#include "../../../recastnavigation/Detour/Include/DetourCommon.h"
+#include "../../../recastnavigation/Detour/Include/DetourNavMesh.h"
+#include "../../../recastnavigation/Detour/Include/DetourNavMeshQuery.h"
+#include "../../../recastnavigation/Detour/Include/DetourNode.h"
+
+#include "PolyGraph.hpp"
+
+/// Heuristic scale used by dtNavMeshQuery::findPath, keeps the euclidean estimate slightly below the real cost.
+constexpr float POLY_SEARCH_H_SCALE = 0.999f;
+
+/// Plain euclidean heuristic, same as the one used by dtNavMeshQuery::findPath.
+struct EuclideanHeuristic
+{
+    const float* EndPos;
+
+    inline float operator()(dtPolyRef, const float* pos) const noexcept
+    {
+        return dtVdist(pos, EndPos) * POLY_SEARCH_H_SCALE;
+    }
+};
+
+/// Constraint that accepts every poly, used when a search is not restricted to a part of the navmesh.
+struct AnyPoly
+{
+    constexpr inline bool operator()(dtPolyRef) const noexcept { return true; }
+};
+
+/// One target of PolySearch::FindGoals, Ref and Pos are inputs, the rest is filled in by the search.
+struct PolySearchGoal
+{
+    dtPolyRef Ref;
+    float Pos[3];
+    float Cost;         // cost from the start, negative if the goal was not reached
+    float Length;       // length of the corridor through the portal midpoints
+    const dtNode* Node; // last node of the corridor, only valid until the next search
+};
+
+/// Distance to the closest of a set of goals. It is only consistent, and the costs FindGoals settles only
+/// minimal, if the goal set does not change and CostScale is at most the lowest area cost of the filter.
+struct NearestGoalHeuristic
+{
+    const PolySearchGoal* Goals;
+    int GoalCount;
+    float CostScale = 1.0f;
+
+    inline float operator()(dtPolyRef, const float* pos) const noexcept
+    {
+        float best = std::numeric_limits<float>::max();
+
+        for (int i = 0; i < GoalCount; ++i)
+        {
+            best = dtMin(best, dtVdistSqr(pos, Goals[i].Pos));
+        }
+
+        return dtMathSqrtf(best) * POLY_SEARCH_H_SCALE * CostScale;
+    }
+};
+
+/// A* search over the dtPolyRef graph with its own node pool. Behaves like dtNavMeshQuery::findPath but
+/// accepts a custom heuristic and reports how many nodes were expanded.
+class PolySearch
+{
+    int MaxNodes;
+    std::unique_ptr<dtNodePool> NodePool;
+    std::unique_ptr<dtNodeQueue> OpenList;
+    int LastExpandedNodes;
+
+public:
+    PolySearch(int maxNodes)
+        : MaxNodes(maxNodes),
+        NodePool(std::make_unique<dtNodePool>(maxNodes, dtNextPow2(dtMax(maxNodes / 4, 1)))),
+        OpenList(std::make_unique<dtNodeQueue>(maxNodes)),
+        LastExpandedNodes(0)
+    {}
+
+    ~PolySearch() = default;
+
+    PolySearch(const PolySearch&) = delete;
+    PolySearch& operator=(const PolySearch&) = delete;
+
+    constexpr inline int GetMaxNodes() const noexcept { return MaxNodes; }
+
+    /// Number of nodes closed by the last search, useful to compare heuristics.
+    constexpr inline int GetLastExpandedNodes() const noexcept { return LastExpandedNodes; }
+
+    /// Find a poly corridor from startRef to endRef. Heuristic is called as h(ref, pos) and has to return an
+    /// estimate of the remaining cost, constraint(ref) can reject polys in addition to the filter.
+    /// Returns the same status codes as dtNavMeshQuery::findPath.
+    template <typename Heuristic, typename Constraint = AnyPoly>
+    dtStatus FindPath(const dtNavMesh* nav, dtPolyRef startRef, dtPolyRef endRef, const float* startPos,
+                      const float* endPos, const dtQueryFilter* filter, const Heuristic& heuristic, dtPolyRef* path,
+                      int* pathCount, int maxPath, const Constraint& constraint = Constraint()) noexcept
+    {
+        LastExpandedNodes = 0;
+
+        if (!pathCount)
+            return DT_FAILURE | DT_INVALID_PARAM;
+
+        *pathCount = 0;
+
+        if (!nav || !nav->isValidPolyRef(startRef) || !nav->isValidPolyRef(endRef) || !startPos
+            || !dtVisfinite(startPos) || !endPos || !dtVisfinite(endPos) || !filter || !path || maxPath <= 0)
+        {
+            return DT_FAILURE | DT_INVALID_PARAM;
+        }
+
+        if (startRef == endRef)
+        {
+            path[0] = startRef;
+            *pathCount = 1;
+            return DT_SUCCESS;
+        }
+
+        NodePool->clear();
+        OpenList->clear();
+
+        dtNode* startNode = NodePool->getNode(startRef);
+        dtVcopy(startNode->pos, startPos);
+        startNode->pidx = 0;
+        startNode->cost = 0.0f;
+        startNode->total = heuristic(startRef, startPos);
+        startNode->id = startRef;
+        startNode->flags = DT_NODE_OPEN;
+        OpenList->push(startNode);
+
+        dtNode* lastBestNode = startNode;
+        float lastBestNodeCost = startNode->total;
+        bool outOfNodes = false;
+
+        while (!OpenList->empty())
+        {
+            dtNode* bestNode = OpenList->pop();
+            bestNode->flags &= ~DT_NODE_OPEN;
+            bestNode->flags |= DT_NODE_CLOSED;
+            ++LastExpandedNodes;
+
+            if (bestNode->id == endRef)
+            {
+                lastBestNode = bestNode;
+                break;
+            }
+
+            const dtPolyRef bestRef = bestNode->id;
+            const dtMeshTile* bestTile = nullptr;
+            const dtPoly* bestPoly = nullptr;
+            nav->getTileAndPolyByRefUnsafe(bestRef, &bestTile, &bestPoly);
+
+            const dtPolyRef parentRef = bestNode->pidx ? NodePool->getNodeAtIdx(bestNode->pidx)->id : 0;
+
+            for (unsigned int i = bestPoly->firstLink; i != DT_NULL_LINK; i = bestTile->links[i].next)
+            {
+                const dtPolyRef neighbourRef = bestTile->links[i].ref;
+
+                if (!neighbourRef || neighbourRef == parentRef)
+                    continue;
+
+                const dtMeshTile* neighbourTile = nullptr;
+                const dtPoly* neighbourPoly = nullptr;
+                nav->getTileAndPolyByRefUnsafe(neighbourRef, &neighbourTile, &neighbourPoly);
+
+                if (!PolyGraph::PassFilter(filter, neighbourPoly) || !constraint(neighbourRef))
+                    continue;
+
+                // tile border crossings get their own node state, like in dtNavMeshQuery
+                const unsigned char crossSide = bestTile->links[i].side != 0xff ? bestTile->links[i].side >> 1 : 0;
+                dtNode* neighbourNode = NodePool->getNode(neighbourRef, crossSide);
+
+                if (!neighbourNode)
+                {
+                    outOfNodes = true;
+                    continue;
+                }
+
+                if (neighbourNode->flags == 0)
+                {
+                    PolyGraph::GetEdgeMidPoint(bestRef, bestPoly, bestTile, neighbourRef, neighbourPoly,
+                                               neighbourTile, neighbourNode->pos);
+                }
+
+                float cost = bestNode->cost + PolyGraph::GetCost(filter, bestNode->pos, neighbourNode->pos, bestPoly);
+                float h = 0.0f;
+
+                if (neighbourRef == endRef)
+                {
+                    cost += PolyGraph::GetCost(filter, neighbourNode->pos, endPos, neighbourPoly);
+                }
+                else
+                {
+                    h = heuristic(neighbourRef, neighbourNode->pos);
+                }
+
+                const float total = cost + h;
+
+                if ((neighbourNode->flags & DT_NODE_OPEN) && total >= neighbourNode->total)
+                    continue;
+
+                if ((neighbourNode->flags & DT_NODE_CLOSED) && total >= neighbourNode->total)
+                    continue;
+
+                neighbourNode->pidx = NodePool->getNodeIdx(bestNode);
+                neighbourNode->id = neighbourRef;
+                neighbourNode->flags = (neighbourNode->flags & ~DT_NODE_CLOSED);
+                neighbourNode->cost = cost;
+                neighbourNode->total = total;
+
+                if (neighbourNode->flags & DT_NODE_OPEN)
+                {
+                    OpenList->modify(neighbourNode);
+                }
+                else
+                {
+                    neighbourNode->flags |= DT_NODE_OPEN;
+                    OpenList->push(neighbourNode);
+                }
+
+                if (h < lastBestNodeCost)
+                {
+                    lastBestNodeCost = h;
+                    lastBestNode = neighbourNode;
+                }
+            }
+        }
+
+        dtStatus status = GetPathToNode(lastBestNode, path, pathCount, maxPath);
+
+        if (lastBestNode->id != endRef)
+            status |= DT_PARTIAL_RESULT;
+
+        if (outOfNodes)
+            status |= DT_OUT_OF_NODES;
+
+        return status;
+    }
+
+    /// Search from one start towards several goals at once, the expansion continues until stopAfter goals
+    /// have been reached, no open node is left below maxCost or the node pool is exhausted. Costs of reached
+    /// goals include the segment from the goal poly's portal to the goal position, a goal is only settled once
+    /// no open node can reach it cheaper, goals are settled cheapest first. Returns DT_SUCCESS if stopAfter
+    /// goals were reached, DT_PARTIAL_RESULT otherwise.
+    template <typename Heuristic, typename Constraint = AnyPoly>
+    dtStatus FindGoals(const dtNavMesh* nav, dtPolyRef startRef, const float* startPos, const dtQueryFilter* filter,
+                       const Heuristic& heuristic, PolySearchGoal* goals, int goalCount, int stopAfter,
+                       float maxCost = std::numeric_limits<float>::max(),
+                       const Constraint& constraint = Constraint()) noexcept
+    {
+        LastExpandedNodes = 0;
+
+        if (!nav || !nav->isValidPolyRef(startRef) || !startPos || !dtVisfinite(startPos) || !filter || !goals
+            || goalCount <= 0)
+        {
+            return DT_FAILURE | DT_INVALID_PARAM;
+        }
+
+        for (int i = 0; i < goalCount; ++i)
+        {
+            goals[i].Cost = -1.0f;
+            goals[i].Length = -1.0f;
+            goals[i].Node = nullptr;
+        }
+
+        NodePool->clear();
+        OpenList->clear();
+
+        dtNode* startNode = NodePool->getNode(startRef);
+        dtVcopy(startNode->pos, startPos);
+        startNode->pidx = 0;
+        startNode->cost = 0.0f;
+        startNode->total = heuristic(startRef, startPos);
+        startNode->id = startRef;
+        startNode->flags = DT_NODE_OPEN;
+        OpenList->push(startNode);
+
+        int reached = 0;
+        bool outOfNodes = false;
+        stopAfter = dtMin(stopAfter, goalCount);
+
+        {
+            const dtMeshTile* startTile = nullptr;
+            const dtPoly* startPoly = nullptr;
+            nav->getTileAndPolyByRefUnsafe(startRef, &startTile, &startPoly);
+            OfferGoals(filter, startNode, startPoly, goals, goalCount, maxCost);
+        }
+
+        while (!OpenList->empty() && reached < stopAfter)
+        {
+            dtNode* bestNode = OpenList->pop();
+
+            // nothing still open reaches a goal below the lowest total, candidates up to it are final
+            reached = SettleGoals(goals, goalCount, bestNode->total, reached, stopAfter);
+
+            if (reached >= stopAfter || bestNode->total > maxCost)
+                break;
+
+            bestNode->flags &= ~DT_NODE_OPEN;
+            bestNode->flags |= DT_NODE_CLOSED;
+            ++LastExpandedNodes;
+
+            const dtPolyRef bestRef = bestNode->id;
+            const dtMeshTile* bestTile = nullptr;
+            const dtPoly* bestPoly = nullptr;
+            nav->getTileAndPolyByRefUnsafe(bestRef, &bestTile, &bestPoly);
+
+            const dtPolyRef parentRef = bestNode->pidx ? NodePool->getNodeAtIdx(bestNode->pidx)->id : 0;
+
+            for (unsigned int i = bestPoly->firstLink; i != DT_NULL_LINK; i = bestTile->links[i].next)
+            {
+                const dtPolyRef neighbourRef = bestTile->links[i].ref;
+
+                if (!neighbourRef || neighbourRef == parentRef)
+                    continue;
+
+                const dtMeshTile* neighbourTile = nullptr;
+                const dtPoly* neighbourPoly = nullptr;
+                nav->getTileAndPolyByRefUnsafe(neighbourRef, &neighbourTile, &neighbourPoly);
+
+                if (!PolyGraph::PassFilter(filter, neighbourPoly) || !constraint(neighbourRef))
+                    continue;
+
+                const unsigned char crossSide = bestTile->links[i].side != 0xff ? bestTile->links[i].side >> 1 : 0;
+                dtNode* neighbourNode = NodePool->getNode(neighbourRef, crossSide);
+
+                if (!neighbourNode)
+                {
+                    outOfNodes = true;
+                    continue;
+                }
+
+                if (neighbourNode->flags == 0)
+                {
+                    PolyGraph::GetEdgeMidPoint(bestRef, bestPoly, bestTile, neighbourRef, neighbourPoly,
+                                               neighbourTile, neighbourNode->pos);
+                }
+
+                const float cost = bestNode->cost
+                    + PolyGraph::GetCost(filter, bestNode->pos, neighbourNode->pos, bestPoly);
+                const float total = cost + heuristic(neighbourRef, neighbourNode->pos);
+
+                // the heuristic is a lower bound, nothing behind this node can stay below maxCost
+                if (total > maxCost)
+                    continue;
+
+                if ((neighbourNode->flags & DT_NODE_OPEN) && total >= neighbourNode->total)
+                    continue;
+
+                if ((neighbourNode->flags & DT_NODE_CLOSED) && total >= neighbourNode->total)
+                    continue;
+
+                neighbourNode->pidx = NodePool->getNodeIdx(bestNode);
+                neighbourNode->id = neighbourRef;
+                neighbourNode->flags = (neighbourNode->flags & ~DT_NODE_CLOSED);
+                neighbourNode->cost = cost;
+                neighbourNode->total = total;
+
+                if (neighbourNode->flags & DT_NODE_OPEN)
+                {
+                    OpenList->modify(neighbourNode);
+                }
+                else
+                {
+                    neighbourNode->flags |= DT_NODE_OPEN;
+                    OpenList->push(neighbourNode);
+                }
+
+                OfferGoals(filter, neighbourNode, neighbourPoly, goals, goalCount, maxCost);
+            }
+        }
+
+        // the search is exhausted, the remaining candidates are the best there are
+        if (OpenList->empty())
+            reached = SettleGoals(goals, goalCount, std::numeric_limits<float>::max(), reached, stopAfter);
+
+        // candidates that were not settled are not reported
+        for (int i = 0; i < goalCount; ++i)
+        {
+            if (goals[i].Length < 0.0f)
+            {
+                goals[i].Cost = -1.0f;
+                goals[i].Node = nullptr;
+            }
+        }
+
+        dtStatus status = reached >= stopAfter ? DT_SUCCESS : DT_SUCCESS | DT_PARTIAL_RESULT;
+
+        if (outOfNodes)
+            status |= DT_OUT_OF_NODES;
+
+        return status;
+    }
+
+    /// Corridor of a goal reached by the last FindGoals call, same status codes as FindPath.
+    dtStatus GetGoalPath(const PolySearchGoal& goal, dtPolyRef* path, int* pathCount, int maxPath) const noexcept
+    {
+        if (!goal.Node || !path || !pathCount || maxPath <= 0)
+            return DT_FAILURE | DT_INVALID_PARAM;
+
+        return GetPathToNode(goal.Node, path, pathCount, maxPath);
+    }
+
+    /// Whether the last search expanded a poly next to a tile that is not loaded, the nodes are only those of
+    /// the last search if ClearNodes was called before it.
+    bool ReachedMissingTile(const dtNavMesh* nav) const noexcept
+    {
+        return PolyGraph::HasMissingNeighbourTile(nav, NodePool.get());
+    }
+
+    /// Forget the nodes of previous searches.
+    void ClearNodes() noexcept
+    {
+        NodePool->clear();
+    }
+
+private:
+    /// Record node as the way to the goals on its poly that it reaches cheaper than before. Unsettled goals
+    /// keep their best candidate in Cost and Node, Length stays negative until they are settled.
+    static inline void OfferGoals(const dtQueryFilter* filter, dtNode* node, const dtPoly* poly,
+                                  PolySearchGoal* goals, int goalCount, float maxCost) noexcept
+    {
+        for (int i = 0; i < goalCount; ++i)
+        {
+            PolySearchGoal& goal = goals[i];
+
+            if (goal.Ref != node->id || goal.Length >= 0.0f)
+                continue;
+
+            const float cost = node->cost + PolyGraph::GetCost(filter, node->pos, goal.Pos, poly);
+
+            if (cost <= maxCost && (!goal.Node || cost < goal.Cost))
+            {
+                goal.Cost = cost;
+                goal.Node = node;
+            }
+        }
+    }
+
+    /// Settle the candidates that cost at most bound, cheapest first, until stopAfter goals are reached.
+    /// Returns the new number of reached goals.
+    int SettleGoals(PolySearchGoal* goals, int goalCount, float bound, int reached, int stopAfter) const noexcept
+    {
+        while (reached < stopAfter)
+        {
+            PolySearchGoal* cheapest = nullptr;
+
+            for (int i = 0; i < goalCount; ++i)
+            {
+                if (goals[i].Node && goals[i].Length < 0.0f && goals[i].Cost <= bound
+                    && (!cheapest || goals[i].Cost < cheapest->Cost))
+                {
+                    cheapest = &goals[i];
+                }
+            }
+
+            if (!cheapest)
+                break;
+
+            cheapest->Length = GetCorridorLength(cheapest->Node) + dtVdist(cheapest->Node->pos, cheapest->Pos);
+            ++reached;
+        }
+
+        return reached;
+    }
+
+    /// Sum of the segments between the node positions from the start to a node.
+    float GetCorridorLength(const dtNode* endNode) const noexcept
+    {
+        float length = 0.0f;
+
+        for (const dtNode* node = endNode; node->pidx; )
+        {
+            const dtNode* parent = NodePool->getNodeAtIdx(node->pidx);
+            length += dtVdist(node->pos, parent->pos);
+            node = parent;
+        }
+
+        return length;
+    }
+
+    /// Walk the parent chain of a node and write the corridor in start to end order.
+    dtStatus GetPathToNode(const dtNode* endNode, dtPolyRef* path, int* pathCount, int maxPath) const noexcept
+    {
+        int length = 0;
+
+        for (const dtNode* node = endNode; node; node = NodePool->getNodeAtIdx(node->pidx))
+        {
+            ++length;
+        }
+
+        // if the path does not fit, keep the part closest to the start
+        const dtNode* node = endNode;
+        int writeCount = length;
+
+        for (; writeCount > maxPath; --writeCount)
+        {
+            node = NodePool->getNodeAtIdx(node->pidx);
+        }
+
+        for (int i = writeCount - 1; i >= 0; --i)
+        {
+            path[i] = node->id;
+            node = NodePool->getNodeAtIdx(node->pidx);
+        }
+
+        *pathCount = dtMin(length, maxPath);
+        return length > maxPath ? DT_SUCCESS | DT_BUFFER_TOO_SMALL : DT_SUCCESS;
+    }
+};
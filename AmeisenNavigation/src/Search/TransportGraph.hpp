@@ -0,0 +1,345 @@
+#pragma once
+
+#include <algorithm>
+#include <cstdint>
+#include <filesystem>
+#include <fstream>
+#include <functional>
+#include <limits>
+#include <mutex>
+#include <queue>
+#include <sstream>
+#include <string>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+#include "../Utils/PathCost.hpp"
+#include "../Utils/Vector3.hpp"
+
+/// Transition from one map to another (or across one map), a portal, boat, zeppelin or dungeon entrance.
+/// Positions are in wow coordinates.
+struct Transport
+{
+    int Id;
+    int FromMapId;
+    Vector3 From;
+    int ToMapId;
+    Vector3 To;
+    float Cost; // path cost of the ride itself, in the units of walking costs
+    std::string Name;
+};
+
+/// One leg of a cross map route. Walking legs (TransportId -1) stay on MapId, transport legs start at the
+/// departure on MapId and end at the arrival on EndMapId.
+struct RouteLeg
+{
+    int TransportId;
+    int MapId;
+    Vector3 Start;
+    int EndMapId;
+    Vector3 End;
+    float Cost;
+};
+
+/// <summary>
+/// Graph of the transports between maps. Routes are found by Dijkstra over the arrivals of the transports,
+/// the walking costs on a map are asked for on demand, one search from a position to every departure of its
+/// map, so only maps the route can actually use get searched. Costs from an arrival to the departures of its
+/// map do not depend on the request and are cached per filter.
+///
+/// The data file has one transport per line, lines starting with # are comments:
+///
+///   id fromMap fromX fromY fromZ toMap toX toY toZ cost [name]
+///
+/// Transports only go one way, a boat that goes both ways needs a line for each direction.
+/// </summary>
+class TransportGraph
+{
+    struct CostKey
+    {
+        int Transport;
+        uint64_t Filter;
+
+        constexpr inline bool operator==(const CostKey& other) const noexcept
+        {
+            return Transport == other.Transport && Filter == other.Filter;
+        }
+    };
+
+    struct CostKeyHash
+    {
+        inline size_t operator()(const CostKey& key) const noexcept
+        {
+            const uint64_t hash = (key.Filter ^ static_cast<uint64_t>(key.Transport)) * 0x9E3779B97F4A7C15ull;
+            return static_cast<size_t>(hash ^ (hash >> 32));
+        }
+    };
+
+    std::vector<Transport> Transports;
+    std::unordered_map<int, std::vector<int>> Departures; // map id -> indices of the transports leaving it
+
+    // arrival of a transport -> costs to the departures of its map, in the order of Departures
+    mutable std::mutex CostMutex;
+    std::unordered_map<CostKey, std::vector<float>, CostKeyHash> ArrivalCosts;
+
+public:
+    /// Walking costs from a position to several targets on one map, false if the position is not on the mesh.
+    using WalkCostFn = std::function<bool(int mapId, const Vector3& from, const Vector3* targets, int targetCount,
+                                          PathCost* costs)>;
+
+    TransportGraph() noexcept
+        : Transports(),
+        Departures(),
+        CostMutex(),
+        ArrivalCosts()
+    {}
+
+    TransportGraph(const TransportGraph&) = delete;
+    TransportGraph& operator=(const TransportGraph&) = delete;
+
+    /// Read the transports from a data file, returns the number of transports or -1 if the file could not
+    /// be opened. Malformed lines are skipped and reported in invalidLines.
+    int Load(const std::filesystem::path& file, int* invalidLines = nullptr)
+    {
+        std::ifstream in(file);
+
+        if (!in.is_open())
+            return -1;
+
+        int invalid = 0;
+
+        for (std::string line; std::getline(in, line);)
+        {
+            const size_t first = line.find_first_not_of(" \t\r");
+
+            if (first == std::string::npos || line[first] == '#')
+                continue;
+
+            std::istringstream fields(line);
+            Transport transport{};
+
+            if (!(fields >> transport.Id >> transport.FromMapId >> transport.From.x >> transport.From.y
+                  >> transport.From.z >> transport.ToMapId >> transport.To.x >> transport.To.y >> transport.To.z
+                  >> transport.Cost)
+                || transport.Cost < 0.0f)
+            {
+                ++invalid;
+                continue;
+            }
+
+            std::getline(fields >> std::ws, transport.Name);
+
+            while (!transport.Name.empty() && (transport.Name.back() == '\r' || transport.Name.back() == ' '))
+                transport.Name.pop_back();
+
+            Departures[transport.FromMapId].push_back(static_cast<int>(Transports.size()));
+            Transports.push_back(std::move(transport));
+        }
+
+        if (invalidLines)
+            *invalidLines = invalid;
+
+        return static_cast<int>(Transports.size());
+    }
+
+    inline const std::vector<Transport>& GetTransports() const noexcept { return Transports; }
+
+    /// Drop the cached costs on a map, after its navmesh changed.
+    inline void Invalidate(int mapId) noexcept
+    {
+        const std::lock_guard lock(CostMutex);
+
+        std::erase_if(ArrivalCosts, [this, mapId](const auto& entry)
+        {
+            return Transports[entry.first.Transport].ToMapId == mapId;
+        });
+    }
+
+    /// Cheapest route from start on startMapId to end on endMapId, walking and taking transports. legs is
+    /// set to the legs in order, walking legs only carry their endpoints, their paths are left to the caller.
+    /// filter is the signature of the filter walkCosts searches with, for the cache. Returns false if end can
+    /// not be reached.
+    bool FindRoute(int startMapId, const Vector3& start, int endMapId, const Vector3& end, uint64_t filter,
+                   const WalkCostFn& walkCosts, std::vector<RouteLeg>& legs, float* totalCost = nullptr)
+    {
+        legs.clear();
+
+        // nodes are the start, the arrival of every transport and the end
+        const int transportCount = static_cast<int>(Transports.size());
+        const int startNode = transportCount;
+        const int endNode = transportCount + 1;
+
+        constexpr float UNREACHED = std::numeric_limits<float>::max();
+        std::vector<float> costs(transportCount + 2, UNREACHED);
+        std::vector<int> previous(transportCount + 2, -1);
+        std::vector<bool> settled(transportCount + 2, false);
+
+        using OpenEntry = std::pair<float, int>;
+        std::priority_queue<OpenEntry, std::vector<OpenEntry>, std::greater<OpenEntry>> open;
+        costs[startNode] = 0.0f;
+        open.emplace(0.0f, startNode);
+
+        const auto relax = [&](int node, int from, float cost)
+        {
+            if (cost < costs[node])
+            {
+                costs[node] = cost;
+                previous[node] = from;
+                open.emplace(cost, node);
+            }
+        };
+
+        while (!open.empty())
+        {
+            const auto [cost, node] = open.top();
+            open.pop();
+
+            if (settled[node] || cost > costs[node])
+                continue;
+
+            settled[node] = true;
+
+            if (node == endNode)
+                break;
+
+            const int mapId = node == startNode ? startMapId : Transports[node].ToMapId;
+            const Vector3& position = node == startNode ? start : Transports[node].To;
+            const auto departures = Departures.find(mapId);
+            const std::vector<int>* departureList = departures != Departures.end() ? &departures->second : nullptr;
+
+            std::vector<float> departureCosts;
+            float endCost = -1.0f;
+
+            if (!GetWalkCosts(node == startNode ? -1 : node, mapId, position, departureList,
+                              mapId == endMapId ? &end : nullptr, filter, walkCosts, departureCosts, endCost))
+            {
+                continue;
+            }
+
+            if (endCost >= 0.0f)
+                relax(endNode, node, cost + endCost);
+
+            for (size_t i = 0; departureList && i < departureList->size(); ++i)
+            {
+                const int transport = (*departureList)[i];
+
+                if (departureCosts[i] >= 0.0f && !settled[transport])
+                    relax(transport, node, cost + departureCosts[i] + Transports[transport].Cost);
+            }
+        }
+
+        if (!settled[endNode])
+            return false;
+
+        // walk back from the end, every transport node adds the walk to its departure and the ride
+        std::vector<int> nodes;
+
+        for (int node = endNode; node != -1; node = previous[node])
+            nodes.push_back(node);
+
+        std::reverse(nodes.begin(), nodes.end());
+
+        for (size_t i = 1; i < nodes.size(); ++i)
+        {
+            const int from = nodes[i - 1];
+            const int to = nodes[i];
+            const int mapId = from == startNode ? startMapId : Transports[from].ToMapId;
+            const Vector3& position = from == startNode ? start : Transports[from].To;
+
+            if (to == endNode)
+            {
+                legs.push_back(RouteLeg{ -1, mapId, position, mapId, end, costs[to] - costs[from] });
+                continue;
+            }
+
+            const Transport& transport = Transports[to];
+            const float walkCost = costs[to] - costs[from] - transport.Cost;
+
+            // arriving right at the next departure, a portal room for example, needs no walking leg
+            if (!(position == transport.From))
+                legs.push_back(RouteLeg{ -1, mapId, position, mapId, transport.From, walkCost });
+
+            legs.push_back(RouteLeg{ transport.Id, transport.FromMapId, transport.From, transport.ToMapId,
+                                     transport.To, transport.Cost });
+        }
+
+        if (totalCost)
+            *totalCost = costs[endNode];
+
+        return true;
+    }
+
+private:
+    /// Walking costs from position to the departures (-1 if unreachable) and to end if given. Costs from an
+    /// arrival to the departures come from the cache when they were searched before. Unreachable departures
+    /// are searched again every time, the search may only have failed for now (out of nodes, tiles of a
+    /// streamed map that were not loaded).
+    bool GetWalkCosts(int arrival, int mapId, const Vector3& position, const std::vector<int>* departures,
+                      const Vector3* end, uint64_t filter, const WalkCostFn& walkCosts,
+                      std::vector<float>& departureCosts, float& endCost)
+    {
+        const int departureCount = departures ? static_cast<int>(departures->size()) : 0;
+        bool cached = false;
+
+        if (arrival >= 0)
+        {
+            const std::lock_guard lock(CostMutex);
+
+            if (auto it = ArrivalCosts.find(CostKey{ arrival, filter }); it != ArrivalCosts.end())
+            {
+                departureCosts = it->second;
+                cached = true;
+            }
+        }
+
+        if (!cached)
+            departureCosts.assign(departureCount, -1.0f);
+
+        // departures to search, by index into departureCosts
+        std::vector<int> searched;
+        std::vector<Vector3> targets;
+        searched.reserve(departureCount);
+        targets.reserve(departureCount + 1);
+
+        for (int i = 0; i < departureCount; ++i)
+        {
+            if (departureCosts[i] < 0.0f)
+            {
+                searched.push_back(i);
+                targets.push_back(Transports[(*departures)[i]].From);
+            }
+        }
+
+        if (end)
+            targets.push_back(*end);
+
+        // every departure is known already, or the map has none and is not the destination: a dead end
+        if (targets.empty())
+            return cached;
+
+        std::vector<PathCost> targetCosts(targets.size());
+
+        if (!walkCosts(mapId, position, targets.data(), static_cast<int>(targets.size()), targetCosts.data()))
+            return cached;
+
+        if (end)
+            endCost = targetCosts.back().cost;
+
+        bool found = false;
+
+        for (size_t i = 0; i < searched.size(); ++i)
+        {
+            departureCosts[searched[i]] = targetCosts[i].cost;
+            found |= targetCosts[i].cost >= 0.0f;
+        }
+
+        if (arrival >= 0 && found)
+        {
+            const std::lock_guard lock(CostMutex);
+            ArrivalCosts.insert_or_assign(CostKey{ arrival, filter }, departureCosts);
+        }
+
+        return true;
+    }
+};
@@ -0,0 +1,12 @@
+#pragma once
+
+/// Load state of a map as reported to clients. Maps answer queries from INDEXING on, the search indexes
+/// only make some of them faster.
+enum class MapLoadState : int
+{
+    NOT_LOADED = 0, // Neither preloaded nor queried yet, the first query loads it
+    LOADING = 1,    // Being preloaded
+    INDEXING = 2,   // Loaded, the search indexes are still being built
+    READY = 3,      // Loaded and indexed
+    FAILED = 4,     // There is no navmesh for the map
+};
@@ -0,0 +1,50 @@
+#pragma once
+
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+
+#include "../../../recastnavigation/Detour/Include/DetourNavMesh.h"
+
+/// Last use of a loaded map. Shared with the clients querying the map, so they can mark it as used without
+/// taking a lock.
+struct MapUsage
+{
+    std::atomic<int64_t> LastUsed{ Now() };
+    std::atomic<bool> Pinned{ false }; // preloaded maps are never unloaded
+
+    inline void Touch() noexcept { LastUsed.store(Now(), std::memory_order_relaxed); }
+
+    /// Seconds on the steady clock.
+    static inline int64_t Now() noexcept
+    {
+        return std::chrono::duration_cast<std::chrono::seconds>(
+            std::chrono::steady_clock::now().time_since_epoch()).count();
+    }
+};
+
+/// Memory held by a loaded map, see AmeisenNavigation::GetMapMemoryUsage.
+struct MapMemoryUsage
+{
+    int MapId;
+    size_t NavMeshBytes;
+    size_t IndexBytes;
+    int64_t IdleSeconds;
+};
+
+/// Bytes of a navmesh: its tile array and the data of every loaded tile. Mapped tiles count with their whole
+/// size, although most of their pages are shared with the page cache. Streamed tiles have to be locked.
+inline size_t GetNavMeshMemoryUsage(const dtNavMesh* navMesh) noexcept
+{
+    size_t bytes = sizeof(dtNavMesh) + static_cast<size_t>(navMesh->getMaxTiles()) * sizeof(dtMeshTile);
+
+    for (int i = 0; i < navMesh->getMaxTiles(); ++i)
+    {
+        const dtMeshTile* tile = navMesh->getTile(i);
+
+        if (tile && tile->header)
+            bytes += static_cast<size_t>(tile->dataSize);
+    }
+
+    return bytes;
+}
@@ -0,0 +1,112 @@
+#pragma once
+
+#include <cstddef>
+#include <filesystem>
+
+#ifdef _WIN32
+#ifndef WIN32_LEAN_AND_MEAN
+#define WIN32_LEAN_AND_MEAN
+#endif
+#ifndef NOMINMAX
+#define NOMINMAX
+#endif
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+/// <summary>
+/// File mapped copy-on-write. Pages are shared with the page cache, and with every other process mapping
+/// the same file, until they are written to. Writes only ever go to private copies of the touched pages,
+/// the file itself is never modified.
+/// </summary>
+class MappedFile
+{
+    unsigned char* Data;
+    size_t Size;
+
+#ifdef _WIN32
+    HANDLE Mapping;
+#endif
+
+public:
+    explicit MappedFile(const std::filesystem::path& path) noexcept
+        : Data(nullptr),
+        Size(0)
+#ifdef _WIN32
+        , Mapping(nullptr)
+#endif
+    {
+#ifdef _WIN32
+        // FILE_SHARE_DELETE lets a new version of the file be renamed over it while it is mapped
+        HANDLE file = CreateFileW(path.c_str(), GENERIC_READ, FILE_SHARE_READ | FILE_SHARE_DELETE, nullptr,
+                                  OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, nullptr);
+
+        if (file == INVALID_HANDLE_VALUE)
+            return;
+
+        LARGE_INTEGER fileSize{};
+
+        if (GetFileSizeEx(file, &fileSize) && fileSize.QuadPart > 0)
+        {
+            // the view keeps the mapping alive and the mapping keeps the file open
+            Mapping = CreateFileMappingW(file, nullptr, PAGE_WRITECOPY, 0, 0, nullptr);
+
+            if (Mapping)
+            {
+                Data = static_cast<unsigned char*>(MapViewOfFile(Mapping, FILE_MAP_COPY, 0, 0, 0));
+                Size = Data ? static_cast<size_t>(fileSize.QuadPart) : 0;
+            }
+        }
+
+        CloseHandle(file);
+#else
+        const int fd = open(path.c_str(), O_RDONLY);
+
+        if (fd < 0)
+            return;
+
+        struct stat fileStat{};
+
+        if (fstat(fd, &fileStat) == 0 && fileStat.st_size > 0)
+        {
+            void* data = mmap(nullptr, static_cast<size_t>(fileStat.st_size), PROT_READ | PROT_WRITE, MAP_PRIVATE, fd, 0);
+
+            if (data != MAP_FAILED)
+            {
+                Data = static_cast<unsigned char*>(data);
+                Size = static_cast<size_t>(fileStat.st_size);
+            }
+        }
+
+        // the mapping stays valid without the descriptor
+        close(fd);
+#endif
+    }
+
+    ~MappedFile() noexcept
+    {
+#ifdef _WIN32
+        if (Data)
+            UnmapViewOfFile(Data);
+
+        if (Mapping)
+            CloseHandle(Mapping);
+#else
+        if (Data)
+            munmap(Data, Size);
+#endif
+    }
+
+    MappedFile(const MappedFile&) = delete;
+    MappedFile& operator=(const MappedFile&) = delete;
+
+    constexpr inline bool IsOpen() const noexcept { return Data != nullptr; }
+
+    constexpr inline unsigned char* GetData() const noexcept { return Data; }
+
+    constexpr inline size_t GetSize() const noexcept { return Size; }
+};
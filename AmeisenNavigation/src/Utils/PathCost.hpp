@@ -0,0 +1,8 @@
+#pragma once
+
+/// Walking cost and length to one target of a one-to-many query, both negative if it is not reachable.
+struct PathCost
+{
+    float cost{ -1.0f };
+    float length{ -1.0f };
+};
@@ -0,0 +1,82 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <new>
+#include <span>
+#include <vector>
+
+/// Tiles start on cache lines, the headers and polys Detour reads first do not share a line with the
+/// previous tile.
+constexpr size_t TILE_ARENA_ALIGNMENT = 64;
+
+/// Position of a tile on a Z-order curve over the tile grid. Tiles sorted by it lie close to their
+/// neighbours in both directions, which a path crossing tiles benefits from.
+constexpr inline uint32_t GetTileOrder(int x, int y) noexcept
+{
+    uint32_t order = 0;
+
+    for (int bit = 0; bit < 16; ++bit)
+    {
+        order |= ((static_cast<uint32_t>(x) >> bit) & 1u) << (2 * bit);
+        order |= ((static_cast<uint32_t>(y) >> bit) & 1u) << (2 * bit + 1);
+    }
+
+    return order;
+}
+
+/// <summary>
+/// One block holding the data of all tiles of a map, instead of an allocation per tile scattered over
+/// the heap. Every tile gets its slot when the arena is created, so they can be filled by several
+/// threads at once. The navmesh only points into the arena, tiles are added without DT_TILE_FREE_DATA
+/// and the whole block is freed at once after the navmesh.
+/// </summary>
+class TileArena
+{
+    unsigned char* Data;
+    size_t Size;
+    std::vector<size_t> Offsets;
+
+public:
+    /// Reserve a slot of tileSizes[i] bytes for every tile, in the given order.
+    explicit TileArena(std::span<const size_t> tileSizes) noexcept
+        : Data(nullptr),
+        Size(0),
+        Offsets()
+    {
+        try
+        {
+            Offsets.reserve(tileSizes.size());
+
+            for (const size_t tileSize : tileSizes)
+            {
+                Offsets.push_back(Size);
+                Size += (tileSize + TILE_ARENA_ALIGNMENT - 1) / TILE_ARENA_ALIGNMENT * TILE_ARENA_ALIGNMENT;
+            }
+
+            if (Size)
+                Data = static_cast<unsigned char*>(::operator new(Size, std::align_val_t(TILE_ARENA_ALIGNMENT), std::nothrow));
+        }
+        catch (...) { Data = nullptr; }
+
+        if (!Data)
+            Size = 0;
+    }
+
+    ~TileArena() noexcept
+    {
+        if (Data)
+            ::operator delete(Data, std::align_val_t(TILE_ARENA_ALIGNMENT));
+    }
+
+    TileArena(const TileArena&) = delete;
+    TileArena& operator=(const TileArena&) = delete;
+
+    /// False if the block could not be allocated, callers fall back to allocating every tile.
+    constexpr inline bool IsAllocated() const noexcept { return Data != nullptr; }
+
+    /// Slot of the i-th tile passed to the constructor.
+    inline unsigned char* GetTile(size_t i) const noexcept { return Data + Offsets[i]; }
+
+    constexpr inline size_t GetSize() const noexcept { return Size; }
+};
@@ -159,6 +159,18 @@ public:
         return ok;
     }
 
+    /// Send a packet that already has its size and type header, e.g. one received from another AnTCP
+    /// server, as it is without copying it.
+    inline bool SendPacket(const void* packet, size_t size) const noexcept
+    {
+        constexpr size_t HEADER_SIZE = sizeof(AnTcpSizeType) + sizeof(AnTcpMessageType);
+
+        if (size < HEADER_SIZE || size > HEADER_SIZE + ANTCP_MAX_PACKET_SIZE)
+            return false;
+
+        return send(Socket, static_cast<const char*>(packet), static_cast<int>(size), 0) != SOCKET_ERROR;
+    }
+
     inline void Disconnect() noexcept
     {
         if (!IsActive.load(std::memory_order_acquire))